@@ -0,0 +1,63 @@
+/*
+ * COBS.H - Consistent Overhead Byte Stuffing
+ *
+ * Compartido entre el Solar Node y el gateway. Elimina los 0x00 de una trama
+ * con un byte extra cada 254 como máximo, así el 0x00 queda libre como
+ * delimitador y el receptor se resincroniza en el siguiente.
+ */
+
+#ifndef COMMON_COBS_H
+#define COMMON_COBS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Tamaño máximo codificado (sin el delimitador) para length bytes
+constexpr size_t cobsMaxEncoded(size_t length) {
+    return length + length / 254 + 1;
+}
+
+// Devuelve los bytes escritos en out (sin delimitador)
+inline size_t cobsEncode(const uint8_t* in, size_t length, uint8_t* out) {
+    size_t written = 1;
+    size_t codeIndex = 0;
+    uint8_t code = 1;
+    for (size_t i = 0; i < length; i++) {
+        if (in[i] == 0) {
+            out[codeIndex] = code;
+            codeIndex = written++;
+            code = 1;
+            continue;
+        }
+        out[written++] = in[i];
+        if (++code == 0xFF) {
+            out[codeIndex] = code;
+            codeIndex = written++;
+            code = 1;
+        }
+    }
+    out[codeIndex] = code;
+    return written;
+}
+
+// Decodifica en out (puede ser el mismo buffer que in). 0 si es inválida.
+inline size_t cobsDecode(const uint8_t* in, size_t length, uint8_t* out) {
+    size_t read = 0;
+    size_t written = 0;
+    while (read < length) {
+        uint8_t code = in[read];
+        if (code == 0 || read + code > length) {
+            return 0;
+        }
+        read++;
+        for (uint8_t i = 1; i < code; i++) {
+            out[written++] = in[read++];
+        }
+        if (code != 0xFF && read < length) {
+            out[written++] = 0;
+        }
+    }
+    return written;
+}
+
+#endif
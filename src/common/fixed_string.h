@@ -0,0 +1,249 @@
+/*
+ * FIXED_STRING.H - Cadenas de capacidad fija y vistas sin copia
+ *
+ * Compartido entre el Solar Node y el gateway. Reemplaza a String en la ruta
+ * RX → almacenamiento → UART → gateway: todo se formatea con snprintf sobre
+ * memoria del llamador, sin reservar heap por paquete.
+ */
+
+#ifndef COMMON_FIXED_STRING_H
+#define COMMON_FIXED_STRING_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * VISTA DE SOLO LECTURA SOBRE UN BUFFER EXISTENTE
+ */
+struct StringView {
+    const char* data;
+    size_t length;
+
+    StringView() : data(""), length(0) {}
+    StringView(const char* text) : data(text ? text : ""), length(text ? strlen(text) : 0) {}
+    StringView(const char* text, size_t len) : data(text), length(len) {}
+
+    bool empty() const { return length == 0; }
+    char operator[](size_t index) const { return data[index]; }
+
+    bool equals(StringView other) const {
+        return length == other.length && memcmp(data, other.data, length) == 0;
+    }
+
+    bool startsWith(StringView prefix) const {
+        return length >= prefix.length && memcmp(data, prefix.data, prefix.length) == 0;
+    }
+
+    // Devuelve -1 si no se encuentra, igual que String::indexOf
+    int indexOf(char c, size_t from = 0) const {
+        for (size_t i = from; i < length; i++) {
+            if (data[i] == c) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    StringView substring(size_t from, size_t to) const {
+        if (from > length) from = length;
+        if (to > length) to = length;
+        if (to < from) to = from;
+        return StringView(data + from, to - from);
+    }
+
+    StringView substring(size_t from) const { return substring(from, length); }
+
+    StringView trim() const {
+        size_t start = 0;
+        size_t end = length;
+        while (start < end && (data[start] == ' ' || data[start] == '\t' || data[start] == '\r' || data[start] == '\n')) {
+            start++;
+        }
+        while (end > start && (data[end - 1] == ' ' || data[end - 1] == '\t' || data[end - 1] == '\r' || data[end - 1] == '\n')) {
+            end--;
+        }
+        return StringView(data + start, end - start);
+    }
+
+    // Parseo decimal estricto: falla con vacío, signos o caracteres extra
+    bool toUInt(uint32_t& out) const {
+        if (length == 0 || length > 10) {
+            return false;
+        }
+        uint64_t value = 0;
+        for (size_t i = 0; i < length; i++) {
+            if (data[i] < '0' || data[i] > '9') {
+                return false;
+            }
+            value = value * 10 + static_cast<uint64_t>(data[i] - '0');
+        }
+        if (value > 0xFFFFFFFFull) {
+            return false;
+        }
+        out = static_cast<uint32_t>(value);
+        return true;
+    }
+
+    // Compatibilidad con String::toInt: 0 si no es un número válido
+    uint32_t toUInt() const {
+        uint32_t value = 0;
+        return toUInt(value) ? value : 0;
+    }
+};
+
+inline bool operator==(StringView a, StringView b) { return a.equals(b); }
+inline bool operator!=(StringView a, StringView b) { return !a.equals(b); }
+
+/*
+ * CODIFICACIÓN HEXADECIMAL SOBRE BUFFERS DEL LLAMADOR
+ */
+inline size_t hexEncodeInto(const uint8_t* input, size_t length, char* out, size_t capacity) {
+    static const char HEX_CHARS[] = "0123456789ABCDEF";
+    size_t written = 0;
+    for (size_t i = 0; i < length && written + 2 <= capacity; i++) {
+        out[written++] = HEX_CHARS[input[i] >> 4];
+        out[written++] = HEX_CHARS[input[i] & 0x0F];
+    }
+    return written;
+}
+
+inline int hexNibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return 10 + c - 'A';
+    if (c >= 'a' && c <= 'f') return 10 + c - 'a';
+    return -1;
+}
+
+// Devuelve la cantidad de bytes decodificados o -1 si el texto no es hex válido
+inline int hexDecodeInto(StringView hex, uint8_t* out, size_t capacity) {
+    if (hex.length % 2 != 0 || hex.length / 2 > capacity) {
+        return -1;
+    }
+    for (size_t i = 0; i < hex.length; i += 2) {
+        int hi = hexNibble(hex[i]);
+        int lo = hexNibble(hex[i + 1]);
+        if (hi < 0 || lo < 0) {
+            return -1;
+        }
+        out[i / 2] = static_cast<uint8_t>((hi << 4) | lo);
+    }
+    return static_cast<int>(hex.length / 2);
+}
+
+/*
+ * CADENA DE CAPACIDAD FIJA (sin heap)
+ *
+ * Las escrituras que no caben se truncan y marcan overflowed().
+ */
+template <size_t Capacity>
+class FixedString {
+public:
+    FixedString() : len(0), overflow(false) { buffer[0] = '\0'; }
+    FixedString(StringView text) : FixedString() { append(text); }
+
+    void clear() {
+        len = 0;
+        overflow = false;
+        buffer[0] = '\0';
+    }
+
+    bool append(StringView text) {
+        size_t room = Capacity - len;
+        size_t count = text.length;
+        if (count > room) {
+            count = room;
+            overflow = true;
+        }
+        memcpy(buffer + len, text.data, count);
+        len += count;
+        buffer[len] = '\0';
+        return count == text.length;
+    }
+
+    bool append(const char* text) { return append(StringView(text)); }
+
+    bool append(char c) {
+        if (len >= Capacity) {
+            overflow = true;
+            return false;
+        }
+        buffer[len++] = c;
+        buffer[len] = '\0';
+        return true;
+    }
+
+    __attribute__((format(printf, 2, 3))) bool appendf(const char* format, ...) {
+        va_list args;
+        va_start(args, format);
+        int written = vsnprintf(buffer + len, Capacity - len + 1, format, args);
+        va_end(args);
+        if (written < 0) {
+            buffer[len] = '\0';
+            overflow = true;
+            return false;
+        }
+        if (static_cast<size_t>(written) > Capacity - len) {
+            len = Capacity;
+            overflow = true;
+            return false;
+        }
+        len += static_cast<size_t>(written);
+        return true;
+    }
+
+    // Equivalente a String(value, decimals) sin depender de printf con float
+    bool appendFloat(float value, uint8_t decimals) {
+        static const uint32_t SCALES[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000};
+        if (decimals > 7) decimals = 7;
+        if (value != value) {
+            return append("nan");
+        }
+        bool negative = value < 0.0f;
+        double magnitude = negative ? -static_cast<double>(value) : static_cast<double>(value);
+        uint64_t scaled = static_cast<uint64_t>(magnitude * SCALES[decimals] + 0.5);
+        uint64_t whole = scaled / SCALES[decimals];
+        uint32_t fraction = static_cast<uint32_t>(scaled % SCALES[decimals]);
+        if (decimals == 0) {
+            return appendf("%s%lu", negative ? "-" : "", static_cast<unsigned long>(whole));
+        }
+        return appendf("%s%lu.%0*lu", negative ? "-" : "", static_cast<unsigned long>(whole),
+                       static_cast<int>(decimals), static_cast<unsigned long>(fraction));
+    }
+
+    bool appendHex(const uint8_t* data, size_t length) {
+        size_t written = hexEncodeInto(data, length, buffer + len, Capacity - len);
+        len += written;
+        buffer[len] = '\0';
+        if (written < length * 2) {
+            overflow = true;
+            return false;
+        }
+        return true;
+    }
+
+    // Acceso directo para lectores que escriben en el buffer (p.ej. File::read)
+    char* data() { return buffer; }
+    void setLength(size_t newLength) {
+        len = newLength > Capacity ? Capacity : newLength;
+        buffer[len] = '\0';
+    }
+
+    const char* c_str() const { return buffer; }
+    size_t length() const { return len; }
+    bool empty() const { return len == 0; }
+    bool full() const { return len >= Capacity; }
+    bool overflowed() const { return overflow; }
+    static constexpr size_t capacity() { return Capacity; }
+    StringView view() const { return StringView(buffer, len); }
+    operator StringView() const { return view(); }
+
+private:
+    char buffer[Capacity + 1];
+    size_t len;
+    bool overflow;
+};
+
+#endif
@@ -0,0 +1,39 @@
+/*
+ * RECORD_CSV.H - Representación CSV de un punto
+ *
+ * El Solar Node envía puntos binarios; el gateway los pasa a este formato
+ * (el mismo del log CSV anterior) para subirlos:
+ *
+ *   timestamp,source_id,latitude,longitude,voltage_mV,rssi_dBm,snr_dB
+ */
+
+#ifndef COMMON_RECORD_CSV_H
+#define COMMON_RECORD_CSV_H
+
+#include <stdint.h>
+#include "fixed_string.h"
+#include "series_codec.h"
+
+// Valor en punto fijo con signo, p.ej. -3312345 con 6 decimales → "-3.312345"
+template <size_t N>
+void appendFixedPoint(FixedString<N>& line, int32_t value, uint32_t scale, int decimals) {
+    uint32_t magnitude = value < 0 ? static_cast<uint32_t>(-(value + 1)) + 1 : static_cast<uint32_t>(value);
+    line.appendf("%s%lu.%0*lu", value < 0 ? "-" : "",
+                 static_cast<unsigned long>(magnitude / scale), decimals,
+                 static_cast<unsigned long>(magnitude % scale));
+}
+
+template <size_t N>
+void formatPointCsv(const SeriesPoint& point, FixedString<N>& line) {
+    line.clear();
+    line.appendf("%lu,%u,", static_cast<unsigned long>(point.timestamp), point.sourceId);
+    appendFixedPoint(line, point.latitudeE6, 1000000, 6);
+    line.append(',');
+    appendFixedPoint(line, point.longitudeE6, 1000000, 6);
+    line.appendf(",%u,", point.voltageMilli);
+    appendFixedPoint(line, point.rssiCenti, 100, 2);
+    line.append(',');
+    appendFixedPoint(line, point.snrCenti, 100, 2);
+}
+
+#endif
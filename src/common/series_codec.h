@@ -0,0 +1,173 @@
+/*
+ * SERIES_CODEC.H - Compresión de series de posiciones por fuente
+ *
+ * Un bloque contiene puntos consecutivos de una misma fuente:
+ *
+ *   primer punto:  timestamp (varint), lat, lon (zigzag), voltaje (varint),
+ *                  rssi, snr (zigzag)
+ *   siguientes:    Δ² timestamp, Δ lat, Δ lon, Δ voltaje, Δ rssi, Δ snr
+ *                  (todos zigzag varint)
+ *
+ * Con reportes periódicos el delta-of-delta del timestamp suele ser 0 y las
+ * demás diferencias caben en 1-2 bytes: ~6-9 bytes por punto frente a 28 del
+ * registro fijo. Compartido entre el Solar Node y el gateway; el decoder
+ * entrega un punto por llamada sin materializar el bloque.
+ */
+
+#ifndef COMMON_SERIES_CODEC_H
+#define COMMON_SERIES_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "varint.h"
+
+// Resta y suma módulo 2^32 para los deltas: entre valores alejados (saltos
+// de timestamp, datos corruptos) la diferencia no cabe en int32 y el
+// overflow con signo es UB; en módulo 2^32 el decoder recupera el valor exacto.
+inline int32_t wrappingDifference(int32_t a, int32_t b) {
+    return static_cast<int32_t>(static_cast<uint32_t>(a) - static_cast<uint32_t>(b));
+}
+
+inline int32_t wrappingSum(int32_t a, int32_t b) {
+    return static_cast<int32_t>(static_cast<uint32_t>(a) + static_cast<uint32_t>(b));
+}
+
+struct SeriesPoint {
+    uint32_t timestamp;
+    int32_t latitudeE6;      // grados * 1e6
+    int32_t longitudeE6;     // grados * 1e6
+    uint16_t sourceId;
+    uint16_t voltageMilli;
+    int16_t rssiCenti;       // dBm * 100
+    int16_t snrCenti;        // dB * 100
+};
+
+class SeriesEncoder {
+public:
+    static constexpr size_t MAX_POINT_BYTES = 6 * VARINT_MAX_BYTES;
+    static constexpr uint8_t MAX_POINTS = 255;
+
+    SeriesEncoder() : buffer(nullptr), capacity(0), used(0), points(0), previous(), previousDelta(0) {}
+
+    void begin(uint8_t* out, size_t outCapacity) {
+        buffer = out;
+        capacity = outCapacity;
+        used = 0;
+        points = 0;
+        previousDelta = 0;
+    }
+
+    // false si el punto no cabe: el bloque queda intacto y debe cerrarse
+    bool append(const SeriesPoint& point) {
+        if (points >= MAX_POINTS) {
+            return false;
+        }
+
+        uint8_t encoded[MAX_POINT_BYTES];
+        size_t length = 0;
+        if (points == 0) {
+            length += varintEncode(point.timestamp, encoded + length);
+            length += varintEncode(zigzagEncode(point.latitudeE6), encoded + length);
+            length += varintEncode(zigzagEncode(point.longitudeE6), encoded + length);
+            length += varintEncode(point.voltageMilli, encoded + length);
+            length += varintEncode(zigzagEncode(point.rssiCenti), encoded + length);
+            length += varintEncode(zigzagEncode(point.snrCenti), encoded + length);
+        } else {
+            uint32_t delta = point.timestamp - previous.timestamp;
+            length += varintEncode(zigzagEncode(static_cast<int32_t>(delta - previousDelta)), encoded + length);
+            length += varintEncode(zigzagEncode(wrappingDifference(point.latitudeE6, previous.latitudeE6)), encoded + length);
+            length += varintEncode(zigzagEncode(wrappingDifference(point.longitudeE6, previous.longitudeE6)), encoded + length);
+            length += varintEncode(zigzagEncode(static_cast<int32_t>(point.voltageMilli) - previous.voltageMilli), encoded + length);
+            length += varintEncode(zigzagEncode(point.rssiCenti - previous.rssiCenti), encoded + length);
+            length += varintEncode(zigzagEncode(point.snrCenti - previous.snrCenti), encoded + length);
+        }
+        if (used + length > capacity) {
+            return false;
+        }
+
+        memcpy(buffer + used, encoded, length);
+        used += length;
+        if (points > 0) {
+            previousDelta = point.timestamp - previous.timestamp;
+        }
+        previous = point;
+        points++;
+        return true;
+    }
+
+    size_t size() const { return used; }
+    uint8_t count() const { return points; }
+
+private:
+    uint8_t* buffer;
+    size_t capacity;
+    size_t used;
+    uint8_t points;
+    SeriesPoint previous;
+    uint32_t previousDelta;
+};
+
+class SeriesDecoder {
+public:
+    SeriesDecoder() : data(nullptr), length(0), offset(0), decoded(0), sourceId(0), previous(), previousDelta(0) {}
+
+    void begin(const uint8_t* block, size_t blockLength, uint16_t source) {
+        data = block;
+        length = blockLength;
+        offset = 0;
+        decoded = 0;
+        sourceId = source;
+        previousDelta = 0;
+    }
+
+    // false al final del bloque o si los datos están truncados
+    bool next(SeriesPoint& out) {
+        uint32_t values[6];
+        for (uint8_t i = 0; i < 6; i++) {
+            size_t consumed = varintDecode(data + offset, length - offset, values[i]);
+            if (consumed == 0) {
+                return false;
+            }
+            offset += consumed;
+        }
+
+        SeriesPoint point;
+        point.sourceId = sourceId;
+        if (decoded == 0) {
+            point.timestamp = values[0];
+            point.latitudeE6 = zigzagDecode(values[1]);
+            point.longitudeE6 = zigzagDecode(values[2]);
+            point.voltageMilli = static_cast<uint16_t>(values[3]);
+            point.rssiCenti = static_cast<int16_t>(zigzagDecode(values[4]));
+            point.snrCenti = static_cast<int16_t>(zigzagDecode(values[5]));
+        } else {
+            uint32_t delta = previousDelta + static_cast<uint32_t>(zigzagDecode(values[0]));
+            point.timestamp = previous.timestamp + delta;
+            point.latitudeE6 = wrappingSum(previous.latitudeE6, zigzagDecode(values[1]));
+            point.longitudeE6 = wrappingSum(previous.longitudeE6, zigzagDecode(values[2]));
+            point.voltageMilli = static_cast<uint16_t>(wrappingSum(previous.voltageMilli, zigzagDecode(values[3])));
+            point.rssiCenti = static_cast<int16_t>(wrappingSum(previous.rssiCenti, zigzagDecode(values[4])));
+            point.snrCenti = static_cast<int16_t>(wrappingSum(previous.snrCenti, zigzagDecode(values[5])));
+            previousDelta = delta;
+        }
+
+        previous = point;
+        decoded++;
+        out = point;
+        return true;
+    }
+
+    size_t decodedCount() const { return decoded; }
+
+private:
+    const uint8_t* data;
+    size_t length;
+    size_t offset;
+    size_t decoded;
+    uint16_t sourceId;
+    SeriesPoint previous;
+    uint32_t previousDelta;
+};
+
+#endif
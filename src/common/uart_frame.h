@@ -0,0 +1,370 @@
+/*
+ * UART_FRAME.H - Tramas binarias del enlace Solar Node ↔ gateway
+ *
+ * Compartido entre el Solar Node y el gateway. Cada trama es:
+ *
+ *   COBS( tipo | campos varint | CRC-32 LE ) 0x00
+ *
+ * Los campos van en el orden que fija cada tipo (ver FrameType). Un registro
+ * de DATA viaja como punto binario (~15 bytes) en lugar de CSV en hex
+ * (~90 bytes). Una trama con CRC inválido se descarta entera; el 0x00
+ * siguiente resincroniza el receptor.
+ *
+ * Con BatchCodec::Delta (negociado en START_BATCH/ACK) los registros viajan
+ * en DATA_BLOCK: el primero completo y los siguientes como diferencias con
+ * el anterior, igual que series_codec pero sin estado entre tramas, así que
+ * cada bloque se decodifica solo y los huecos se reenvían como siempre.
+ */
+
+#ifndef COMMON_UART_FRAME_H
+#define COMMON_UART_FRAME_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "cobs.h"
+#include "crc32.h"
+#include "series_codec.h"
+#include "varint.h"
+
+enum class FrameType : uint8_t {
+    Ping = 1,          // gateway → nodo
+    Idle = 2,          // nodo: sin datos
+    Busy = 3,          // nodo: transferencia en curso
+    StartBatch = 4,    // sesión, registros, bytes, es consulta (0/1), continuación,
+                       // secuencia del primer registro, codificación, época del
+                       // log (época y secuencia: clave para reanudar)
+    Data = 5,          // sesión, índice, punto
+    EndBatch = 6,      // sesión
+    Ack = 7,           // sesión, registros que el gateway ya tiene
+    Sack = 8,          // sesión, base acumulada, mapa de los SACK_WINDOW siguientes
+    TransferOk = 9,    // sesión
+    TransferFail = 10, // sesión, motivo (bytes)
+    Cancel = 11,       // sesión
+    QuerySince = 12,   // timestamp, secuencia inicial
+    QuerySource = 13,  // fuente, secuencia inicial
+    ChunkOk = 14,      // sesión, registros del lote ya reenviados por el gateway
+    BaudPropose = 15,  // gateway → nodo: velocidad
+    BaudAccept = 16,   // nodo → gateway: velocidad (a la velocidad anterior)
+    BaudTest = 17,     // velocidad, patrón de prueba (ida y eco, a la nueva velocidad)
+    DataBlock = 18     // sesión, índice del primero, punto, deltas de los siguientes
+                       // hasta el final de la trama
+};
+
+// Codificación de los registros de un lote. START_BATCH lleva la que propone
+// el Solar Node y ACK la que acepta el gateway; sin el campo, Plain.
+enum class BatchCodec : uint8_t {
+    Plain = 0,         // una DATA por registro
+    Delta = 1          // DATA_BLOCK con varios registros
+};
+
+constexpr size_t FRAME_PAYLOAD_MAX = 96;  // tipo + campos + CRC
+constexpr size_t FRAME_ENCODED_MAX = cobsMaxEncoded(FRAME_PAYLOAD_MAX) + 1;
+constexpr size_t FRAME_CRC_SIZE = 4;
+// Registros después de la base que cubre el mapa de un SACK (bit i = base+1+i)
+constexpr size_t SACK_WINDOW = 32;
+
+// El enlace arranca siempre a UART_BAUD_BASE; el gateway propone subir a
+// estas velocidades (de mayor a menor) y la nueva se verifica con un patrón
+constexpr uint32_t UART_BAUD_BASE = 115200;
+constexpr uint32_t UART_BAUD_STEPS[] = {1000000, 921600, 460800};
+constexpr size_t UART_BAUD_STEP_COUNT = sizeof(UART_BAUD_STEPS) / sizeof(UART_BAUD_STEPS[0]);
+constexpr size_t BAUD_TEST_BYTES = 48;
+
+inline bool isNegotiableBaud(uint32_t baud) {
+    if (baud == UART_BAUD_BASE) {
+        return true;
+    }
+    for (size_t i = 0; i < UART_BAUD_STEP_COUNT; i++) {
+        if (UART_BAUD_STEPS[i] == baud) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Bits alternados, 0x00 y 0xFF: lo que primero se corrompe con un reloj mal
+// ajustado
+inline void fillBaudTestPattern(uint8_t* out) {
+    for (size_t i = 0; i < BAUD_TEST_BYTES; i++) {
+        out[i] = static_cast<uint8_t>(i * 0x5B) ^ ((i & 1) ? 0xFF : 0x00);
+    }
+}
+
+inline const char* frameTypeName(FrameType type) {
+    switch (type) {
+        case FrameType::Ping: return "PING";
+        case FrameType::Idle: return "IDLE";
+        case FrameType::Busy: return "BUSY";
+        case FrameType::StartBatch: return "START_BATCH";
+        case FrameType::Data: return "DATA";
+        case FrameType::EndBatch: return "END_BATCH";
+        case FrameType::Ack: return "ACK";
+        case FrameType::Sack: return "SACK";
+        case FrameType::TransferOk: return "TRANSFER_OK";
+        case FrameType::TransferFail: return "TRANSFER_FAIL";
+        case FrameType::Cancel: return "CANCEL";
+        case FrameType::QuerySince: return "QUERY_SINCE";
+        case FrameType::QuerySource: return "QUERY_SOURCE";
+        case FrameType::ChunkOk: return "CHUNK_OK";
+        case FrameType::BaudPropose: return "BAUD_PROPOSE";
+        case FrameType::BaudAccept: return "BAUD_ACCEPT";
+        case FrameType::BaudTest: return "BAUD_TEST";
+        case FrameType::DataBlock: return "DATA_BLOCK";
+    }
+    return "?";
+}
+
+/*
+ * CONSTRUCCIÓN DE TRAMAS
+ */
+class FrameWriter {
+public:
+    explicit FrameWriter(FrameType frameType) : length(1), overflow(false) {
+        buffer[0] = static_cast<uint8_t>(frameType);
+    }
+
+    FrameWriter& put(uint32_t value) {
+        if (length + VARINT_MAX_BYTES + FRAME_CRC_SIZE > FRAME_PAYLOAD_MAX) {
+            overflow = true;
+        } else {
+            length += varintEncode(value, buffer + length);
+        }
+        return *this;
+    }
+
+    FrameWriter& putSigned(int32_t value) { return put(zigzagEncode(value)); }
+
+    // Bytes con prefijo de longitud
+    FrameWriter& putBytes(const void* data, size_t count) {
+        put(static_cast<uint32_t>(count));
+        if (overflow || length + count + FRAME_CRC_SIZE > FRAME_PAYLOAD_MAX) {
+            overflow = true;
+        } else {
+            memcpy(buffer + length, data, count);
+            length += count;
+        }
+        return *this;
+    }
+
+    FrameWriter& putPoint(const SeriesPoint& point) {
+        return put(point.timestamp)
+            .put(point.sourceId)
+            .putSigned(point.latitudeE6)
+            .putSigned(point.longitudeE6)
+            .put(point.voltageMilli)
+            .putSigned(point.rssiCenti)
+            .putSigned(point.snrCenti);
+    }
+
+    // Diferencias con el registro anterior del bloque; la fuente va completa
+    // porque el log intercala fuentes
+    FrameWriter& putPointDelta(const SeriesPoint& point, const SeriesPoint& previous) {
+        return put(point.sourceId)
+            .putSigned(static_cast<int32_t>(point.timestamp - previous.timestamp))
+            .putSigned(wrappingDifference(point.latitudeE6, previous.latitudeE6))
+            .putSigned(wrappingDifference(point.longitudeE6, previous.longitudeE6))
+            .putSigned(static_cast<int32_t>(point.voltageMilli) - previous.voltageMilli)
+            .putSigned(point.rssiCenti - previous.rssiCenti)
+            .putSigned(point.snrCenti - previous.snrCenti);
+    }
+
+    FrameType type() const { return static_cast<FrameType>(buffer[0]); }
+    // Bytes de tipo + campos, sin CRC ni COBS
+    size_t size() const { return length; }
+    bool overflowed() const { return overflow; }
+    // Descarta lo agregado desde size() == position, p.ej. un punto que no cupo
+    void rewind(size_t position) {
+        length = position;
+        overflow = false;
+    }
+
+    // Agrega CRC, codifica con COBS y termina en 0x00. out necesita
+    // FRAME_ENCODED_MAX bytes. Devuelve 0 si algún campo no cupo.
+    size_t encode(uint8_t* out) {
+        if (overflow) {
+            return 0;
+        }
+        uint8_t framed[FRAME_PAYLOAD_MAX];
+        uint32_t crc = crc32(buffer, length);
+        memcpy(framed, buffer, length);
+        for (size_t i = 0; i < FRAME_CRC_SIZE; i++) {
+            framed[length + i] = static_cast<uint8_t>(crc >> (8 * i));
+        }
+        size_t written = cobsEncode(framed, length + FRAME_CRC_SIZE, out);
+        out[written++] = 0;
+        return written;
+    }
+
+private:
+    uint8_t buffer[FRAME_PAYLOAD_MAX];
+    size_t length;
+    bool overflow;
+};
+
+// Bytes que ocupa un punto dentro de una trama DATA
+inline size_t framePointSize(const SeriesPoint& point) {
+    FrameWriter frame(FrameType::Data);
+    size_t header = frame.size();
+    return frame.putPoint(point).size() - header;
+}
+
+// Tipo + campos + CRC de la DATA que llevaría el registro sin compresión
+inline size_t plainDataFrameSize(uint16_t session, size_t index, const SeriesPoint& point) {
+    FrameWriter frame(FrameType::Data);
+    return frame.put(session).put(static_cast<uint32_t>(index)).putPoint(point).size() + FRAME_CRC_SIZE;
+}
+
+/*
+ * LECTURA DE CAMPOS DE UNA TRAMA YA VERIFICADA
+ */
+class FrameReader {
+public:
+    FrameReader(const uint8_t* frame, size_t frameLength)
+        : data(frame), length(frameLength), offset(1) {}
+
+    FrameType type() const { return static_cast<FrameType>(data[0]); }
+
+    bool get(uint32_t& value) {
+        size_t consumed = varintDecode(data + offset, length - offset, value);
+        offset += consumed;
+        return consumed > 0;
+    }
+
+    bool getSigned(int32_t& value) {
+        uint32_t raw;
+        if (!get(raw)) {
+            return false;
+        }
+        value = zigzagDecode(raw);
+        return true;
+    }
+
+    // Apunta a los bytes dentro de la trama, sin copiarlos
+    bool getBytes(const uint8_t*& bytes, size_t& count) {
+        uint32_t declared;
+        if (!get(declared) || declared > length - offset) {
+            return false;
+        }
+        bytes = data + offset;
+        count = declared;
+        offset += declared;
+        return true;
+    }
+
+    bool getPoint(SeriesPoint& point) {
+        uint32_t timestamp, sourceId, voltage;
+        int32_t latitude, longitude, rssi, snr;
+        if (!get(timestamp) || !get(sourceId) || !getSigned(latitude) || !getSigned(longitude) ||
+            !get(voltage) || !getSigned(rssi) || !getSigned(snr)) {
+            return false;
+        }
+        point.timestamp = timestamp;
+        point.sourceId = static_cast<uint16_t>(sourceId);
+        point.latitudeE6 = latitude;
+        point.longitudeE6 = longitude;
+        point.voltageMilli = static_cast<uint16_t>(voltage);
+        point.rssiCenti = static_cast<int16_t>(rssi);
+        point.snrCenti = static_cast<int16_t>(snr);
+        return true;
+    }
+
+    bool getPointDelta(SeriesPoint& point, const SeriesPoint& previous) {
+        uint32_t sourceId;
+        int32_t timestamp, latitude, longitude, voltage, rssi, snr;
+        if (!get(sourceId) || !getSigned(timestamp) || !getSigned(latitude) || !getSigned(longitude) ||
+            !getSigned(voltage) || !getSigned(rssi) || !getSigned(snr)) {
+            return false;
+        }
+        point.timestamp = previous.timestamp + static_cast<uint32_t>(timestamp);
+        point.sourceId = static_cast<uint16_t>(sourceId);
+        point.latitudeE6 = wrappingSum(previous.latitudeE6, latitude);
+        point.longitudeE6 = wrappingSum(previous.longitudeE6, longitude);
+        point.voltageMilli = static_cast<uint16_t>(wrappingSum(previous.voltageMilli, voltage));
+        point.rssiCenti = static_cast<int16_t>(wrappingSum(previous.rssiCenti, rssi));
+        point.snrCenti = static_cast<int16_t>(wrappingSum(previous.snrCenti, snr));
+        return true;
+    }
+
+    size_t position() const { return offset; }
+    bool atEnd() const { return offset >= length; }
+    // Trama completa (tipo + campos), p.ej. para copiarla a una cola
+    const uint8_t* bytes() const { return data; }
+    size_t size() const { return length; }
+
+private:
+    const uint8_t* data;
+    size_t length;
+    size_t offset;
+};
+
+/*
+ * RECEPCIÓN BYTE A BYTE
+ *
+ * Acumula hasta el delimitador, decodifica COBS en el mismo buffer y
+ * verifica el CRC. Una trama más larga que FRAME_ENCODED_MAX se descarta
+ * hasta el próximo 0x00.
+ */
+class FrameDecoder {
+public:
+    FrameDecoder() : received(0), frameLength(0), discarding(false), errorCount(0) {}
+
+    // true cuando completa una trama válida, disponible en frame()
+    bool push(uint8_t byte) {
+        if (byte != 0) {
+            if (received >= FRAME_ENCODED_MAX) {
+                discarding = true;
+            } else if (!discarding) {
+                buffer[received++] = byte;
+            }
+            return false;
+        }
+
+        size_t encoded = received;
+        bool dropped = discarding;
+        received = 0;
+        discarding = false;
+        if (dropped) {
+            errorCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (encoded == 0) {
+            return false;  // delimitadores seguidos
+        }
+
+        size_t decoded = cobsDecode(buffer, encoded, buffer);
+        if (decoded <= FRAME_CRC_SIZE) {
+            errorCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        frameLength = decoded - FRAME_CRC_SIZE;
+        uint32_t crc = 0;
+        for (size_t i = 0; i < FRAME_CRC_SIZE; i++) {
+            crc |= static_cast<uint32_t>(buffer[frameLength + i]) << (8 * i);
+        }
+        if (crc != crc32(buffer, frameLength)) {
+            errorCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    FrameReader frame() const { return FrameReader(buffer, frameLength); }
+    void reset() {
+        received = 0;
+        discarding = false;
+    }
+    // Tramas descartadas por longitud, COBS o CRC; se puede leer desde otra
+    // tarea que la que llama a push()
+    uint32_t errors() const { return errorCount.load(std::memory_order_relaxed); }
+
+private:
+    uint8_t buffer[FRAME_ENCODED_MAX];
+    size_t received;
+    size_t frameLength;
+    bool discarding;
+    std::atomic<uint32_t> errorCount;
+};
+
+#endif
@@ -0,0 +1,49 @@
+/*
+ * VARINT.H - Enteros de longitud variable (LEB128) y codificación zigzag
+ *
+ * Compartido entre el Solar Node y el gateway. Valores de 32 bits: como
+ * máximo VARINT_MAX_BYTES bytes por valor.
+ */
+
+#ifndef COMMON_VARINT_H
+#define COMMON_VARINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+constexpr size_t VARINT_MAX_BYTES = 5;
+
+// Intercala positivos y negativos: 0, -1, 1, -2... → 0, 1, 2, 3...
+inline uint32_t zigzagEncode(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+inline int32_t zigzagDecode(uint32_t value) {
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+// Devuelve la cantidad de bytes escritos en out (hasta VARINT_MAX_BYTES)
+inline size_t varintEncode(uint32_t value, uint8_t* out) {
+    size_t written = 0;
+    while (value >= 0x80) {
+        out[written++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    out[written++] = static_cast<uint8_t>(value);
+    return written;
+}
+
+// Devuelve los bytes consumidos, o 0 si el valor está truncado o es inválido
+inline size_t varintDecode(const uint8_t* data, size_t length, uint32_t& value) {
+    uint32_t result = 0;
+    for (size_t i = 0; i < length && i < VARINT_MAX_BYTES; i++) {
+        result |= static_cast<uint32_t>(data[i] & 0x7F) << (7 * i);
+        if ((data[i] & 0x80) == 0) {
+            value = result;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+#endif
@@ -7,6 +7,7 @@
 
 #include "config_manager.h"
 #include "config_commands.h"
+#include "../log/token_log.h"
 
 #include <cstring>
 
@@ -78,15 +79,15 @@ void ConfigManager::begin() {
 #if CONFIG_MANAGER_HAS_PREFERENCES
     // Inicializar sistema de preferencias con namespace "mesh-config"
     if (!preferences.begin("mesh-config", false)) {
-        Serial.println("[ERROR] No se pudo inicializar sistema de preferencias");
+        TLOG("[ERROR] No se pudo inicializar sistema de preferencias");
         return;
     }
 #else
     storageReady = InternalFS.begin();
     if (!storageReady) {
-        Serial.println("[WARN] No se pudo montar InternalFS. La configuración no se almacenará de forma persistente.");
+        TLOG("[WARN] No se pudo montar InternalFS. La configuración no se almacenará de forma persistente.");
     } else {
-        Serial.println("[INFO] Persistencia habilitada con InternalFS (LittleFS).");
+        TLOG("[INFO] Persistencia habilitada con InternalFS (LittleFS).");
     }
 #endif
 
@@ -102,28 +103,28 @@ void ConfigManager::begin() {
     // Lógica de arranque: determinar estado inicial
     if (!config.configValid) {
         currentState = STATE_CONFIG_MODE;
-        Serial.println("[INFO] Dispositivo sin configurar. Entrando en modo configuración.");
-        Serial.println("[INFO] Use el comando 'HELP' para ver comandos disponibles.");
+        TLOG("[INFO] Dispositivo sin configurar. Entrando en modo configuración.");
+        TLOG("[INFO] Use el comando 'HELP' para ver comandos disponibles.");
         printPrompt();
     } else {
-        Serial.println("[INFO] Configuración válida encontrada.");
+        TLOG("[INFO] Configuración válida encontrada.");
         printConfig();
         
         // NUEVO: Aplicar perfil LoRa cargado
         if (radioProfileManager.isSupportedProfile(static_cast<uint8_t>(config.radioProfile))) {
             radioProfileManager.applyProfile(config.radioProfile);
-            Serial.println("[INFO] Perfil LoRa aplicado: " + getRadioProfileName());
+            TLOG("[INFO] Perfil LoRa aplicado: %s", getRadioProfileName().c_str());
         }
         
-        Serial.println("[INFO] Iniciando en modo operativo en 5 segundos...");
-        Serial.println("[INFO] Envie cualquier comando para entrar en modo configuración.");
+        TLOG("[INFO] Iniciando en modo operativo en 5 segundos...");
+        TLOG("[INFO] Envie cualquier comando para entrar en modo configuración.");
         
         // Esperar 5 segundos para comandos de configuración
         unsigned long startTime = millis();
         while (millis() - startTime < STARTUP_CONFIG_WAIT) {
             if (Serial.available()) {
                 currentState = STATE_CONFIG_MODE;
-                Serial.println("\n[INFO] Entrando en modo configuración.");
+                TLOG("[INFO] Entrando en modo configuración.");
                 printPrompt();
                 return;
             }
@@ -287,7 +288,7 @@ void ConfigManager::loadConfig() {
 #else
     if (!storageReady || !loadFromStorage()) {
         setDefaultConfig();
-        Serial.println("[INFO] Configuración por defecto cargada (sin datos persistidos).");
+        TLOG("[INFO] Configuración por defecto cargada (sin datos persistidos).");
     }
 #endif
     
@@ -501,17 +502,17 @@ void ConfigManager::saveNetworks() {
         preferences.putUInt(hashKey.c_str(), networks[i].hash);
     }
 
-    Serial.println("[Networks] Guardadas " + String(networkCount) + " networks en EEPROM.");
+    TLOG("[Networks] Guardadas %d networks en EEPROM.", networkCount);
 #else
     if (!storageReady) {
-        Serial.println("[WARN] Almacenamiento interno no disponible para guardar networks.");
+        TLOG("[WARN] Almacenamiento interno no disponible para guardar networks.");
         return;
     }
 
     if (saveToStorage()) {
-        Serial.println("[Networks] Guardadas " + String(networkCount) + " networks en InternalFS.");
+        TLOG("[Networks] Guardadas %d networks en InternalFS.", networkCount);
     } else {
-        Serial.println("[WARN] Error al guardar networks en InternalFS.");
+        TLOG("[WARN] Error al guardar networks en InternalFS.");
     }
 #endif
 }
@@ -527,14 +528,14 @@ void ConfigManager::loadNetworks() {
     
     // Validar datos cargados
     if (networkCount > MAX_NETWORKS) {
-        Serial.println("[Networks] ERROR: Contador inválido, reseteando networks.");
+        TLOG("[Networks] ERROR: Contador inválido, reseteando networks.");
         networkCount = 0;
         activeNetworkIndex = -1;
         return;
     }
     
     if (activeNetworkIndex >= networkCount) {
-        Serial.println("[Networks] WARNING: Índice activo inválido, corrigiendo.");
+        TLOG("[Networks] WARNING: Índice activo inválido, corrigiendo.");
         activeNetworkIndex = networkCount > 0 ? 0 : -1;
     }
     
@@ -551,7 +552,7 @@ void ConfigManager::loadNetworks() {
         
         // Validar que la network cargada es válida
         if (networks[i].name.length() == 0 || networks[i].password.length() == 0) {
-            Serial.println("[Networks] ERROR: Network " + String(i) + " corrupta, reseteando.");
+            TLOG("[Networks] ERROR: Network %d corrupta, reseteando.", i);
             networkCount = 0;
             activeNetworkIndex = -1;
             return;
@@ -559,9 +560,9 @@ void ConfigManager::loadNetworks() {
     }
     
     if (networkCount > 0) {
-        Serial.println("[Networks] Cargadas " + String(networkCount) + " networks desde EEPROM.");
+        TLOG("[Networks] Cargadas %d networks desde EEPROM.", networkCount);
         if (activeNetworkIndex >= 0) {
-            Serial.println("[Networks] Network activa: " + networks[activeNetworkIndex].name);
+            TLOG("[Networks] Network activa: %s", networks[activeNetworkIndex].name.c_str());
         }
     }
 #else
@@ -580,9 +581,9 @@ void ConfigManager::loadNetworks() {
     }
 
     if (networkCount > 0) {
-        Serial.println("[Networks] Cargadas " + String(networkCount) + " networks desde InternalFS.");
+        TLOG("[Networks] Cargadas %d networks desde InternalFS.", networkCount);
         if (activeNetworkIndex >= 0) {
-            Serial.println("[Networks] Network activa: " + networks[activeNetworkIndex].name);
+            TLOG("[Networks] Network activa: %s", networks[activeNetworkIndex].name.c_str());
         }
     }
 #endif
@@ -956,12 +957,12 @@ bool ConfigManager::loadFromStorage() {
     file.close();
 
     if (readLen != sizeof(data)) {
-        Serial.println("[WARN] Archivo de configuración incompleto, usando valores por defecto.");
+        TLOG("[WARN] Archivo de configuración incompleto, usando valores por defecto.");
         return false;
     }
 
     if (data.magic != CONFIG_STORAGE_MAGIC || data.version != CONFIG_STORAGE_VERSION) {
-        Serial.println("[WARN] Versión de configuración incompatible, se ignorará el archivo.");
+        TLOG("[WARN] Versión de configuración incompatible, se ignorará el archivo.");
         return false;
     }
 
@@ -49,7 +49,7 @@ void DisplayManager::showAdminRepeaterOutput() {
 /*
  * MOSTRAR OUTPUT DEL RECEIVER
  */
-void DisplayManager::showSimpleReceiverOutput(const String& packet) {
+void DisplayManager::showSimpleReceiverOutput(const char* packet) {
     simpleDisplay.showReceiverOutput(packet);
 }
 
@@ -32,7 +32,7 @@ public:
     /*
      * MÉTODOS PARA RECEIVER
      */
-    void showSimpleReceiverOutput(const String& packet);
+    void showSimpleReceiverOutput(const char* packet);
     void showAdminReceiverOutput();
 };
 
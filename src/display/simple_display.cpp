@@ -54,9 +54,11 @@ void SimpleDisplay::showRepeaterOutput(const String& packet) {
 /*
  * MOSTRAR OUTPUT SIMPLE DEL RECEIVER
  */
-void SimpleDisplay::showReceiverOutput(const String& packet) {
+void SimpleDisplay::showReceiverOutput(const char* packet) {
     // Mostrar solo el packet recibido
-    Serial.println("[" + packet + "]");
+    Serial.print("[");
+    Serial.print(packet);
+    Serial.println("]");
     Serial.println("Datos recibidos");
     Serial.println();
 }
\ No newline at end of file
@@ -23,7 +23,7 @@ public:
      */
     void showTrackerOutput(uint16_t deviceID, float lat, float lon, uint16_t battery, uint32_t timestamp, bool sent);
     void showRepeaterOutput(const String& packet);
-    void showReceiverOutput(const String& packet);
+    void showReceiverOutput(const char* packet);
 };
 
 /*
@@ -0,0 +1,108 @@
+/*
+ * BATCH_CBOR.CPP - Cuerpo CBOR (RFC 8949) de una subida
+ */
+
+#include "batch_cbor.h"
+#include <string.h>
+
+namespace {
+constexpr uint8_t CBOR_UNSIGNED = 0;
+constexpr uint8_t CBOR_NEGATIVE = 1;
+constexpr uint8_t CBOR_TEXT = 3;
+constexpr uint8_t CBOR_ARRAY = 4;
+constexpr uint8_t CBOR_MAP = 5;
+constexpr size_t RECORD_FIELDS = 7;
+}  // namespace
+
+BatchCborStream::BatchCborStream(const UploadSegment* list, size_t count)
+    : UploadBody(list, count), stage(Stage::Open), previousTimestamp(0) {
+    measure();
+}
+
+// Cabecera de un ítem con el argumento en la forma más corta
+void BatchCborStream::putHead(uint8_t major, uint64_t value) {
+    uint8_t type = static_cast<uint8_t>(major << 5);
+    int bytes = 0;
+    if (value < 24) {
+        piece[pieceLength++] = type | static_cast<uint8_t>(value);
+        return;
+    } else if (value <= 0xFF) {
+        piece[pieceLength++] = type | 24;
+        bytes = 1;
+    } else if (value <= 0xFFFF) {
+        piece[pieceLength++] = type | 25;
+        bytes = 2;
+    } else if (value <= 0xFFFFFFFFULL) {
+        piece[pieceLength++] = type | 26;
+        bytes = 4;
+    } else {
+        piece[pieceLength++] = type | 27;
+        bytes = 8;
+    }
+    for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) {
+        piece[pieceLength++] = static_cast<uint8_t>(value >> shift);
+    }
+}
+
+void BatchCborStream::putInt(int64_t value) {
+    if (value >= 0) {
+        putHead(CBOR_UNSIGNED, static_cast<uint64_t>(value));
+    } else {
+        putHead(CBOR_NEGATIVE, static_cast<uint64_t>(-1 - value));
+    }
+}
+
+void BatchCborStream::putText(const char* text) {
+    size_t length = strlen(text);
+    putHead(CBOR_TEXT, length);
+    memcpy(piece + pieceLength, text, length);
+    pieceLength += length;
+}
+
+// Cada pieza ocupa a lo sumo 1 + 7 * 9 bytes (un registro)
+bool BatchCborStream::fill() {
+    switch (stage) {
+        case Stage::Open:
+            putHead(CBOR_ARRAY, segmentCount);
+            stage = segmentCount > 0 ? Stage::Prefix : Stage::Done;
+            return true;
+        case Stage::Prefix: {
+            const UploadSegment& segment = segments[nextSegment];
+            previousTimestamp = segment.count > 0 ? segment.points[0].timestamp : 0;
+            putHead(CBOR_MAP, 3);
+            putText("session");
+            putHead(CBOR_UNSIGNED, segment.sessionId);
+            putText("t0");
+            putHead(CBOR_UNSIGNED, previousTimestamp);
+            putText("records");
+            putHead(CBOR_ARRAY, segment.count);
+            nextRecord = 0;
+            if (segment.count > 0) {
+                stage = Stage::Records;
+            } else {
+                stage = ++nextSegment < segmentCount ? Stage::Prefix : Stage::Done;
+            }
+            return true;
+        }
+        case Stage::Records: {
+            const UploadSegment& segment = segments[nextSegment];
+            const SeriesPoint& point = segment.points[nextRecord];
+            putHead(CBOR_ARRAY, RECORD_FIELDS);
+            putInt(static_cast<int64_t>(point.timestamp) - previousTimestamp);
+            putHead(CBOR_UNSIGNED, point.sourceId);
+            putInt(point.latitudeE6);
+            putInt(point.longitudeE6);
+            putHead(CBOR_UNSIGNED, point.voltageMilli);
+            putInt(point.rssiCenti);
+            putInt(point.snrCenti);
+            previousTimestamp = point.timestamp;
+            if (++nextRecord >= segment.count) {
+                stage = ++nextSegment < segmentCount ? Stage::Prefix : Stage::Done;
+            }
+            return true;
+        }
+        case Stage::Done:
+            break;
+    }
+    return false;
+}
@@ -0,0 +1,44 @@
+/*
+ * BATCH_CBOR.H - Cuerpo CBOR (RFC 8949) de una subida
+ *
+ * Alternativa binaria al JSON para enlaces medidos: enteros tipados en vez
+ * de texto y el timestamp de cada registro como diferencia con el anterior.
+ * Siempre es un arreglo de lotes, con largos definidos:
+ *
+ *   [ {"session": N, "t0": <timestamp del primer registro>,
+ *      "records": [ [dt, source_id, lat_e6, lon_e6, voltage_mV,
+ *                    rssi_cdBm, snr_cdB], ... ]}, ... ]
+ *
+ * dt es timestamp - timestamp del registro anterior del lote (0 en el
+ * primero) y puede ser negativo. Latitud y longitud van en millonésimas de
+ * grado, RSSI y SNR en centésimas, como en SeriesPoint.
+ *
+ * tools/decode_upload.py lo decodifica y compara su tamaño con el JSON.
+ */
+
+#ifndef GATEWAY_BATCH_CBOR_H
+#define GATEWAY_BATCH_CBOR_H
+
+#include "upload_body.h"
+
+class BatchCborStream : public UploadBody {
+public:
+    BatchCborStream(const UploadSegment* segments, size_t count);
+
+    const char* contentType() const override { return "application/cbor"; }
+
+private:
+    enum class Stage : uint8_t { Open, Prefix, Records, Done };
+
+    Stage stage;
+    uint32_t previousTimestamp;
+
+    bool fill() override;
+    void restart() override { stage = Stage::Open; }
+
+    void putHead(uint8_t major, uint64_t value);
+    void putInt(int64_t value);
+    void putText(const char* text);
+};
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * BATCH_JSON.CPP - Cuerpo JSON de una subida
+ */
+
+#include "batch_json.h"
+#include "../common/fixed_string.h"
+#include "../common/record_csv.h"
+
+BatchJsonStream::BatchJsonStream(const UploadSegment* list, size_t count)
+    : UploadBody(list, count), stage(Stage::Open) {
+    measure();
+}
+
+bool BatchJsonStream::fill() {
+    FixedString<PIECE_MAX> text;
+    switch (stage) {
+        case Stage::Open:
+            stage = Stage::Prefix;
+            if (segmentCount != 1) {
+                text.append('[');
+                if (segmentCount == 0) {
+                    stage = Stage::Close;
+                }
+                break;
+            }
+            // Un solo tramo: el objeto sin arreglo, como antes
+            return fill();
+        case Stage::Prefix:
+            text.appendf("%s{\"session\":%u,\"records\":[", nextSegment > 0 ? "," : "",
+                         segments[nextSegment].sessionId);
+            nextRecord = 0;
+            stage = segments[nextSegment].count > 0 ? Stage::Records : Stage::Suffix;
+            break;
+        case Stage::Records: {
+            const UploadSegment& segment = segments[nextSegment];
+            FixedString<PIECE_MAX> line;
+            formatPointCsv(segment.points[nextRecord], line);
+            text.append(nextRecord > 0 ? ",\"" : "\"");
+            text.append(line.c_str());
+            text.append('"');
+            if (++nextRecord >= segment.count) {
+                stage = Stage::Suffix;
+            }
+            break;
+        }
+        case Stage::Suffix:
+            text.append("]}");
+            stage = ++nextSegment < segmentCount ? Stage::Prefix : Stage::Close;
+            break;
+        case Stage::Close:
+            stage = Stage::Done;
+            if (segmentCount == 1) {
+                return false;
+            }
+            text.append(']');
+            break;
+        case Stage::Done:
+            return false;
+    }
+    setPiece(text.c_str(), text.length());
+    return true;
+}
@@ -0,0 +1,34 @@
+/*
+ * BATCH_JSON.H - Cuerpo JSON de una subida
+ *
+ *   {"session":N,"records":["<csv>","<csv>",...]}
+ *
+ * Una subida que junta tramos de varios lotes los manda como arreglo, cada
+ * uno con la misma forma:
+ *
+ *   [{"session":N,"records":[...]},{"session":M,"records":[...]}]
+ *
+ * El CSV sólo tiene dígitos, '-', '.' y ',': no hace falta escapar nada.
+ */
+
+#ifndef GATEWAY_BATCH_JSON_H
+#define GATEWAY_BATCH_JSON_H
+
+#include "upload_body.h"
+
+class BatchJsonStream : public UploadBody {
+public:
+    BatchJsonStream(const UploadSegment* segments, size_t count);
+
+    const char* contentType() const override { return "application/json"; }
+
+private:
+    enum class Stage : uint8_t { Open, Prefix, Records, Suffix, Close, Done };
+
+    Stage stage;
+
+    bool fill() override;
+    void restart() override { stage = Stage::Open; }
+};
+
+#endif
@@ -0,0 +1,78 @@
+/*
+ * FRAME_QUEUE.H - Cola de tramas recibidas del Solar Node
+ *
+ * La tarea de eventos del driver UART (onReceive) decodifica las tramas a
+ * medida que llegan y las deja aquí; loop() las procesa en orden. Un solo
+ * productor y un solo consumidor, sin bloqueos: cada lado sólo mueve su
+ * índice. Si loop() se atrasa y la cola se llena, la trama nueva se descarta
+ * y se cuenta; el SACK siguiente hace que el Solar Node la repita.
+ */
+
+#ifndef GATEWAY_FRAME_QUEUE_H
+#define GATEWAY_FRAME_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "../common/uart_frame.h"
+
+template <size_t Slots>
+class FrameQueue {
+    static_assert((Slots & (Slots - 1)) == 0, "Slots debe ser potencia de 2");
+
+public:
+    FrameQueue() : head(0), tail(0), dropped(0), peak(0) {}
+
+    // Productor (tarea del driver UART)
+    bool push(const FrameReader& frame) {
+        size_t h = head.load(std::memory_order_relaxed);
+        size_t used = h - tail.load(std::memory_order_acquire);
+        if (used >= Slots) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        Slot& slot = slots[h & (Slots - 1)];
+        slot.length = frame.size();
+        memcpy(slot.data, frame.bytes(), slot.length);
+        head.store(h + 1, std::memory_order_release);
+        if (used + 1 > peak.load(std::memory_order_relaxed)) {
+            peak.store(static_cast<uint32_t>(used + 1), std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // Consumidor (loop): copia la trama más antigua en out (FRAME_PAYLOAD_MAX)
+    bool pop(uint8_t* out, size_t& length) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        const Slot& slot = slots[t & (Slots - 1)];
+        length = slot.length;
+        memcpy(out, slot.data, length);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Contadores escritos por el productor y leídos desde loop()
+    uint32_t drops() const { return dropped.load(std::memory_order_relaxed); }
+    // Tramas esperando ahora; leído desde otra tarea es sólo aproximado
+    size_t depth() const { return head.load(std::memory_order_relaxed) - tail.load(std::memory_order_relaxed); }
+    // Máximo de tramas esperando a loop() desde el arranque
+    size_t highWater() const { return peak.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        uint8_t data[FRAME_PAYLOAD_MAX];
+        size_t length;
+    };
+
+    Slot slots[Slots];
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+    std::atomic<uint32_t> dropped;
+    std::atomic<uint32_t> peak;
+};
+
+#endif
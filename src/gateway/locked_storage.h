@@ -0,0 +1,68 @@
+/*
+ * LOCKED_STORAGE.H - Acceso a flash compartido entre tareas del gateway
+ *
+ * SessionStore (tarea de lotes) y UploadQueue (tarea de subida) escriben en
+ * la misma flash, y FlashStorage guarda el último archivo abierto para
+ * lectura. Esta capa serializa cada operación sobre el backend con un mutex;
+ * cada llamada sigue siendo un commit completo, así que no hace falta
+ * sostener el lock entre llamadas.
+ */
+
+#ifndef GATEWAY_LOCKED_STORAGE_H
+#define GATEWAY_LOCKED_STORAGE_H
+
+#include <mutex>
+#include "../storage/storage_backend.h"
+
+class LockedStorage : public StorageBackend {
+public:
+    explicit LockedStorage(StorageBackend& backing) : backing(backing) {}
+
+    bool begin() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        return backing.begin();
+    }
+    bool exists(const char* path) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        return backing.exists(path);
+    }
+    bool remove(const char* path) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        return backing.remove(path);
+    }
+    uint32_t size(const char* path) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        return backing.size(path);
+    }
+    bool read(const char* path, uint32_t offset, void* data, size_t length) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        return backing.read(path, offset, data, length);
+    }
+    bool write(const char* path, uint32_t offset, const void* data, size_t length) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        return backing.write(path, offset, data, length);
+    }
+    bool truncate(const char* path, uint32_t length) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        return backing.truncate(path, length);
+    }
+    bool rename(const char* from, const char* to) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        return backing.rename(from, to);
+    }
+    bool sync() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        return backing.sync();
+    }
+    void poll() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        backing.poll();
+    }
+    const char* name() const override { return backing.name(); }
+
+private:
+    StorageBackend& backing;
+    std::mutex mutex;
+};
+
+#endif
@@ -1,24 +1,111 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <HTTPClient.h>
+#include <Wire.h>
+#include <stdarg.h>
+#include <atomic>
+#include <mutex>
+#include "../common/fixed_string.h"
+#include "../common/uart_frame.h"
+#include "../storage/flash_storage.h"
+#include "batch_cbor.h"
+#include "batch_json.h"
+#include "frame_queue.h"
+#include "locked_storage.h"
+#include "path_health.h"
+#include "session_store.h"
+#include "sim7080.h"
+#include "task_load.h"
+#include "upload_queue.h"
+#include "uplink.h"
 
 namespace {
 // Pines UART hacia el Solar Node
 constexpr int SOLAR_UART_RX_PIN = 17;  // LilyGo GPIO17 ← Solar D7
 constexpr int SOLAR_UART_TX_PIN = 18;  // LilyGo GPIO18 → Solar D6
-constexpr uint32_t SOLAR_UART_BAUD = 115200;
+constexpr uint32_t SOLAR_UART_BAUD = UART_BAUD_BASE;
+// Módem SIM7080G de la placa; se alimenta desde DC3 del PMU AXP2101
+constexpr int MODEM_RX_PIN = 4;
+constexpr int MODEM_TX_PIN = 5;
+constexpr int MODEM_PWRKEY_PIN = 41;
+constexpr uint32_t MODEM_BAUD = 115200;
+constexpr int PMU_SDA_PIN = 15;
+constexpr int PMU_SCL_PIN = 7;
+constexpr uint8_t PMU_ADDRESS = 0x34;
+constexpr uint8_t PMU_DCDC_ENABLE_REG = 0x80;
+constexpr uint8_t PMU_DC3_VOLTAGE_REG = 0x84;
+constexpr uint8_t PMU_DC3_ENABLE_BIT = 0x04;
+constexpr uint8_t PMU_DC3_3000MV = 102;  // 1.6 V + 14 pasos de 100 mV
+// Negociación de velocidad: espera de BAUD_ACCEPT y del eco del patrón, y
+// errores de trama tolerados a una velocidad negociada antes de bajarla
+constexpr unsigned long BAUD_TRIAL_TIMEOUT_MS = 500;
+constexpr uint32_t BAUD_MAX_FRAME_ERRORS = 16;
 
 // Temporizadores y límites del protocolo
 constexpr unsigned long PING_INTERVAL_MS = 60000;
 constexpr unsigned long UART_READ_TIMEOUT_MS = 10000;
-constexpr unsigned long RESEND_WAIT_MS = 1500;
+// SACK cada tantos DATA recibidos, o tras SACK_INTERVAL_MS si llegó algo
+constexpr size_t SACK_EVERY_RECORDS = 8;
+constexpr unsigned long SACK_INTERVAL_MS = 50;
+// Recepción por eventos: la ISR del driver vacía la FIFO de 128 B al
+// llegar a SOLAR_RX_FIFO_FULL bytes (o tras SOLAR_RX_TIMEOUT_SYMBOLS de
+// silencio) hacia un buffer con margen para la ventana del Solar Node
+// (~30 B por DATA) mientras se sube; la tarea del driver arma las tramas.
+constexpr size_t SOLAR_RX_BUFFER = 2048;
+constexpr uint8_t SOLAR_RX_FIFO_FULL = 64;
+constexpr uint8_t SOLAR_RX_TIMEOUT_SYMBOLS = 2;
+// Una ventana completa de DATA más las tramas de control
+constexpr size_t SOLAR_FRAME_SLOTS = 64;
+constexpr size_t MAX_BATCH_RECORDS = 512;
+// Registros por CHUNK_OK al Solar Node cuando se sube sin cola
+constexpr size_t UPLOAD_CHUNK_RECORDS = 64;
+// Una subida desde la cola junta tramos de hasta UPLOAD_BATCH_SEGMENTS lotes
+// y UPLOAD_BATCH_RECORDS registros (~60 B cada uno en el JSON). Un lote que
+// no llena la subida espera hasta UPLOAD_COALESCE_MS a que lleguen otros.
+constexpr size_t UPLOAD_BATCH_RECORDS = 256;
+constexpr size_t UPLOAD_BATCH_SEGMENTS = 8;
+constexpr unsigned long UPLOAD_COALESCE_MS = 180000;
+// Espera tras no poder leer la cola de flash
+constexpr unsigned long UPLOAD_RETRY_MS = 30000;
+// Reintentos por vía (ver PathHealth). El módem tarda en registrarse y
+// gasta más por intento, así que se abre antes y espera más que Wi-Fi.
+constexpr PathHealth::Config CELL_HEALTH = {30000, 600000, 2, 600000, 3600000};
+constexpr PathHealth::Config WIFI_HEALTH = {15000, 300000, 3, 300000, 1800000};
+// Registros de la subida que sirve de sonda con el disyuntor abierto
+constexpr size_t PROBE_RECORDS = 16;
+constexpr unsigned long WIFI_CONNECT_TIMEOUT_MS = 10000;
+// Por debajo del keep-alive habitual de los servidores (60-75 s)
+constexpr unsigned long UPLINK_IDLE_MS = 30000;
+// La subida corre en su propia tarea en el núcleo 0, junto a la pila Wi-Fi;
+// loop() (lotes) y la tarea de eventos UART quedan en el núcleo 1. La tarea
+// despierta al encolar un lote o cada UPLINK_TASK_PERIOD_MS para el módem.
+constexpr BaseType_t UPLINK_TASK_CORE = 0;
+constexpr uint32_t UPLINK_TASK_STACK = 8192;
+constexpr UBaseType_t UPLINK_TASK_PRIORITY = 1;
+constexpr unsigned long UPLINK_TASK_PERIOD_MS = 10;
+constexpr unsigned long TASK_STATS_INTERVAL_MS = 60000;
+constexpr size_t CONSOLE_LINE_MAX = 64;
 
 // Wi-Fi (rellenar con credenciales reales antes de campo)
 constexpr char WIFI_SSID[] = "Totalplay-2.4G-f128";
 constexpr char WIFI_PASS[] = "sAZBHbpPzub6xpyU";
 
 // Endpoint HTTP de pruebas (fallback Wi-Fi)
-constexpr char HTTP_POST_URL[] = "https://webhook.site/0fc6acc7-ab03-486d-aa32-0db0df27d6d6";
+constexpr char HTTP_HOST[] = "webhook.site";
+constexpr uint16_t HTTP_PORT = 443;
+constexpr char HTTP_PATH[] = "/0fc6acc7-ab03-486d-aa32-0db0df27d6d6";
+// PEM de la CA del endpoint; sin ella no se verifica el certificado
+constexpr const char* HTTP_ROOT_CA = nullptr;
+// APN de la SIM (rellenar según el operador antes de campo)
+constexpr char CELL_APN[] = "internet";
+
+// Formato del cuerpo de las subidas; se cambia por consola con UPLOAD JSON|CBOR
+enum class UploadEncoding : uint8_t {
+    Json,
+    Cbor
+};
+
+constexpr UploadEncoding DEFAULT_UPLOAD_ENCODING = UploadEncoding::Json;
 
 enum class GatewayState : uint8_t {
     Idle,
@@ -30,56 +117,233 @@ enum class GatewayState : uint8_t {
 struct BatchSession {
     uint16_t sessionId = 0;
     size_t expectedRecords = 0;
-    size_t expectedBytes = 0;
+    size_t expectedBytes = 0;        // bytes de puntos binarios en DATA
     size_t receivedBytes = 0;
-    std::vector<String> records;
+    uint32_t firstSequence = 0;      // secuencia en el log del Solar Node
+    size_t uploaded = 0;             // registros ya subidos (CHUNK_OK)
+    std::vector<SeriesPoint> points;
     std::vector<bool> receivedMask;
+    size_t ackBase = 0;              // todos los anteriores recibidos
+    size_t sinceSack = 0;            // DATA recibidas desde el último SACK
+    unsigned long lastSack = 0;
     unsigned long lastAction = 0;
     bool active = false;
+    bool isQuery = false;            // respuesta a QUERY_*: no consume el log
+    uint32_t resumeSequence = 0;     // 0 = consulta completa
+    BatchCodec codec = BatchCodec::Plain;
+    // Estadísticas de recepción: bytes de trama (tipo + campos + CRC) de las
+    // DATA/DATA_BLOCK recibidas, incluidos reenvíos, y los que habrían
+    // ocupado como DATA sin compresión
+    unsigned long startedAt = 0;
+    size_t dataFrames = 0;
+    size_t dataBytes = 0;
+    size_t plainBytes = 0;
+    // Huecos: un registro llegó después de uno que falta. Se mide cuánto
+    // tarda la base en pasarlo (reenvío por SACK o por timeout del nodo).
+    size_t highestReceived = 0;
+    bool gapOpen = false;
+    unsigned long gapSince = 0;
+    size_t gaps = 0;
+    unsigned long recoveryMs = 0;
+    unsigned long longestRecoveryMs = 0;
 
     void reset() {
+        isQuery = false;
+        resumeSequence = 0;
+        codec = BatchCodec::Plain;
+        startedAt = 0;
+        dataFrames = 0;
+        dataBytes = 0;
+        plainBytes = 0;
+        highestReceived = 0;
+        gapOpen = false;
+        gapSince = 0;
+        gaps = 0;
+        recoveryMs = 0;
+        longestRecoveryMs = 0;
         sessionId = 0;
         expectedRecords = 0;
         expectedBytes = 0;
         receivedBytes = 0;
-        records.clear();
+        firstSequence = 0;
+        uploaded = 0;
+        points.clear();
         receivedMask.clear();
+        ackBase = 0;
+        sinceSack = 0;
+        lastSack = 0;
         lastAction = 0;
         active = false;
     }
 
     bool isComplete() const {
-        if (!active) return false;
-        for (bool flag : receivedMask) {
-            if (!flag) return false;
-        }
-        return true;
+        return active && ackBase >= expectedRecords;
     }
 };
 
+// Backfill pedido desde consola (o upstream): registros desde un timestamp o
+// de una fuente, en lotes de hasta MAX_BATCH_RECORDS que se encadenan con la
+// secuencia de continuación que devuelve el Solar Node.
+struct BackfillQuery {
+    bool pending = false;
+    bool sent = false;
+    bool bySource = false;
+    uint32_t value = 0;
+    uint32_t fromSequence = 0;
+};
+
 HardwareSerial solarLink(1);
 GatewayState currentState = GatewayState::Idle;
 BatchSession currentBatch;
+FlashStorage flashStorage;
+LockedStorage gatewayStorage(flashStorage);
+SessionStore sessionStore(gatewayStorage);
+
+// La tarea de lotes encola y la de subida vacía: uploadQueue y la espera para
+// juntar lotes van bajo queueMutex. uploadRetryAt, cellular,
+// cellularRecords, la salud de cada vía y la conexión Wi-Fi en curso son
+// sólo de la tarea de subida.
+std::mutex queueMutex;
+UploadQueue uploadQueue(gatewayStorage);
+bool uploadHolding = false;          // esperando más lotes para juntarlos
+unsigned long uploadHoldUntil = 0;
+unsigned long uploadRetryAt = 0;     // 0 = subir en cuanto haya lotes
+
+enum class UplinkPath : uint8_t {
+    Cellular,
+    WiFi
+};
+
+enum class WiFiLink : uint8_t {
+    Ready,
+    Connecting,
+    Failed
+};
+
+PathHealth cellularHealth("celular", CELL_HEALTH);
+PathHealth wifiHealth("Wi-Fi", WIFI_HEALTH);
+bool wifiConnecting = false;
+unsigned long wifiConnectStarted = 0;
+// La subida directa sin cola no espera a Wi-Fi con el disyuntor abierto
+std::atomic<bool> wifiUsable(true);
+
+// El cliente HTTP lo usan la tarea de subida y la subida directa sin cola
+std::mutex wifiMutex;
+HttpUplink uplink(HTTP_HOST, HTTP_PORT, HTTP_PATH, HTTP_ROOT_CA);
+HardwareSerial modemLink(2);
+Sim7080Uplink cellular(modemLink, {HTTP_HOST, HTTP_PORT, HTTP_PATH, CELL_APN, MODEM_PWRKEY_PIN});
+size_t cellularRecords = 0;          // registros del POST celular en curso
+std::atomic<UploadEncoding> uploadEncoding(DEFAULT_UPLOAD_ENCODING);
+
+// Tarea de subida (nullptr: no se pudo crear y loop() la reemplaza) y
+// tiempo ocupado de cada tarea desde el último reporte
+TaskHandle_t uplinkTask = nullptr;
+TaskLoad ingestLoad;
+TaskLoad batchLoad;
+TaskLoad uplinkLoad;
+unsigned long lastTaskStats = 0;
+uint32_t taskStatsSince = 0;
+
+BackfillQuery backfill;
+
+// Velocidad del enlace con el Solar Node. Se prueban UART_BAUD_STEPS de
+// mayor a menor; una que falla no se vuelve a intentar hasta reiniciar.
+struct BaudLink {
+    uint32_t rate = SOLAR_UART_BAUD;
+    uint32_t trialRate = 0;          // 0 = sin prueba en curso
+    bool testing = false;            // ya se cambió, se espera el eco del patrón
+    unsigned long trialStart = 0;
+    size_t nextStep = 0;             // próxima de UART_BAUD_STEPS a proponer
+    uint32_t errorsAtRate = 0;       // solarDecoder.errors() al negociar
+    unsigned long lastFrame = 0;     // última trama válida del Solar Node
+    uint16_t negotiations = 0;
+    uint16_t fallbacks = 0;
+};
+
+BaudLink baudLink;
 
-String rxBuffer;
+// solarDecoder pertenece a la tarea del driver UART; loop() sólo lee las
+// tramas de solarFrames y pide el reinicio del decodificador con
+// solarDecoderReset al cambiar de velocidad.
+FrameDecoder solarDecoder;
+FrameQueue<SOLAR_FRAME_SLOTS> solarFrames;
+std::atomic<bool> solarDecoderReset(false);
+std::atomic<uint32_t> solarOverruns(0);
+FixedString<CONSOLE_LINE_MAX> consoleBuffer;
 unsigned long lastPing = 0;
+uint32_t reportedFrameErrors = 0;
+uint32_t reportedOverruns = 0;
+uint32_t reportedFrameDrops = 0;
+// loop() y la tarea de subida registran por Serial: cada línea sale entera
+// bajo logMutex (println son dos escrituras)
+std::mutex logMutex;
 
 // Funciones utilitarias
-void logLine(const String& line) {
+void logLine(const char* line) {
+    std::lock_guard<std::mutex> lock(logMutex);
     Serial.println(line);
 }
 
-void sendToSolar(const String& line) {
-    solarLink.print(line);
-    solarLink.print('\n');
-    Serial.println("[GATEWAY] UART >>> " + line);
+// Formatea sobre un buffer de pila; Serial.printf reserva heap con líneas largas
+__attribute__((format(printf, 1, 2))) void logf(const char* format, ...) {
+    FixedString<160> line;
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line.data(), line.capacity() + 1, format, args);
+    va_end(args);
+    line.setLength(strlen(line.c_str()));
+    logLine(line.c_str());
 }
 
+void sendToSolar(FrameWriter& frame) {
+    uint8_t encoded[FRAME_ENCODED_MAX];
+    size_t length = frame.encode(encoded);
+    if (length == 0) {
+        logf("[GATEWAY] ERROR: Trama %s excede %u B.", frameTypeName(frame.type()),
+             static_cast<unsigned>(FRAME_PAYLOAD_MAX));
+        return;
+    }
+    solarLink.write(encoded, length);
+    // Los SACK y DATA van a ritmo de línea: registrarlos frenaría el lazo
+    if (frame.type() != FrameType::Sack) {
+        logf("[GATEWAY] UART >>> %s (%u B)", frameTypeName(frame.type()), static_cast<unsigned>(length));
+    }
+}
+
+void sendSessionFrame(FrameType type, uint16_t sessionId) {
+    FrameWriter frame(type);
+    frame.put(sessionId);
+    sendToSolar(frame);
+}
+
+
 void sendPing() {
-    sendToSolar("PING");
+    FrameWriter frame(FrameType::Ping);
+    sendToSolar(frame);
+    lastPing = millis();
+}
+
+void requestBackfill(bool bySource, uint32_t value) {
+    backfill.pending = true;
+    backfill.sent = false;
+    backfill.bySource = bySource;
+    backfill.value = value;
+    backfill.fromSequence = 0;
+    logf("[GATEWAY] Backfill solicitado: %s %lu", bySource ? "fuente" : "desde",
+         static_cast<unsigned long>(value));
+}
+
+// Ocupa el lugar del PING: el Solar Node responde con un lote o IDLE/BUSY
+void sendBackfillQuery() {
+    FrameWriter frame(backfill.bySource ? FrameType::QuerySource : FrameType::QuerySince);
+    frame.put(backfill.value).put(backfill.fromSequence);
+    sendToSolar(frame);
+    backfill.sent = true;
     lastPing = millis();
 }
 
+// Bloquea hasta WIFI_CONNECT_TIMEOUT_MS; sólo para la subida directa, que
+// tiene al Solar Node esperando de todos modos
 bool ensureWiFiConnected() {
     if (WiFi.status() == WL_CONNECTED) {
         return true;
@@ -89,12 +353,12 @@ bool ensureWiFiConnected() {
     WiFi.begin(WIFI_SSID, WIFI_PASS);
 
     unsigned long start = millis();
-    while (WiFi.status() != WL_CONNECTED && (millis() - start) < 10000) {
+    while (WiFi.status() != WL_CONNECTED && (millis() - start) < WIFI_CONNECT_TIMEOUT_MS) {
         delay(200);
     }
 
     if (WiFi.status() == WL_CONNECTED) {
-        logLine("[GATEWAY] Wi-Fi conectado: " + WiFi.localIP().toString());
+        logf("[GATEWAY] Wi-Fi conectado: %s", WiFi.localIP().toString().c_str());
         return true;
     }
 
@@ -102,64 +366,121 @@ bool ensureWiFiConnected() {
     return false;
 }
 
-bool attemptCellularUpload(const BatchSession& batch) {
-    // Stub celular: aún no implementado, retornamos fallo para forzar fallback.
-    (void)batch;
-    logLine("[GATEWAY] Simulando intento celular... fallo esperado.");
-    return false;
+// Versión sin bloqueo para la tarea de subida: arranca la conexión y se
+// consulta en cada vuelta. Al vencer el plazo se corta para que la radio no
+// siga buscando la red hasta el próximo intento.
+WiFiLink pollWiFi() {
+    std::lock_guard<std::mutex> lock(wifiMutex);
+    if (WiFi.status() == WL_CONNECTED) {
+        if (wifiConnecting) {
+            wifiConnecting = false;
+            logf("[GATEWAY] Wi-Fi conectado: %s", WiFi.localIP().toString().c_str());
+        }
+        return WiFiLink::Ready;
+    }
+    if (!wifiConnecting) {
+        logLine("[GATEWAY] Conectando a Wi-Fi...");
+        WiFi.begin(WIFI_SSID, WIFI_PASS);
+        wifiConnecting = true;
+        wifiConnectStarted = millis();
+        return WiFiLink::Connecting;
+    }
+    if (millis() - wifiConnectStarted < WIFI_CONNECT_TIMEOUT_MS) {
+        return WiFiLink::Connecting;
+    }
+    wifiConnecting = false;
+    WiFi.disconnect();
+    logLine("[GATEWAY] WARN: No se pudo conectar a Wi-Fi.");
+    return WiFiLink::Failed;
 }
 
-bool postBatchOverWiFi(const BatchSession& batch) {
-    if (!ensureWiFiConnected()) {
-        return false;
+bool postBody(UploadBody& body) {
+    UplinkTiming timing;
+    bool success = uplink.post(body, timing);
+    if (timing.status > 0) {
+        logf("[GATEWAY] HTTP POST code=%d, %u B: conexión %s %lu ms, envío %lu ms", timing.status,
+             static_cast<unsigned>(body.length()), timing.reused ? "reutilizada" : "nueva", timing.connectMs,
+             timing.transferMs);
+        logf("[GATEWAY] Uplink: %lu pedidos, %lu por conexión reutilizada; %lu conexiones, handshake medio %lu ms",
+             static_cast<unsigned long>(uplink.requests()), static_cast<unsigned long>(uplink.reusedRequests()),
+             static_cast<unsigned long>(uplink.connects()), uplink.averageConnectMs());
     }
+    return success;
+}
 
-    HTTPClient client;
-    if (!client.begin(HTTP_POST_URL)) {
-        logLine("[GATEWAY] ERROR: HTTPClient begin falló.");
-        return false;
+// Tamaño de cada lote de la subida en CBOR frente al JSON equivalente
+void logEncodingSizes(const UploadSegment* segments, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        BatchCborStream cbor(&segments[i], 1);
+        BatchJsonStream json(&segments[i], 1);
+        logf("[GATEWAY] Sesión %u: %u registros, CBOR %u B / JSON %u B (%u%%)", segments[i].sessionId,
+             static_cast<unsigned>(segments[i].count), static_cast<unsigned>(cbor.length()),
+             static_cast<unsigned>(json.length()),
+             static_cast<unsigned>(json.length() > 0 ? cbor.length() * 100 / json.length() : 0));
     }
+}
 
-    client.addHeader("Content-Type", "application/json");
-
-    String payload = "{\"session\":" + String(batch.sessionId) + "},\"records\":[";
-    for (size_t i = 0; i < batch.records.size(); ++i) {
-        const String& entry = batch.records[i];
-        payload += "\"" + entry + "\"";
-        if (i + 1 < batch.records.size()) {
-            payload += ",";
-        }
+// Arma el cuerpo en el formato elegido y se lo pasa a send
+template <typename Send>
+bool withUploadBody(const UploadSegment* segments, size_t count, Send send) {
+    if (uploadEncoding == UploadEncoding::Cbor) {
+        BatchCborStream body(segments, count);
+        return send(body);
     }
-    payload += "]}";
+    BatchJsonStream body(segments, count);
+    return send(body);
+}
 
-    int httpCode = client.POST(payload);
-    if (httpCode < 0) {
-        logLine("[GATEWAY] ERROR: HTTP POST falló: " + String(client.errorToString(httpCode)));
-        client.end();
+bool postBatchOverWiFi(const UploadSegment* segments, size_t count) {
+    std::lock_guard<std::mutex> lock(wifiMutex);
+    if (!ensureWiFiConnected()) {
         return false;
     }
 
-    logLine("[GATEWAY] HTTP POST code=" + String(httpCode));
-    client.end();
-    return httpCode >= 200 && httpCode < 300;
+    if (uploadEncoding == UploadEncoding::Cbor) {
+        logEncodingSizes(segments, count);
+    }
+    // El cuerpo se genera mientras HTTPClient lo envía, sin copiarlo entero
+    return withUploadBody(segments, count, [](UploadBody& body) { return postBody(body); });
 }
 
-String hexDecode(const String& hex) {
-    String out;
-    out.reserve(hex.length() / 2);
-    for (size_t i = 0; i + 1 < hex.length(); i += 2) {
-        char c1 = hex.charAt(i);
-        char c2 = hex.charAt(i + 1);
-        auto decodeNibble = [](char c) -> uint8_t {
-            if (c >= '0' && c <= '9') return static_cast<uint8_t>(c - '0');
-            if (c >= 'A' && c <= 'F') return static_cast<uint8_t>(10 + c - 'A');
-            if (c >= 'a' && c <= 'f') return static_cast<uint8_t>(10 + c - 'a');
-            return 0;
-        };
-        uint8_t val = (decodeNibble(c1) << 4) | decodeNibble(c2);
-        out += static_cast<char>(val);
+// Deja en los tramos sólo los primeros records registros
+void trimSegments(UploadSegment* segments, size_t& segmentCount, size_t records) {
+    size_t kept = 0;
+    for (size_t i = 0; i < segmentCount; i++) {
+        if (kept + segments[i].count >= records) {
+            segments[i].count = records - kept;
+            segmentCount = segments[i].count > 0 ? i + 1 : i;
+            return;
+        }
+        kept += segments[i].count;
+    }
+}
+
+// Arranca el POST por el módem con los registros que quepan en un pedido
+// AT+SHBOD; records y los tramos quedan recortados a lo que se envía
+bool startCellularUpload(UploadSegment* segments, size_t& segmentCount, size_t& records) {
+    for (int attempt = 0; attempt < 4 && records > 0; attempt++) {
+        size_t length = 0;
+        bool started = withUploadBody(segments, segmentCount, [&length](UploadBody& body) {
+            length = body.length();
+            return length <= Sim7080Uplink::BODY_MAX && cellular.post(body);
+        });
+        if (started || length <= Sim7080Uplink::BODY_MAX) {
+            return started;
+        }
+        // Se achica en proporción, con margen para el largo variable de cada registro
+        records = records * Sim7080Uplink::BODY_MAX / length * 9 / 10;
+        trimSegments(segments, segmentCount, records);
     }
-    return out;
+    return false;
+}
+
+// Sin cola el Solar Node espera la subida: sólo Wi-Fi, que es sincrónico.
+// Con el disyuntor de Wi-Fi abierto falla enseguida y el Solar Node
+// conserva los registros.
+bool uploadChunk(const UploadSegment* segments, size_t count) {
+    return wifiUsable && postBatchOverWiFi(segments, count);
 }
 
 void resetStateToIdle() {
@@ -168,181 +489,853 @@ void resetStateToIdle() {
     lastPing = millis();
 }
 
+void setSolarBaud(uint32_t rate) {
+    solarLink.flush();
+    solarLink.updateBaudRate(rate);
+    solarDecoderReset = true;
+}
+
+void logBaudLink() {
+    logf("[GATEWAY] Enlace UART a %lu bps (negociaciones=%u, caídas=%u)",
+         static_cast<unsigned long>(baudLink.rate), baudLink.negotiations, baudLink.fallbacks);
+}
+
+// Se propone a la velocidad actual; el cambio ocurre al recibir BAUD_ACCEPT
+void proposeBaud(uint32_t rate) {
+    FrameWriter frame(FrameType::BaudPropose);
+    frame.put(rate);
+    sendToSolar(frame);
+    baudLink.trialRate = rate;
+    baudLink.testing = false;
+    baudLink.trialStart = millis();
+    lastPing = millis();
+}
+
+// Cualquier fallo deja el enlace en la base; el Solar Node vuelve solo por
+// su propio timeout. Sin respuesta a la propuesta no se culpa a la velocidad
+// (el Solar Node puede estar arrancando): se repite en el próximo intervalo.
+void failBaudTrial(const char* reason, bool rateFailed) {
+    logf("[GATEWAY] WARN: Negociación a %lu bps fallida: %s", static_cast<unsigned long>(baudLink.trialRate), reason);
+    if (rateFailed && baudLink.nextStep < UART_BAUD_STEP_COUNT &&
+        baudLink.trialRate == UART_BAUD_STEPS[baudLink.nextStep]) {
+        baudLink.nextStep++;
+    }
+    if (baudLink.testing || baudLink.rate != SOLAR_UART_BAUD) {
+        setSolarBaud(SOLAR_UART_BAUD);
+        baudLink.fallbacks++;
+    }
+    baudLink.rate = SOLAR_UART_BAUD;
+    baudLink.trialRate = 0;
+    baudLink.testing = false;
+    logBaudLink();
+}
+
+void handleBaudFrame(FrameType type, uint32_t rate, FrameReader& frame) {
+    if (baudLink.trialRate == 0 || rate != baudLink.trialRate) {
+        return;
+    }
+
+    if (type == FrameType::BaudAccept && !baudLink.testing) {
+        setSolarBaud(rate);
+        baudLink.testing = true;
+        baudLink.trialStart = millis();
+        uint8_t pattern[BAUD_TEST_BYTES];
+        fillBaudTestPattern(pattern);
+        FrameWriter test(FrameType::BaudTest);
+        test.put(rate).putBytes(pattern, sizeof(pattern));
+        sendToSolar(test);
+        return;
+    }
+
+    if (type == FrameType::BaudTest && baudLink.testing) {
+        uint8_t expected[BAUD_TEST_BYTES];
+        fillBaudTestPattern(expected);
+        const uint8_t* echo = nullptr;
+        size_t length = 0;
+        if (!frame.getBytes(echo, length) || length != BAUD_TEST_BYTES || memcmp(echo, expected, length) != 0) {
+            failBaudTrial("eco distinto", true);
+            return;
+        }
+        baudLink.rate = rate;
+        baudLink.trialRate = 0;
+        baudLink.testing = false;
+        baudLink.errorsAtRate = solarDecoder.errors();
+        baudLink.negotiations++;
+        logBaudLink();
+        // El PING sale enseguida a la nueva velocidad
+        lastPing = millis() - PING_INTERVAL_MS;
+    }
+}
+
 void processIdleState() {
     const unsigned long now = millis();
-    if (now - lastPing >= PING_INTERVAL_MS) {
+    if (baudLink.trialRate != 0) {
+        if (now - baudLink.trialStart > BAUD_TRIAL_TIMEOUT_MS) {
+            failBaudTrial(baudLink.testing ? "sin eco" : "sin BAUD_ACCEPT", baudLink.testing);
+        }
+        return;
+    }
+
+    // Demasiados errores a la velocidad negociada: se baja a la base de común
+    // acuerdo y en el próximo intervalo se prueba la siguiente
+    if (baudLink.rate != SOLAR_UART_BAUD &&
+        solarDecoder.errors() - baudLink.errorsAtRate >= BAUD_MAX_FRAME_ERRORS) {
+        logf("[GATEWAY] WARN: %lu errores de trama a %lu bps.",
+             static_cast<unsigned long>(solarDecoder.errors() - baudLink.errorsAtRate),
+             static_cast<unsigned long>(baudLink.rate));
+        if (baudLink.nextStep < UART_BAUD_STEP_COUNT && baudLink.rate == UART_BAUD_STEPS[baudLink.nextStep]) {
+            baudLink.nextStep++;
+        }
+        baudLink.fallbacks++;
+        proposeBaud(SOLAR_UART_BAUD);
+        return;
+    }
+
+    // El Solar Node vuelve a la base tras un silencio largo; se hace lo mismo
+    if (baudLink.rate != SOLAR_UART_BAUD && now - baudLink.lastFrame > 2 * PING_INTERVAL_MS) {
+        setSolarBaud(SOLAR_UART_BAUD);
+        baudLink.rate = SOLAR_UART_BAUD;
+        baudLink.fallbacks++;
+        logLine("[GATEWAY] WARN: Solar Node sin respuesta a la velocidad negociada.");
+        logBaudLink();
+    }
+
+    // Una consulta nueva o encadenada sale enseguida; sin respuesta se repite
+    // con el intervalo de PING
+    bool queryReady = backfill.pending && !backfill.sent;
+    if (!queryReady && now - lastPing < PING_INTERVAL_MS) {
+        return;
+    }
+    if (baudLink.rate == SOLAR_UART_BAUD && baudLink.nextStep < UART_BAUD_STEP_COUNT) {
+        proposeBaud(UART_BAUD_STEPS[baudLink.nextStep]);
+        return;
+    }
+    if (backfill.pending) {
+        sendBackfillQuery();
+    } else {
         sendPing();
     }
 }
 
-void startBatch(uint16_t sessionId, size_t count, size_t bytes) {
+void startBatch(uint16_t sessionId, size_t count, size_t bytes, bool isQuery, uint32_t resumeSequence,
+                uint32_t firstSequence, BatchCodec codec, uint32_t epoch) {
+    if (count > MAX_BATCH_RECORDS) {
+        logf("[GATEWAY] WARN: START_BATCH con %u registros excede el máximo.", static_cast<unsigned>(count));
+        sendSessionFrame(FrameType::Cancel, sessionId);
+        return;
+    }
+
     currentBatch.reset();
     currentBatch.sessionId = sessionId;
     currentBatch.expectedRecords = count;
     currentBatch.expectedBytes = bytes;
-    currentBatch.records.resize(count);
+    currentBatch.points.resize(count);
     currentBatch.receivedMask.assign(count, false);
     currentBatch.active = true;
+    currentBatch.isQuery = isQuery;
+    currentBatch.resumeSequence = resumeSequence;
+    currentBatch.firstSequence = firstSequence;
+    currentBatch.codec = codec;
     currentBatch.lastAction = millis();
+    currentBatch.startedAt = millis();
+
+    logf("[GATEWAY] START_BATCH recibido. Sesión %u registros=%u bytes=%u",
+         sessionId, static_cast<unsigned>(count), static_cast<unsigned>(bytes));
 
-    logLine("[GATEWAY] START_BATCH recibido. Sesión " + String(sessionId) +
-            " registros=" + String(count) + " bytes=" + String(bytes));
+    // Un lote del mismo log (época) que empieza dentro del guardado continúa
+    // donde quedó; el archivo se reescribe con la identidad del lote nuevo
+    size_t held = 0;
+    if (!isQuery) {
+        uint32_t uploaded = 0;
+        held = sessionStore.resume(epoch, firstSequence, currentBatch.points.data(), count, uploaded);
+        for (size_t i = 0; i < held; i++) {
+            currentBatch.receivedMask[i] = true;
+            currentBatch.receivedBytes += framePointSize(currentBatch.points[i]);
+        }
+        currentBatch.ackBase = held;
+        currentBatch.uploaded = uploaded;
+        if (!sessionStore.start(sessionId, epoch, firstSequence, count, bytes, uploaded) ||
+            !sessionStore.append(currentBatch.points.data(), held)) {
+            logLine("[GATEWAY] WARN: No se pudo guardar la sesión, seguirá sólo en RAM.");
+        }
+        if (held > 0) {
+            logf("[GATEWAY] Reanudando lote: %u registros ya recibidos, %u subidos.",
+                 static_cast<unsigned>(held), static_cast<unsigned>(uploaded));
+        }
+    }
 
-    sendToSolar("ACK:" + String(sessionId));
+    FrameWriter ack(FrameType::Ack);
+    ack.put(sessionId).put(static_cast<uint32_t>(held)).put(static_cast<uint32_t>(codec));
+    sendToSolar(ack);
     currentState = GatewayState::ReceivingBatch;
 }
 
-void handleDataFrame(uint16_t sessionId, size_t index, size_t len, const String& hexPayload) {
+// Base acumulada y mapa de lo recibido después: el Solar Node reenvía de una
+// vez los huecos y avanza su ventana. El prefijo contiguo se guarda antes de
+// confirmarlo para poder reanudar tras un reinicio.
+void sendSack() {
+    if (!currentBatch.isQuery && sessionStore.storedCount() < currentBatch.ackBase) {
+        size_t from = sessionStore.storedCount();
+        sessionStore.append(&currentBatch.points[from], currentBatch.ackBase - from);
+    }
+
+    uint32_t bitmap = 0;
+    for (size_t bit = 0; bit < SACK_WINDOW; bit++) {
+        size_t index = currentBatch.ackBase + 1 + bit;
+        if (index < currentBatch.expectedRecords && currentBatch.receivedMask[index]) {
+            bitmap |= 1UL << bit;
+        }
+    }
+    FrameWriter frame(FrameType::Sack);
+    frame.put(currentBatch.sessionId).put(static_cast<uint32_t>(currentBatch.ackBase)).put(bitmap);
+    sendToSolar(frame);
+    currentBatch.sinceSack = 0;
+    currentBatch.lastSack = millis();
+}
+
+bool acceptDataFrame(uint16_t sessionId, size_t index) {
     if (!currentBatch.active || sessionId != currentBatch.sessionId) {
         logLine("[GATEWAY] WARN: DATA con sesión inválida. Enviando CANCEL.");
-        sendToSolar("CANCEL:" + String(sessionId));
+        sendSessionFrame(FrameType::Cancel, sessionId);
         resetStateToIdle();
-        return;
+        return false;
     }
 
     if (index >= currentBatch.expectedRecords) {
         logLine("[GATEWAY] WARN: Índice fuera de rango. Cancelando sesión.");
-        sendToSolar("CANCEL:" + String(sessionId));
+        sendSessionFrame(FrameType::Cancel, sessionId);
         resetStateToIdle();
+        return false;
+    }
+    return true;
+}
+
+void storeReceivedPoint(size_t index, const SeriesPoint& point) {
+    currentBatch.points[index] = point;
+    if (!currentBatch.receivedMask[index]) {
+        currentBatch.receivedBytes += framePointSize(point);
+    }
+    currentBatch.receivedMask[index] = true;
+    currentBatch.plainBytes += plainDataFrameSize(currentBatch.sessionId, index, point);
+    if (index > currentBatch.highestReceived) {
+        currentBatch.highestReceived = index;
+    }
+}
+
+void trackGap() {
+    bool open = currentBatch.ackBase < currentBatch.expectedRecords &&
+                currentBatch.highestReceived > currentBatch.ackBase;
+    if (open && !currentBatch.gapOpen) {
+        currentBatch.gapOpen = true;
+        currentBatch.gapSince = millis();
+        currentBatch.gaps++;
+    } else if (!open && currentBatch.gapOpen) {
+        unsigned long recovery = millis() - currentBatch.gapSince;
+        currentBatch.gapOpen = false;
+        currentBatch.recoveryMs += recovery;
+        if (recovery > currentBatch.longestRecoveryMs) {
+            currentBatch.longestRecoveryMs = recovery;
+        }
+    }
+}
+
+void finishDataFrame(const FrameReader& frame, size_t records) {
+    currentBatch.dataFrames++;
+    currentBatch.dataBytes += frame.size() + FRAME_CRC_SIZE;
+    currentBatch.lastAction = millis();
+    while (currentBatch.ackBase < currentBatch.expectedRecords &&
+           currentBatch.receivedMask[currentBatch.ackBase]) {
+        currentBatch.ackBase++;
+    }
+    trackGap();
+
+    currentBatch.sinceSack += records;
+    if (currentBatch.sinceSack >= SACK_EVERY_RECORDS || currentBatch.isComplete()) {
+        sendSack();
+    }
+}
+
+void handleDataFrame(uint16_t sessionId, size_t index, FrameReader& frame) {
+    if (!acceptDataFrame(sessionId, index)) {
         return;
     }
 
-    String decoded = hexDecode(hexPayload);
-    if (decoded.length() != len) {
-        logLine("[GATEWAY] WARN: Longitud payload inconsistente. Solicitando RESEND.");
-        sendToSolar("RESEND:" + String(sessionId) + ":" + String(index));
+    // El CRC ya validó la trama: un punto truncado es un error del emisor
+    SeriesPoint point;
+    if (!frame.getPoint(point)) {
+        logLine("[GATEWAY] WARN: Punto incompleto en DATA, se espera reenvío.");
         return;
     }
+    storeReceivedPoint(index, point);
+    finishDataFrame(frame, 1);
+}
 
-    currentBatch.records[index] = decoded;
-    currentBatch.receivedMask[index] = true;
-    currentBatch.receivedBytes += decoded.length();
-    currentBatch.lastAction = millis();
+// Se decodifica punto a punto sobre la trama, sin copiarla
+void handleDataBlock(uint16_t sessionId, size_t index, FrameReader& frame) {
+    if (!acceptDataFrame(sessionId, index)) {
+        return;
+    }
+
+    SeriesPoint point;
+    if (!frame.getPoint(point)) {
+        logLine("[GATEWAY] WARN: Punto incompleto en DATA_BLOCK, se espera reenvío.");
+        return;
+    }
+    storeReceivedPoint(index, point);
+    size_t records = 1;
+    SeriesPoint previous = point;
+    while (!frame.atEnd() && index + records < currentBatch.expectedRecords &&
+           frame.getPointDelta(point, previous)) {
+        storeReceivedPoint(index + records, point);
+        previous = point;
+        records++;
+    }
+    if (!frame.atEnd()) {
+        logLine("[GATEWAY] WARN: DATA_BLOCK con datos sobrantes, se ignoran.");
+    }
+    finishDataFrame(frame, records);
+}
 
-    logLine("[GATEWAY] DATA índice " + String(index) + " recibido (" + String(len) + " bytes).");
+void logBatchStats() {
+    unsigned long elapsed = millis() - currentBatch.startedAt;
+    if (elapsed == 0) {
+        elapsed = 1;
+    }
+    size_t records = currentBatch.expectedRecords;
+    logf("[GATEWAY] Lote en %lu ms: %lu reg/s, %lu B/s de datos. %u tramas, %u B (%u B sin compresión, %.2fx).",
+         elapsed, static_cast<unsigned long>(records * 1000UL / elapsed),
+         static_cast<unsigned long>(currentBatch.dataBytes * 1000UL / elapsed),
+         static_cast<unsigned>(currentBatch.dataFrames), static_cast<unsigned>(currentBatch.dataBytes),
+         static_cast<unsigned>(currentBatch.plainBytes),
+         currentBatch.dataBytes > 0 ? static_cast<double>(currentBatch.plainBytes) / currentBatch.dataBytes : 1.0);
+    if (currentBatch.gaps > 0) {
+        logf("[GATEWAY] Huecos recuperados: %u, %lu ms en total, el más largo %lu ms.",
+             static_cast<unsigned>(currentBatch.gaps), currentBatch.recoveryMs, currentBatch.longestRecoveryMs);
+    }
 }
 
 void handleEndBatch(uint16_t sessionId) {
     if (!currentBatch.active || sessionId != currentBatch.sessionId) {
-        sendToSolar("CANCEL:" + String(sessionId));
+        sendSessionFrame(FrameType::Cancel, sessionId);
         resetStateToIdle();
         return;
     }
 
     if (!currentBatch.isComplete()) {
         logLine("[GATEWAY] WARN: Lote incompleto al recibir END_BATCH.");
-        for (size_t i = 0; i < currentBatch.receivedMask.size(); ++i) {
-            if (!currentBatch.receivedMask[i]) {
-                sendToSolar("RESEND:" + String(sessionId) + ":" + String(i));
-                return;
-            }
-        }
+        sendSack();
+        return;
     }
 
     if (currentBatch.receivedBytes != currentBatch.expectedBytes) {
-        logLine("[GATEWAY] WARN: Bytes recibidos no coinciden. Actual=" +
-                String(currentBatch.receivedBytes) + " esperado=" + String(currentBatch.expectedBytes));
+        logf("[GATEWAY] WARN: Bytes recibidos no coinciden. Actual=%u esperado=%u",
+             static_cast<unsigned>(currentBatch.receivedBytes), static_cast<unsigned>(currentBatch.expectedBytes));
     }
 
     logLine("[GATEWAY] END_BATCH recibido. Pasando a procesamiento.");
+    logBatchStats();
     currentState = GatewayState::ProcessingBatch;
 }
 
+void sendChunkOk(size_t uploaded) {
+    FrameWriter frame(FrameType::ChunkOk);
+    frame.put(currentBatch.sessionId).put(static_cast<uint32_t>(uploaded));
+    sendToSolar(frame);
+}
+
+// Sin lugar en la cola (o sin flash) se sube como antes, con el Solar Node
+// esperando: un fallo sólo deja sin confirmar el tramo que falló y los
+// siguientes
+bool uploadBatchDirect() {
+    size_t total = currentBatch.points.size();
+    size_t uploaded = currentBatch.uploaded;
+    bool success = true;
+    if (uploaded > 0 && uploaded < total) {
+        sendChunkOk(uploaded);
+    }
+    while (success && uploaded < total) {
+        size_t count = total - uploaded < UPLOAD_CHUNK_RECORDS ? total - uploaded : UPLOAD_CHUNK_RECORDS;
+        UploadSegment segment = {currentBatch.sessionId, &currentBatch.points[uploaded], count};
+        success = uploadChunk(&segment, 1);
+        if (success) {
+            uploaded += count;
+            if (!currentBatch.isQuery) {
+                sessionStore.setUploaded(uploaded);
+            }
+        }
+        if (success && uploaded < total) {
+            sendChunkOk(uploaded);
+        }
+    }
+    return success;
+}
+
+// El lote completo pasa a la cola de subida y se confirma enseguida: el
+// Solar Node no espera a la red
 void processBatch() {
     if (!currentBatch.active) {
         resetStateToIdle();
         return;
     }
 
-    logLine("[GATEWAY] Procesando lote. Registros=" + String(currentBatch.records.size()));
+    logf("[GATEWAY] Procesando lote. Registros=%u", static_cast<unsigned>(currentBatch.points.size()));
 
-    bool success = attemptCellularUpload(currentBatch);
-    if (!success) {
-        success = postBatchOverWiFi(currentBatch);
+    bool success;
+    uint32_t entries;
+    uint32_t pending;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        bool wasEmpty = uploadQueue.empty();
+        success = uploadQueue.push(currentBatch.sessionId, currentBatch.firstSequence, currentBatch.points.data(),
+                                   currentBatch.points.size(), currentBatch.uploaded);
+        if (success && wasEmpty && !uploadQueue.empty()) {
+            uploadHolding = true;
+            uploadHoldUntil = millis() + UPLOAD_COALESCE_MS;
+        }
+        entries = uploadQueue.entries();
+        pending = uploadQueue.pendingRecords();
+    }
+    if (success) {
+        if (uplinkTask != nullptr) {
+            xTaskNotifyGive(uplinkTask);
+        }
+        logf("[GATEWAY] Lote en cola de subida: %lu lotes, %lu registros pendientes.",
+             static_cast<unsigned long>(entries), static_cast<unsigned long>(pending));
+    } else {
+        logLine("[GATEWAY] WARN: Cola de subida llena o sin flash, se sube directo.");
+        success = uploadBatchDirect();
     }
 
     if (success) {
-        sendToSolar("TRANSFER_OK:" + String(currentBatch.sessionId));
-        logLine("[GATEWAY] TRANSFER_OK enviado.");
+        // El lote ya está en la cola (o subido). La sesión queda marcada como
+        // subida entera: si se pierde TRANSFER_OK, el Solar Node vuelve a
+        // anunciar el mismo lote y resume() lo da por recibido y subido. Se
+        // reemplaza cuando llega un lote que empieza después o de otra época.
+        if (!currentBatch.isQuery) {
+            sessionStore.setUploaded(currentBatch.points.size());
+        }
+        sendSessionFrame(FrameType::TransferOk, currentBatch.sessionId);
     } else {
-        sendToSolar("TRANSFER_FAIL:" + String(currentBatch.sessionId) + ":NET_ERROR");
-        logLine("[GATEWAY] TRANSFER_FAIL enviado.");
+        static const char reason[] = "NET_ERROR";
+        FrameWriter frame(FrameType::TransferFail);
+        frame.put(currentBatch.sessionId).putBytes(reason, sizeof(reason) - 1);
+        sendToSolar(frame);
+    }
+
+    if (currentBatch.isQuery && backfill.pending) {
+        // Fallo de red: se repite el mismo tramo en el próximo intervalo
+        backfill.sent = false;
+        if (success && currentBatch.resumeSequence != 0) {
+            backfill.fromSequence = currentBatch.resumeSequence;
+        } else if (success) {
+            backfill.pending = false;
+            logLine("[GATEWAY] Backfill completo.");
+        }
     }
 
     resetStateToIdle();
 }
 
-void handleIncomingLine(const String& line) {
-    if (line == "IDLE") {
-        // Sin datos desde el Solar Node.
+uint32_t queuedRecords() {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return uploadQueue.pendingRecords();
+}
+
+void finishUpload(size_t count, size_t segmentCount) {
+    uploadRetryAt = 0;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        uploadQueue.commit(count);
+    }
+    logf("[GATEWAY] Subidos %u registros de %u lotes (%lu en cola).", static_cast<unsigned>(count),
+         static_cast<unsigned>(segmentCount), static_cast<unsigned long>(queuedRecords()));
+}
+
+void logCellularUpload() {
+    uint32_t kb = (cellular.uploadedBytes() + 1023) / 1024;
+    logf("[GATEWAY] Celular: POST code=%d en %lu ms; radio %lu ms para %lu KB (%lu ms/KB)", cellular.lastStatus(),
+         cellular.lastPostMs(), cellular.radioOnMs(), static_cast<unsigned long>(kb),
+         kb > 0 ? cellular.radioOnMs() / kb : 0UL);
+}
+
+PathHealth& pathHealth(UplinkPath path) {
+    return path == UplinkPath::Cellular ? cellularHealth : wifiHealth;
+}
+
+// Entre las vías que pueden intentar ahora, la de menor costo observado; a
+// igual costo (o sin historial) primero la celular, que no depende de
+// tener una red Wi-Fi a mano
+bool choosePath(UplinkPath& path) {
+    unsigned long now = millis();
+    bool cell = cellular.available() && cellularHealth.ready(now);
+    bool wifi = wifiHealth.ready(now);
+    if (!cell && !wifi) {
+        return false;
+    }
+    path = cell && (!wifi || cellularHealth.cost() <= wifiHealth.cost()) ? UplinkPath::Cellular : UplinkPath::WiFi;
+    return true;
+}
+
+void recordOutcome(UplinkPath path, bool success, unsigned long latencyMs) {
+    PathHealth& health = pathHealth(path);
+    unsigned long now = millis();
+    bool wasClosed = health.state() == PathHealth::State::Closed;
+    if (success) {
+        health.succeeded(latencyMs);
+    } else {
+        health.failed(now);
+    }
+    if (path == UplinkPath::WiFi) {
+        wifiUsable = health.state() == PathHealth::State::Closed;
+    }
+    if (success && wasClosed) {
+        return;  // sólo se reportan fallos y cambios del disyuntor
+    }
+    if (success) {
+        logf("[GATEWAY] Vía %s: sonda correcta, disyuntor cerrado.", health.name());
+    } else if (wasClosed && health.state() == PathHealth::State::Open) {
+        logf("[GATEWAY] Vía %s: disyuntor abierto tras %u fallos.", health.name(),
+             static_cast<unsigned>(health.consecutiveFailures()));
+    }
+    static const char* const stateNames[] = {"cerrado", "abierto", "en sonda"};
+    logf("[GATEWAY] Vía %s: éxito %u%%, latencia %lu ms, disyuntor %s, próximo intento en %lu s", health.name(),
+         static_cast<unsigned>(health.successPermille() / 10), static_cast<unsigned long>(health.latencyMs()),
+         stateNames[static_cast<uint8_t>(health.state())], health.waitMs(now) / 1000);
+}
+
+// Una subida por llamada, desde la tarea de subida. El módem trabaja en
+// segundo plano y su resultado se recoge en llamadas siguientes; Wi-Fi
+// conecta sin bloquear y bloquea esta tarea sólo mientras dura el POST.
+// Cada vía reintenta a su ritmo (PathHealth): un fallo no arrastra a la
+// otra vía en la misma vuelta ni bloquea esperando la red.
+void serviceUploadQueue() {
+    static SeriesPoint chunk[UPLOAD_BATCH_RECORDS];
+    static UploadSegment segments[UPLOAD_BATCH_SEGMENTS];
+    static size_t segmentCount = 0;
+    {
+        // Con una subida directa en curso la conexión no está ociosa
+        std::unique_lock<std::mutex> lock(wifiMutex, std::try_to_lock);
+        if (lock.owns_lock()) {
+            uplink.closeIfIdle(UPLINK_IDLE_MS);
+        }
+    }
+
+    if (cellularRecords > 0) {
+        Sim7080Uplink::Result result = cellular.takeResult();
+        if (result == Sim7080Uplink::Result::Pending) {
+            return;
+        }
+        size_t count = cellularRecords;
+        cellularRecords = 0;
+        bool success = result == Sim7080Uplink::Result::Done;
+        recordOutcome(UplinkPath::Cellular, success, cellular.lastPostMs());
+        if (success) {
+            logCellularUpload();
+            finishUpload(count, segmentCount);
+        } else {
+            logf("[GATEWAY] WARN: Subida celular fallida (%lu registros en cola).",
+                 static_cast<unsigned long>(queuedRecords()));
+        }
+        return;
+    }
+
+    if (uploadRetryAt != 0 && static_cast<long>(millis() - uploadRetryAt) < 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (uploadQueue.empty()) {
+            return;
+        }
+        // Se espera a juntar más lotes salvo que ya alcancen para una subida
+        // llena o que el primero haya esperado bastante
+        if (uploadHolding && uploadQueue.pendingRecords() < UPLOAD_BATCH_RECORDS &&
+            uploadQueue.entries() < UPLOAD_BATCH_SEGMENTS && static_cast<long>(millis() - uploadHoldUntil) < 0) {
+            return;
+        }
+    }
+
+    // Con una conexión Wi-Fi en curso la vía ya está elegida
+    UplinkPath path = UplinkPath::WiFi;
+    if (!wifiConnecting && !choosePath(path)) {
+        return;  // ambas vías en espera
+    }
+    PathHealth& health = pathHealth(path);
+    if (path == UplinkPath::WiFi) {
+        WiFiLink link = pollWiFi();
+        if (link == WiFiLink::Connecting) {
+            return;
+        }
+        if (link == WiFiLink::Failed) {
+            recordOutcome(UplinkPath::WiFi, false, 0);
+            return;
+        }
+    }
+
+    // Abierto o en sonda, el intento es una sonda y se hace chico
+    size_t limit = health.state() == PathHealth::State::Closed ? UPLOAD_BATCH_RECORDS : PROBE_RECORDS;
+    size_t count;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        uploadHolding = false;
+        // Los registros se copian a chunk: la subida no sostiene el lock
+        count = uploadQueue.peek(chunk, limit, segments, UPLOAD_BATCH_SEGMENTS, segmentCount);
+    }
+    if (count == 0) {
+        uploadRetryAt = millis() + UPLOAD_RETRY_MS;
         return;
     }
+    // El intento cuenta desde que sale el POST, no mientras Wi-Fi conecta
+    health.attempt(millis());
 
-    int firstColon = line.indexOf(':');
-    if (firstColon < 0) {
-        if (line == "PING") {
-            // No esperamos PING entrante desde Solar, lo ignoramos.
+    if (path == UplinkPath::Cellular) {
+        if (startCellularUpload(segments, segmentCount, count)) {
+            cellularRecords = count;
+            if (uploadEncoding == UploadEncoding::Cbor) {
+                logEncodingSizes(segments, segmentCount);
+            }
         } else {
-            logLine("[GATEWAY] WARN: Línea desconocida: " + line);
+            recordOutcome(UplinkPath::Cellular, false, 0);
         }
         return;
     }
 
-    String command = line.substring(0, firstColon);
-    String payload = line.substring(firstColon + 1);
+    unsigned long started = millis();
+    bool success = postBatchOverWiFi(segments, segmentCount);
+    recordOutcome(UplinkPath::WiFi, success, millis() - started);
+    if (!success) {
+        logf("[GATEWAY] WARN: Subida por Wi-Fi fallida (%lu registros en cola).",
+             static_cast<unsigned long>(queuedRecords()));
+        return;
+    }
+    finishUpload(count, segmentCount);
+}
 
-    if (command == "START_BATCH") {
-        int colon2 = payload.indexOf(':');
-        int colon3 = payload.indexOf(':', colon2 + 1);
-        if (colon2 < 0 || colon3 < 0) {
+void runUplink() {
+    uint32_t started = micros();
+    cellular.service();
+    serviceUploadQueue();
+    uplinkLoad.add(started);
+}
+
+void uplinkTaskMain(void*) {
+    for (;;) {
+        runUplink();
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(UPLINK_TASK_PERIOD_MS));
+    }
+}
+
+void startUplinkTask() {
+    taskStatsSince = micros();
+    lastTaskStats = millis();
+    if (xTaskCreatePinnedToCore(uplinkTaskMain, "uplink", UPLINK_TASK_STACK, nullptr, UPLINK_TASK_PRIORITY,
+                                &uplinkTask, UPLINK_TASK_CORE) != pdPASS) {
+        uplinkTask = nullptr;
+        logLine("[GATEWAY] WARN: No se pudo crear la tarea de subida; se sube desde loop().");
+    }
+}
+
+// Ocupación de cada tarea, profundidad de las colas entre ellas y pila libre
+void logTaskStats() {
+    if (millis() - lastTaskStats < TASK_STATS_INTERVAL_MS) {
+        return;
+    }
+    lastTaskStats = millis();
+    uint32_t now = micros();
+    uint32_t window = now - taskStatsSince;
+    taskStatsSince = now;
+    uint32_t ingest = ingestLoad.takePermille(window);
+    uint32_t batch = batchLoad.takePermille(window);
+    uint32_t upload = uplinkLoad.takePermille(window);
+    uint32_t entries;
+    uint32_t pending;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        entries = uploadQueue.entries();
+        pending = uploadQueue.pendingRecords();
+    }
+    logf("[GATEWAY] Tareas ocupadas: UART %lu.%lu%%, lotes %lu.%lu%%, subida %lu.%lu%%",
+         static_cast<unsigned long>(ingest / 10), static_cast<unsigned long>(ingest % 10),
+         static_cast<unsigned long>(batch / 10), static_cast<unsigned long>(batch % 10),
+         static_cast<unsigned long>(upload / 10), static_cast<unsigned long>(upload % 10));
+    logf("[GATEWAY] Colas: tramas UART %u (máx. %u), subida %lu lotes/%lu registros; pila libre lotes %u B, "
+         "subida %u B",
+         static_cast<unsigned>(solarFrames.depth()), static_cast<unsigned>(solarFrames.highWater()),
+         static_cast<unsigned long>(entries), static_cast<unsigned long>(pending),
+         static_cast<unsigned>(uxTaskGetStackHighWaterMark(nullptr)),
+         static_cast<unsigned>(uplinkTask != nullptr ? uxTaskGetStackHighWaterMark(uplinkTask) : 0));
+}
+
+void handleSolarFrame(FrameReader frame) {
+    FrameType type = frame.type();
+    baudLink.lastFrame = millis();
+    if (type == FrameType::BaudAccept || type == FrameType::BaudTest) {
+        uint32_t rate = 0;
+        if (frame.get(rate)) {
+            handleBaudFrame(type, rate, frame);
+        }
+        return;
+    }
+
+    // Durante una propuesta, IDLE es un rechazo y BUSY un "más tarde"
+    if (baudLink.trialRate != 0 && !baudLink.testing &&
+        (type == FrameType::Idle || type == FrameType::Busy)) {
+        if (type == FrameType::Idle) {
+            failBaudTrial("rechazada", true);
+        } else {
+            baudLink.trialRate = 0;
+        }
+        return;
+    }
+
+    if (type == FrameType::Idle) {
+        // Sin datos desde el Solar Node (o consulta sin resultados).
+        if (backfill.sent) {
+            backfill.pending = false;
+            backfill.sent = false;
+            logLine("[GATEWAY] Backfill sin más registros.");
+        }
+        return;
+    }
+
+    if (type == FrameType::Busy) {
+        // Transferencia en curso: la consulta se repite en el próximo intervalo
+        backfill.sent = false;
+        return;
+    }
+
+    uint32_t session = 0;
+    if (!frame.get(session)) {
+        logf("[GATEWAY] WARN: Trama %s sin sesión.", frameTypeName(type));
+        return;
+    }
+
+    if (type == FrameType::StartBatch) {
+        // Las respuestas a QUERY_* traen la secuencia de continuación
+        uint32_t count = 0;
+        uint32_t bytes = 0;
+        uint32_t isQuery = 0;
+        uint32_t resume = 0;
+        uint32_t firstSequence = 0;
+        uint32_t codec = 0;
+        uint32_t epoch = 0;
+        if (!frame.get(count) || !frame.get(bytes) || !frame.get(isQuery) || !frame.get(resume) ||
+            !frame.get(firstSequence)) {
             logLine("[GATEWAY] WARN: START_BATCH mal formado.");
             return;
         }
-        uint16_t session = payload.substring(0, colon2).toInt();
-        size_t count = payload.substring(colon2 + 1, colon3).toInt();
-        size_t bytes = payload.substring(colon3 + 1).toInt();
-        startBatch(session, count, bytes);
-    } else if (command == "DATA") {
-        int colon2 = payload.indexOf(':');
-        int colon3 = payload.indexOf(':', colon2 + 1);
-        int colon4 = payload.indexOf(':', colon3 + 1);
-        if (colon2 < 0 || colon3 < 0 || colon4 < 0) {
+        // Codificación propuesta y época del log; un Solar Node anterior no
+        // las manda (sin época no se reanuda)
+        if (frame.get(codec)) {
+            frame.get(epoch);
+        }
+        startBatch(static_cast<uint16_t>(session), count, bytes, isQuery != 0, resume, firstSequence,
+                   codec == static_cast<uint32_t>(BatchCodec::Delta) ? BatchCodec::Delta : BatchCodec::Plain, epoch);
+    } else if (type == FrameType::Data) {
+        uint32_t index = 0;
+        if (!frame.get(index)) {
             logLine("[GATEWAY] WARN: DATA mal formado.");
             return;
         }
-
-        uint16_t session = payload.substring(0, colon2).toInt();
-        size_t index = payload.substring(colon2 + 1, colon3).toInt();
-        size_t len = payload.substring(colon3 + 1, colon4).toInt();
-        String hexPayload = payload.substring(colon4 + 1);
-        handleDataFrame(session, index, len, hexPayload);
-    } else if (command == "END_BATCH") {
-        uint16_t session = payload.toInt();
-        handleEndBatch(session);
+        handleDataFrame(static_cast<uint16_t>(session), index, frame);
+    } else if (type == FrameType::DataBlock) {
+        uint32_t index = 0;
+        if (!frame.get(index)) {
+            logLine("[GATEWAY] WARN: DATA_BLOCK mal formado.");
+            return;
+        }
+        handleDataBlock(static_cast<uint16_t>(session), index, frame);
+    } else if (type == FrameType::EndBatch) {
+        handleEndBatch(static_cast<uint16_t>(session));
+    } else if (type == FrameType::Cancel) {
+        if (currentBatch.active && session == currentBatch.sessionId) {
+            logf("[GATEWAY] Solar Node canceló la sesión %u.", static_cast<unsigned>(session));
+            resetStateToIdle();
+        }
     } else {
-        logLine("[GATEWAY] WARN: Comando no reconocido: " + command);
+        logf("[GATEWAY] WARN: Trama no reconocida: %s", frameTypeName(type));
     }
 }
 
-void readFromSolar() {
+/*
+ * RECEPCIÓN UART (tarea de eventos del driver)
+ */
+void onSolarReceive() {
+    uint32_t started = micros();
+    if (solarDecoderReset.exchange(false)) {
+        solarDecoder.reset();
+    }
     while (solarLink.available()) {
-        char c = solarLink.read();
+        int c = solarLink.read();
+        if (c >= 0 && solarDecoder.push(static_cast<uint8_t>(c))) {
+            solarFrames.push(solarDecoder.frame());
+        }
+    }
+    ingestLoad.add(started);
+}
+
+void onSolarReceiveError(hardwareSerial_error_t error) {
+    if (error == UART_FIFO_OVF_ERROR || error == UART_BUFFER_FULL_ERROR) {
+        solarOverruns++;
+    }
+}
+
+void readFromSolar() {
+    uint8_t data[FRAME_PAYLOAD_MAX];
+    size_t length = 0;
+    while (solarFrames.pop(data, length)) {
+        FrameReader frame(data, length);
+        if (frame.type() != FrameType::Data && frame.type() != FrameType::DataBlock) {
+            logf("[GATEWAY] UART <<< %s", frameTypeName(frame.type()));
+        }
+        handleSolarFrame(frame);
+    }
+
+    if (solarDecoder.errors() != reportedFrameErrors) {
+        reportedFrameErrors = solarDecoder.errors();
+        logf("[GATEWAY] WARN: Trama UART inválida descartada (total=%lu).",
+             static_cast<unsigned long>(reportedFrameErrors));
+    }
+    if (solarOverruns != reportedOverruns || solarFrames.drops() != reportedFrameDrops) {
+        reportedOverruns = solarOverruns;
+        reportedFrameDrops = solarFrames.drops();
+        logf("[GATEWAY] WARN: Desbordes UART=%lu, tramas sin lugar en la cola=%lu (máx. en espera=%u).",
+             static_cast<unsigned long>(reportedOverruns), static_cast<unsigned long>(reportedFrameDrops),
+             static_cast<unsigned>(solarFrames.highWater()));
+    }
+}
+
+// Comandos de consola: BACKFILL SINCE <timestamp> | BACKFILL SOURCE <id>
+void handleConsoleLine(StringView line) {
+    StringView since("BACKFILL SINCE ");
+    StringView source("BACKFILL SOURCE ");
+    uint32_t value = 0;
+    if (line.startsWith(since) && line.substring(since.length).trim().toUInt(value)) {
+        requestBackfill(false, value);
+    } else if (line.startsWith(source) && line.substring(source.length).trim().toUInt(value)) {
+        requestBackfill(true, value);
+    } else if (line == StringView("UPLOAD JSON") || line == StringView("UPLOAD CBOR")) {
+        uploadEncoding = line == StringView("UPLOAD CBOR") ? UploadEncoding::Cbor : UploadEncoding::Json;
+        logf("[GATEWAY] Subidas en %s.", uploadEncoding == UploadEncoding::Cbor ? "CBOR" : "JSON");
+    } else {
+        logLine("[GATEWAY] Uso: BACKFILL SINCE <timestamp> | BACKFILL SOURCE <id> | UPLOAD JSON|CBOR");
+    }
+}
+
+void readConsole() {
+    while (Serial.available()) {
+        char c = Serial.read();
         if (c == '\r') {
             continue;
         }
         if (c == '\n') {
-            String line = rxBuffer;
-            rxBuffer = "";
-            line.trim();
-            if (line.length() > 0) {
-                Serial.println("[GATEWAY] UART <<< " + line);
-                handleIncomingLine(line);
-            }
-        } else {
-            rxBuffer += c;
-            if (rxBuffer.length() > 256) {
-                rxBuffer = "";
+            StringView line = consoleBuffer.view().trim();
+            if (!line.empty()) {
+                handleConsoleLine(line);
             }
+            consoleBuffer.clear();
+        } else if (!consoleBuffer.append(c)) {
+            consoleBuffer.clear();
         }
     }
 }
@@ -357,8 +1350,11 @@ void runStateMachine() {
             if (currentBatch.active &&
                 (millis() - currentBatch.lastAction) > UART_READ_TIMEOUT_MS) {
                 logLine("[GATEWAY] WARN: Timeout de recepción. Cancelando sesión.");
-                sendToSolar("CANCEL:" + String(currentBatch.sessionId));
+                sendSessionFrame(FrameType::Cancel, currentBatch.sessionId);
                 resetStateToIdle();
+            } else if (currentBatch.sinceSack > 0 &&
+                       (millis() - currentBatch.lastSack) >= SACK_INTERVAL_MS) {
+                sendSack();
             }
             break;
         case GatewayState::ProcessingBatch:
@@ -382,21 +1378,74 @@ void initializeConsole() {
 }
 
 void initializeSolarLink() {
+    solarLink.setRxBufferSize(SOLAR_RX_BUFFER);
+    solarLink.onReceiveError(onSolarReceiveError);
+    solarLink.onReceive(onSolarReceive, false);
     solarLink.begin(SOLAR_UART_BAUD, SERIAL_8N1, SOLAR_UART_RX_PIN, SOLAR_UART_TX_PIN);
+    solarLink.setRxFIFOFull(SOLAR_RX_FIFO_FULL);
+    solarLink.setRxTimeout(SOLAR_RX_TIMEOUT_SYMBOLS);
     Serial.printf("[GATEWAY] UART listo en RX=%d TX=%d @ %lu bps\n",
                   SOLAR_UART_RX_PIN, SOLAR_UART_TX_PIN, static_cast<unsigned long>(SOLAR_UART_BAUD));
     lastPing = millis();
 }
+
+// Enciende DC3 del AXP2101 a 3.0 V; el módem no arranca sin esa fuente
+bool enableModemSupply() {
+    Wire.begin(PMU_SDA_PIN, PMU_SCL_PIN);
+    Wire.beginTransmission(PMU_ADDRESS);
+    Wire.write(PMU_DC3_VOLTAGE_REG);
+    Wire.write(PMU_DC3_3000MV);
+    if (Wire.endTransmission() != 0) {
+        return false;
+    }
+    Wire.beginTransmission(PMU_ADDRESS);
+    Wire.write(PMU_DCDC_ENABLE_REG);
+    if (Wire.endTransmission(false) != 0 || Wire.requestFrom(PMU_ADDRESS, static_cast<uint8_t>(1)) != 1) {
+        return false;
+    }
+    uint8_t enabled = static_cast<uint8_t>(Wire.read());
+    Wire.beginTransmission(PMU_ADDRESS);
+    Wire.write(PMU_DCDC_ENABLE_REG);
+    Wire.write(static_cast<uint8_t>(enabled | PMU_DC3_ENABLE_BIT));
+    return Wire.endTransmission() == 0;
+}
+
+void initializeCellular() {
+    if (!enableModemSupply()) {
+        logLine("[GATEWAY] WARN: No se pudo encender la fuente del módem (PMU).");
+    }
+    modemLink.begin(MODEM_BAUD, SERIAL_8N1, MODEM_RX_PIN, MODEM_TX_PIN);
+    cellular.begin();
+}
+
+void initializeSessionStore() {
+    if (!gatewayStorage.begin() || !sessionStore.begin() || !uploadQueue.begin()) {
+        logLine("[GATEWAY] WARN: Flash no disponible, los lotes no se podrán reanudar.");
+    }
+}
 }  // namespace
 
 void setup() {
     initializeConsole();
+    initializeSessionStore();
     initializeSolarLink();
+    initializeCellular();
     WiFi.mode(WIFI_STA);
+    startUplinkTask();
 }
 
+// Tarea de lotes: consola, tramas del Solar Node y máquina de estados
 void loop() {
+    uint32_t started = micros();
+    readConsole();
     readFromSolar();
     runStateMachine();
-    delay(10);
+    if (uplinkTask == nullptr && currentState == GatewayState::Idle) {
+        runUplink();  // sin tarea propia, Wi-Fi sólo fuera de una sesión UART
+    }
+    batchLoad.add(started);
+    logTaskStats();
+    // Las tramas llegan a la cola aunque loop() duerma; durante un lote se
+    // vuelve antes para responder con SACK a tiempo
+    delay(currentState == GatewayState::ReceivingBatch ? 1 : 10);
 }
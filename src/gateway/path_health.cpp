@@ -0,0 +1,83 @@
+/*
+ * PATH_HEALTH.CPP - Salud de una vía de subida (celular o Wi-Fi)
+ */
+
+#include "path_health.h"
+
+namespace {
+// Peso de cada muestra nueva en los promedios móviles: 1/4
+constexpr uint32_t EWMA_SHIFT = 2;
+// Piso de la tasa de éxito en cost(), para que una vía caída no divida por 0
+constexpr uint32_t MIN_SUCCESS_PERMILLE = 50;
+
+uint32_t average(uint32_t current, uint32_t sample) {
+    return sample >= current ? current + ((sample - current) >> EWMA_SHIFT)
+                             : current - ((current - sample) >> EWMA_SHIFT);
+}
+}  // namespace
+
+PathHealth::PathHealth(const char* name, const Config& pathConfig)
+    : label(name), config(pathConfig), current(State::Closed), failures(0),
+      openMs(pathConfig.openMs), retryAt(0), waiting(false), success(1000), latency(0), samples(0) {}
+
+bool PathHealth::ready(unsigned long now) const {
+    return !waiting || static_cast<long>(now - retryAt) >= 0;
+}
+
+unsigned long PathHealth::waitMs(unsigned long now) const {
+    return waiting && static_cast<long>(retryAt - now) > 0 ? retryAt - now : 0;
+}
+
+void PathHealth::attempt(unsigned long now) {
+    if (current == State::Open && ready(now)) {
+        current = State::HalfOpen;
+    }
+}
+
+void PathHealth::succeeded(unsigned long latencyMs) {
+    current = State::Closed;
+    failures = 0;
+    openMs = config.openMs;
+    waiting = false;
+    success = static_cast<uint16_t>(average(success, 1000));
+    latency = samples == 0 ? latencyMs : average(latency, latencyMs);
+    samples++;
+}
+
+void PathHealth::failed(unsigned long now) {
+    if (failures < 255) {
+        failures++;
+    }
+    success = static_cast<uint16_t>(average(success, 0));
+    samples++;
+
+    if (current != State::Closed || failures >= config.failureThreshold) {
+        // Sonda fallida; Open si falló antes de attempt()
+        if (current != State::Closed) {
+            openMs = openMs * 2 < config.maxOpenMs ? openMs * 2 : config.maxOpenMs;
+        }
+        current = State::Open;
+        defer(now, openMs);
+        return;
+    }
+
+    unsigned long delayMs = config.baseDelayMs;
+    for (uint8_t i = 1; i < failures && delayMs < config.maxDelayMs; i++) {
+        delayMs *= 2;
+    }
+    defer(now, delayMs < config.maxDelayMs ? delayMs : config.maxDelayMs);
+}
+
+uint32_t PathHealth::cost() const {
+    if (samples == 0) {
+        return 0;  // sin historial se prueba primero
+    }
+    uint32_t rate = success > MIN_SUCCESS_PERMILLE ? success : MIN_SUCCESS_PERMILLE;
+    return static_cast<uint32_t>(static_cast<uint64_t>(latency) * 1000 / rate);
+}
+
+// Jitter "igual": entre la mitad y el total de la espera
+void PathHealth::defer(unsigned long now, unsigned long delayMs) {
+    retryAt = now + delayMs / 2 + static_cast<unsigned long>(random(0, static_cast<long>(delayMs / 2) + 1));
+    waiting = true;
+}
@@ -0,0 +1,80 @@
+/*
+ * PATH_HEALTH.H - Salud de una vía de subida (celular o Wi-Fi)
+ *
+ * Cada vía lleva su propio ritmo de reintentos y un disyuntor:
+ *
+ *   Closed ── failureThreshold fallos seguidos ──> Open
+ *     ^                                              │ vence la espera
+ *     └─────── sonda correcta ─── HalfOpen <─────────┘
+ *                                    └─ sonda fallida: Open, espera doble
+ *
+ * Un fallo anotado estando Open (la vía no llegó a attempt(), p.ej. Wi-Fi
+ * que no conecta) cuenta como sonda fallida y también dobla la espera.
+ *
+ * Cerrado, cada fallo aplaza la vía con backoff exponencial desde
+ * baseDelayMs hasta maxDelayMs. Todas las esperas llevan jitter (entre la
+ * mitad y el total) para que los gateways de un mismo corte no vuelvan a la
+ * vez. Abierto, no se intenta nada hasta que vence la espera; el intento
+ * siguiente es la sonda, y quien llama la hace chica. Quien llama hace un
+ * intento por vez y anota su resultado antes de empezar otro.
+ *
+ * La tasa de éxito y la latencia se siguen con promedios móviles; cost()
+ * las combina en el tiempo esperado por subida exitosa para elegir la vía.
+ * No registra nada: quien anota los resultados reporta los cambios de
+ * estado con el log del gateway, que se usa desde más de una tarea.
+ */
+
+#ifndef GATEWAY_PATH_HEALTH_H
+#define GATEWAY_PATH_HEALTH_H
+
+#include <Arduino.h>
+
+class PathHealth {
+public:
+    struct Config {
+        unsigned long baseDelayMs;
+        unsigned long maxDelayMs;
+        uint8_t failureThreshold;
+        unsigned long openMs;        // primera espera con el disyuntor abierto
+        unsigned long maxOpenMs;
+    };
+
+    enum class State : uint8_t { Closed, Open, HalfOpen };
+
+    PathHealth(const char* name, const Config& config);
+
+    // true si la vía puede intentar una subida ahora
+    bool ready(unsigned long now) const;
+    // Anota el comienzo de un intento; abierto y vencido, pasa a HalfOpen.
+    // Después, state() != Closed indica que el intento es una sonda.
+    void attempt(unsigned long now);
+    void succeeded(unsigned long latencyMs);
+    void failed(unsigned long now);
+
+    // Milisegundos esperados por subida exitosa; 0 sin historial
+    uint32_t cost() const;
+
+    const char* name() const { return label; }
+    State state() const { return current; }
+    uint8_t consecutiveFailures() const { return failures; }
+    uint16_t successPermille() const { return success; }
+    uint32_t latencyMs() const { return latency; }
+    // Milisegundos hasta poder intentar, 0 si ya puede
+    unsigned long waitMs(unsigned long now) const;
+
+private:
+    const char* label;
+    Config config;
+    State current;
+    uint8_t failures;            // seguidos desde el último éxito
+    unsigned long openMs;        // espera del próximo Open
+    unsigned long retryAt;
+    bool waiting;
+    uint16_t success;            // por mil, promedio móvil
+    uint32_t latency;            // ms, promedio móvil de las exitosas
+    uint32_t samples;
+
+    void defer(unsigned long now, unsigned long delayMs);
+};
+
+#endif
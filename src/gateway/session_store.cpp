@@ -0,0 +1,116 @@
+/*
+ * SESSION_STORE.CPP - Persistencia del lote en curso del gateway
+ */
+
+#include "session_store.h"
+#include <stddef.h>
+#include "../common/crc32.h"
+
+namespace {
+constexpr char SESSION_PATH[] = "/gw_session.bin";
+constexpr uint32_t SESSION_MAGIC = 0x32534553;  // "SES2", con época
+}  // namespace
+
+SessionStore::SessionStore(StorageBackend& backend) : storage(backend), header(), stored(0), valid(false) {}
+
+bool SessionStore::begin() {
+    valid = false;
+    stored = 0;
+    if (!storage.exists(SESSION_PATH)) {
+        return true;
+    }
+
+    uint32_t fileSize = storage.size(SESSION_PATH);
+    if (fileSize < sizeof(header) ||
+        !storage.read(SESSION_PATH, 0, &header, sizeof(header)) ||
+        header.magic != SESSION_MAGIC ||
+        header.crc != crc32(&header, offsetof(SessionHeader, crc))) {
+        Serial.println("[GATEWAY] WARN: Sesión guardada inválida, se descarta.");
+        storage.remove(SESSION_PATH);
+        return true;
+    }
+
+    stored = (fileSize - sizeof(header)) / sizeof(SeriesPoint);
+    if (stored > header.records) {
+        stored = header.records;
+    }
+    valid = true;
+    Serial.printf("[GATEWAY] Sesión guardada: %u puntos desde secuencia %lu (%lu subidos).\n",
+                  static_cast<unsigned>(stored), static_cast<unsigned long>(header.firstSequence),
+                  static_cast<unsigned long>(header.uploaded));
+    return true;
+}
+
+bool SessionStore::writeHeader() {
+    header.crc = crc32(&header, offsetof(SessionHeader, crc));
+    return storage.write(SESSION_PATH, 0, &header, sizeof(header));
+}
+
+bool SessionStore::start(uint16_t sessionId, uint32_t epoch, uint32_t firstSequence, uint32_t records,
+                         uint32_t bytes, uint32_t uploaded) {
+    clear();
+    header = SessionHeader();
+    header.magic = SESSION_MAGIC;
+    header.epoch = epoch;
+    header.firstSequence = firstSequence;
+    header.records = records;
+    header.bytes = bytes;
+    header.uploaded = uploaded;
+    header.sessionId = sessionId;
+    valid = writeHeader();
+    return valid;
+}
+
+bool SessionStore::append(const SeriesPoint* points, size_t count) {
+    if (!valid || count == 0) {
+        return valid;
+    }
+    uint32_t offset = sizeof(header) + stored * sizeof(SeriesPoint);
+    if (!storage.write(SESSION_PATH, offset, points, count * sizeof(SeriesPoint))) {
+        return false;
+    }
+    stored += count;
+    return true;
+}
+
+bool SessionStore::setUploaded(uint32_t uploaded) {
+    if (!valid) {
+        return false;
+    }
+    header.uploaded = uploaded;
+    return writeHeader();
+}
+
+void SessionStore::clear() {
+    if (valid || storage.exists(SESSION_PATH)) {
+        storage.remove(SESSION_PATH);
+    }
+    valid = false;
+    stored = 0;
+}
+
+size_t SessionStore::resume(uint32_t epoch, uint32_t firstSequence, SeriesPoint* out, size_t capacity,
+                            uint32_t& uploaded) {
+    uploaded = 0;
+    if (!valid || epoch == 0 || epoch != header.epoch || firstSequence < header.firstSequence ||
+        firstSequence - header.firstSequence >= stored) {
+        return 0;
+    }
+
+    size_t offset = firstSequence - header.firstSequence;
+    size_t count = stored - offset;
+    if (count > capacity) {
+        count = capacity;
+    }
+    uint32_t position = sizeof(header) + offset * sizeof(SeriesPoint);
+    if (!storage.read(SESSION_PATH, position, out, count * sizeof(SeriesPoint))) {
+        return 0;
+    }
+    if (header.uploaded > offset) {
+        uploaded = header.uploaded - offset;
+        if (uploaded > count) {
+            uploaded = count;
+        }
+    }
+    return count;
+}
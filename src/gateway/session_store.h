@@ -0,0 +1,70 @@
+/*
+ * SESSION_STORE.H - Lote recibido por el gateway, persistido en flash
+ *
+ * Guarda los puntos confirmados con SACK (prefijo contiguo del lote) y
+ * cuántos ya se subieron. Tras un reinicio de cualquiera de los dos lados, el
+ * Solar Node anuncia un lote que empieza en su cabeza del log; si es el mismo
+ * log (época) y esa secuencia cae dentro del lote guardado, el gateway
+ * responde al ACK con los registros que ya tiene y la transferencia sigue
+ * desde ahí. Con el lote ya en la cola de subida, la sesión queda marcada
+ * como subida entera: un TRANSFER_OK perdido hace que el Solar Node anuncie
+ * de nuevo el mismo lote, y el gateway lo confirma sin volver a encolarlo.
+ * Un lote que empieza después del guardado, o de otra época, lo reemplaza.
+ *
+ *   [SessionHeader][SeriesPoint][SeriesPoint]...
+ *
+ * Cada escritura del backend es un commit, así que un corte deja como mucho
+ * sin guardar el último grupo de puntos.
+ */
+
+#ifndef GATEWAY_SESSION_STORE_H
+#define GATEWAY_SESSION_STORE_H
+
+#include <Arduino.h>
+#include "../common/series_codec.h"
+#include "../storage/storage_backend.h"
+
+class SessionStore {
+public:
+    explicit SessionStore(StorageBackend& storage);
+
+    // Carga la sesión guardada, si hay una válida
+    bool begin();
+
+    // Descarta lo anterior y abre un lote nuevo
+    bool start(uint16_t sessionId, uint32_t epoch, uint32_t firstSequence, uint32_t records, uint32_t bytes,
+               uint32_t uploaded);
+    // Agrega puntos a continuación de los ya guardados
+    bool append(const SeriesPoint* points, size_t count);
+    bool setUploaded(uint32_t uploaded);
+    void clear();
+
+    // Puntos guardados desde firstSequence (hasta capacity) y cuántos de ellos
+    // ya se subieron. 0 si la sesión guardada es de otra época del log (o sin
+    // época) o no contiene esa secuencia.
+    size_t resume(uint32_t epoch, uint32_t firstSequence, SeriesPoint* out, size_t capacity, uint32_t& uploaded);
+
+    size_t storedCount() const { return stored; }
+
+private:
+    struct SessionHeader {
+        uint32_t magic;
+        uint32_t epoch;
+        uint32_t firstSequence;
+        uint32_t records;
+        uint32_t bytes;
+        uint32_t uploaded;
+        uint16_t sessionId;
+        uint16_t reserved;
+        uint32_t crc;
+    };
+
+    StorageBackend& storage;
+    SessionHeader header;
+    size_t stored;
+    bool valid;
+
+    bool writeHeader();
+};
+
+#endif
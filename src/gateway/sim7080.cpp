@@ -0,0 +1,545 @@
+/*
+ * SIM7080.CPP - Subida por el módem LTE-M del LilyGo T-SIM7080G
+ */
+
+#include "sim7080.h"
+#include <string.h>
+
+namespace {
+constexpr unsigned long COMMAND_TIMEOUT_MS = 5000;
+constexpr unsigned long PROBE_TIMEOUT_MS = 500;
+// Sondeos AT antes de pulsar PWRKEY: uno perdido (eco, UART recién
+// abierta) no debe llevar a apagar un módem que ya estaba encendido
+constexpr uint8_t PROBE_ATTEMPTS = 3;
+constexpr unsigned long PWRKEY_PULSE_MS = 1000;
+constexpr unsigned long BOOT_TIMEOUT_MS = 15000;
+constexpr unsigned long BOOT_PROBE_MS = 1000;
+constexpr unsigned long ATTACH_TIMEOUT_MS = 120000;
+constexpr unsigned long ATTACH_POLL_MS = 2000;
+constexpr unsigned long PDP_TIMEOUT_MS = 30000;
+constexpr unsigned long HTTP_CONNECT_TIMEOUT_MS = 30000;
+constexpr unsigned long HTTP_BODY_TIMEOUT_MS = 10000;
+constexpr unsigned long HTTP_RESPONSE_TIMEOUT_MS = 60000;
+// Sin pedidos durante este tiempo se corta HTTP y se deja dormir al módem
+constexpr unsigned long MODEM_IDLE_MS = 10000;
+// Plazo para que el módem entre en PSM antes de apagarlo
+constexpr unsigned long PSM_WAIT_MS = 60000;
+// Bytes del cuerpo por llamada a service() tras el prompt de AT+SHBOD
+constexpr size_t BODY_WRITE_CHUNK = 256;
+constexpr unsigned HTTP_HEADER_MAX = 350;
+// PSM: TAU periódico de 1 h (unidad 001 = 1 h) y T3324 de 10 s (000 = 2 s)
+constexpr char PSM_PERIODIC_TAU[] = "00100001";
+constexpr char PSM_ACTIVE_TIME[] = "00000101";
+
+// Campo numérico index (desde 0) de "+XXX: a,b,..."; ignora comillas
+bool fieldUInt(StringView text, size_t index, uint32_t& out) {
+    int colon = text.indexOf(':');
+    if (colon < 0) {
+        return false;
+    }
+    StringView rest = text.substring(static_cast<size_t>(colon) + 1);
+    for (size_t field = 0;; field++) {
+        int comma = rest.indexOf(',');
+        StringView value = (comma < 0 ? rest : rest.substring(0, static_cast<size_t>(comma))).trim();
+        if (field == index) {
+            if (value.length >= 2 && value[0] == '"') {
+                value = value.substring(1, value.length - 1);
+            }
+            return value.toUInt(out);
+        }
+        if (comma < 0) {
+            return false;
+        }
+        rest = rest.substring(static_cast<size_t>(comma) + 1);
+    }
+}
+}  // namespace
+
+Sim7080Uplink::Sim7080Uplink(Stream& modemStream, const Config& modemConfig)
+    : modem(modemStream), config(modemConfig), state(State::Off), step(0), reply(Reply::None), replyDeadline(0),
+      stateSince(0), waitUntil(0), awaitingPrompt(false), promptSeen(false), line(), command(), registration(0),
+      configured(false), pdpActive(false), httpConnected(false), httpStatus(0), payload(), bodyLength(0),
+      bodyWritten(0), contentType(""), jobPending(false), result(Result::Idle),
+      status(0), postStarted(0), postMs(0), bytesUploaded(0), radioOn(false), radioSince(0), radioTotalMs(0),
+      lastActivity(0) {}
+
+void Sim7080Uplink::begin() {
+    pinMode(config.pwrkeyPin, OUTPUT);
+    digitalWrite(config.pwrkeyPin, LOW);
+    enter(State::Off);
+}
+
+bool Sim7080Uplink::available() const {
+    return !jobPending;
+}
+
+unsigned long Sim7080Uplink::radioOnMs() const {
+    return radioTotalMs + (radioOn ? millis() - radioSince : 0);
+}
+
+bool Sim7080Uplink::post(UploadBody& source) {
+    if (jobPending || source.length() > BODY_MAX) {
+        return false;
+    }
+    source.rewind();
+    bodyLength = 0;
+    int c;
+    while (bodyLength < BODY_MAX && (c = source.read()) >= 0) {
+        payload[bodyLength++] = static_cast<uint8_t>(c);
+    }
+    contentType = source.contentType();
+    jobPending = true;
+    result = Result::Pending;
+    httpStatus = 0;
+    postStarted = millis();
+    return true;
+}
+
+Sim7080Uplink::Result Sim7080Uplink::takeResult() {
+    Result current = result;
+    if (current == Result::Done || current == Result::Failed) {
+        result = Result::Idle;
+    }
+    return current;
+}
+
+void Sim7080Uplink::service() {
+    readLines();
+    if (reply == Reply::Pending && static_cast<long>(millis() - replyDeadline) >= 0) {
+        reply = Reply::Timeout;
+        awaitingPrompt = false;
+    }
+
+    switch (state) {
+        case State::Off:
+        case State::Sleeping:
+            if (jobPending) {
+                enter(State::PowerOn);
+            }
+            break;
+        case State::PowerOn:
+            runPowerOn();
+            break;
+        case State::Boot:
+            runBoot();
+            break;
+        case State::Configure:
+            runConfigure();
+            break;
+        case State::Attach:
+            runAttach();
+            break;
+        case State::Activate:
+            runActivate();
+            break;
+        case State::Ready:
+            runReady();
+            break;
+        case State::Http:
+            runHttp();
+            break;
+        case State::Disconnect:
+            runDisconnect();
+            break;
+        case State::PowerDown:
+            runPowerDown();
+            break;
+    }
+}
+
+void Sim7080Uplink::enter(State next) {
+    state = next;
+    step = 0;
+    reply = Reply::None;
+    stateSince = millis();
+    waitUntil = 0;
+}
+
+void Sim7080Uplink::send(const char* text, unsigned long timeoutMs) {
+    modem.write(reinterpret_cast<const uint8_t*>(text), strlen(text));
+    modem.write('\r');
+    reply = Reply::Pending;
+    replyDeadline = millis() + timeoutMs;
+    lastActivity = millis();
+}
+
+void Sim7080Uplink::readLines() {
+    while (modem.available() > 0) {
+        int c = modem.read();
+        if (c < 0) {
+            break;
+        }
+        if (awaitingPrompt && c == '>' && line.length() == 0) {
+            awaitingPrompt = false;
+            promptSeen = true;
+            continue;
+        }
+        if (c == '\r') {
+            continue;
+        }
+        if (c == '\n') {
+            handleLine(line.view().trim());
+            line.clear();
+        } else {
+            line.append(static_cast<char>(c));
+        }
+    }
+}
+
+void Sim7080Uplink::handleLine(StringView text) {
+    if (text.empty()) {
+        return;
+    }
+    uint32_t value = 0;
+    if (text == StringView("OK")) {
+        if (reply == Reply::Pending) {
+            reply = Reply::Ok;
+        }
+    } else if (text == StringView("ERROR") || text.startsWith("+CME ERROR")) {
+        if (reply == Reply::Pending) {
+            Serial.printf("[GATEWAY] SIM7080: %.*s\n", static_cast<int>(text.length), text.data);
+            reply = Reply::Error;
+            awaitingPrompt = false;
+        }
+    } else if (text.startsWith("+CEREG:")) {
+        if (fieldUInt(text, 1, value)) {
+            registration = value;
+        }
+    } else if (text.startsWith("+CNACT: 0,")) {
+        pdpActive = fieldUInt(text, 1, value) && value == 1;
+    } else if (text.startsWith("+APP PDP: 0,")) {
+        pdpActive = text.substring(12) == StringView("ACTIVE");
+    } else if (text.startsWith("+SHREQ:")) {
+        if (fieldUInt(text, 1, value)) {
+            httpStatus = static_cast<int>(value);
+        }
+    } else if (text == StringView("+CPSMSTATUS: \"ENTER PSM\"")) {
+        setRadio(false);
+        // Sin pedido en curso el módem puede dormirse antes del corte por
+        // inactividad; la sesión HTTP no sobrevive a PSM
+        if (state == State::Ready || state == State::Disconnect) {
+            Serial.printf("[GATEWAY] SIM7080: en PSM; radio encendida %lu ms en total.\n", radioOnMs());
+            httpConnected = false;
+            enter(State::Sleeping);
+        }
+    } else if (text == StringView("+CPSMSTATUS: \"EXIT PSM\"")) {
+        // También sale solo para el TAU periódico
+        setRadio(true);
+    } else if (text == StringView("NORMAL POWER DOWN")) {
+        setRadio(false);
+    }
+}
+
+void Sim7080Uplink::setRadio(bool on) {
+    if (on && !radioOn) {
+        radioOn = true;
+        radioSince = millis();
+    } else if (!on && radioOn) {
+        radioOn = false;
+        radioTotalMs += millis() - radioSince;
+    }
+}
+
+void Sim7080Uplink::finishJob(bool success) {
+    jobPending = false;
+    result = success ? Result::Done : Result::Failed;
+    status = httpStatus;
+    postMs = millis() - postStarted;
+    if (success) {
+        bytesUploaded += bodyLength;
+    }
+}
+
+// Fallo del enlace: el POST en curso termina como Failed y quien sube decide
+// cuándo reintentar; el llamador decide si además se apaga
+void Sim7080Uplink::fail(const char* reason) {
+    Serial.printf("[GATEWAY] SIM7080: %s.\n", reason);
+    if (jobPending) {
+        finishJob(false);
+    }
+}
+
+// Si ya responde (reinicio del ESP32 con el módem encendido) no se pulsa
+// PWRKEY: el mismo pulso que lo enciende o lo despierta de PSM lo apagaría.
+// step cuenta los sondeos sin respuesta; en PROBE_ATTEMPTS se pulsa
+void Sim7080Uplink::runPowerOn() {
+    if (step < PROBE_ATTEMPTS) {
+        if (reply == Reply::Pending) {
+            return;
+        }
+        if (reply == Reply::Ok) {
+            setRadio(true);
+            enter(configured ? State::Attach : State::Configure);
+            return;
+        }
+        if (reply != Reply::None) {
+            step++;
+        }
+        if (step < PROBE_ATTEMPTS) {
+            send("AT", PROBE_TIMEOUT_MS);
+            return;
+        }
+        digitalWrite(config.pwrkeyPin, HIGH);
+        setRadio(true);
+        waitUntil = millis() + PWRKEY_PULSE_MS;
+    } else if (static_cast<long>(millis() - waitUntil) >= 0) {
+        digitalWrite(config.pwrkeyPin, LOW);
+        enter(State::Boot);
+    }
+}
+
+void Sim7080Uplink::runBoot() {
+    if (reply == Reply::Pending) {
+        return;
+    }
+    if (reply == Reply::Ok) {
+        enter(configured ? State::Attach : State::Configure);
+        return;
+    }
+    if (millis() - stateSince > BOOT_TIMEOUT_MS) {
+        fail("el módem no responde");
+        setRadio(false);
+        configured = false;
+        enter(State::Off);
+        return;
+    }
+    if (reply == Reply::None || static_cast<long>(millis() - waitUntil) >= 0) {
+        waitUntil = millis() + BOOT_PROBE_MS;
+        send("AT", BOOT_PROBE_MS);
+    }
+}
+
+void Sim7080Uplink::runConfigure() {
+    if (reply == Reply::Pending) {
+        return;
+    }
+    if (reply == Reply::Error || reply == Reply::Timeout) {
+        fail("configuración rechazada");
+        enter(State::PowerDown);
+        return;
+    }
+    if (reply == Reply::Ok) {
+        step++;
+    }
+
+    command.clear();
+    switch (step) {
+        case 0:
+            command.append("ATE0");
+            break;
+        case 1:
+            command.append("AT+CMEE=2");
+            break;
+        case 2:
+            // LTE-M únicamente
+            command.append("AT+CNMP=38");
+            break;
+        case 3:
+            command.append("AT+CMNB=1");
+            break;
+        case 4:
+            command.appendf("AT+CGDCONT=1,\"IP\",\"%s\"", config.apn);
+            break;
+        case 5:
+            command.append("AT+CPSMSTATUS=1");
+            break;
+        case 6:
+            command.appendf("AT+CPSMS=1,,,\"%s\",\"%s\"", PSM_PERIODIC_TAU, PSM_ACTIVE_TIME);
+            break;
+        case 7:
+            command.append("AT+CSSLCFG=\"sslversion\",1,3");
+            break;
+        case 8:
+            // Sin CA: no se verifica el certificado, igual que el cliente Wi-Fi sin HTTP_ROOT_CA
+            command.append("AT+SHSSL=1,\"\"");
+            break;
+        default:
+            configured = true;
+            enter(State::Attach);
+            return;
+    }
+    send(command.c_str(), COMMAND_TIMEOUT_MS);
+}
+
+void Sim7080Uplink::runAttach() {
+    if (reply == Reply::Pending) {
+        return;
+    }
+    if (reply == Reply::Ok && (registration == 1 || registration == 5)) {
+        enter(State::Activate);
+        return;
+    }
+    if (millis() - stateSince > ATTACH_TIMEOUT_MS) {
+        fail("sin registro en la red");
+        enter(State::PowerDown);
+        return;
+    }
+    if (reply != Reply::None) {
+        waitUntil = millis() + ATTACH_POLL_MS;
+        reply = Reply::None;
+    }
+    if (static_cast<long>(millis() - waitUntil) >= 0) {
+        registration = 0;
+        send("AT+CEREG?", COMMAND_TIMEOUT_MS);
+    }
+}
+
+void Sim7080Uplink::runActivate() {
+    if (reply == Reply::Pending) {
+        return;
+    }
+    switch (step) {
+        case 0:
+            if (reply == Reply::None) {
+                pdpActive = false;
+                send("AT+CNACT?", COMMAND_TIMEOUT_MS);
+            } else if (reply == Reply::Ok && pdpActive) {
+                enter(State::Ready);
+            } else {
+                step = 1;
+                send("AT+CNACT=0,1", COMMAND_TIMEOUT_MS);
+            }
+            break;
+        case 1:
+            if (reply != Reply::Ok) {
+                fail("no se pudo activar el contexto PDP");
+                enter(State::PowerDown);
+            } else {
+                step = 2;
+            }
+            break;
+        default:
+            if (pdpActive) {
+                Serial.printf("[GATEWAY] SIM7080: conectado en %lu ms.\n", millis() - postStarted);
+                enter(State::Ready);
+            } else if (millis() - stateSince > PDP_TIMEOUT_MS) {
+                fail("el contexto PDP no se activó");
+                enter(State::PowerDown);
+            }
+            break;
+    }
+}
+
+void Sim7080Uplink::runReady() {
+    if (jobPending) {
+        enter(State::Http);
+    } else if (millis() - lastActivity >= MODEM_IDLE_MS) {
+        enter(State::Disconnect);
+    }
+}
+
+// La sesión HTTPS (AT+SHCONN) queda abierta entre pedidos seguidos, como
+// el keep-alive del cliente Wi-Fi
+void Sim7080Uplink::runHttp() {
+    if (step == 6 && reply == Reply::Pending && promptSeen && bodyWritten < bodyLength) {
+        size_t count = bodyLength - bodyWritten < BODY_WRITE_CHUNK ? bodyLength - bodyWritten : BODY_WRITE_CHUNK;
+        modem.write(payload + bodyWritten, count);
+        bodyWritten += count;
+        return;
+    }
+    if (step == 8) {
+        if (httpStatus != 0) {
+            finishJob(httpStatus >= 200 && httpStatus < 300);
+            enter(State::Ready);
+        } else if (static_cast<long>(millis() - waitUntil) >= 0) {
+            httpConnected = false;
+            fail("sin respuesta HTTP");
+            enter(State::PowerDown);
+        }
+        return;
+    }
+    if (reply == Reply::Pending) {
+        return;
+    }
+    if (reply == Reply::Error || reply == Reply::Timeout) {
+        httpConnected = false;
+        fail("pedido HTTP fallido");
+        enter(State::PowerDown);
+        return;
+    }
+    if (reply == Reply::None) {
+        step = httpConnected ? 4 : 0;
+    } else {
+        if (step == 3) {
+            httpConnected = true;
+        }
+        step++;
+    }
+
+    command.clear();
+    unsigned long timeoutMs = COMMAND_TIMEOUT_MS;
+    switch (step) {
+        case 0:
+            command.appendf("AT+SHCONF=\"URL\",\"https://%s:%u\"", config.host, config.port);
+            break;
+        case 1:
+            command.appendf("AT+SHCONF=\"BODYLEN\",%u", static_cast<unsigned>(BODY_MAX));
+            break;
+        case 2:
+            command.appendf("AT+SHCONF=\"HEADERLEN\",%u", HTTP_HEADER_MAX);
+            break;
+        case 3:
+            command.append("AT+SHCONN");
+            timeoutMs = HTTP_CONNECT_TIMEOUT_MS;
+            break;
+        case 4:
+            command.append("AT+SHCHEAD");
+            break;
+        case 5:
+            command.appendf("AT+SHAHEAD=\"Content-Type\",\"%s\"", contentType);
+            break;
+        case 6:
+            command.appendf("AT+SHBOD=%u,%lu", static_cast<unsigned>(bodyLength), HTTP_BODY_TIMEOUT_MS);
+            bodyWritten = 0;
+            promptSeen = false;
+            awaitingPrompt = true;
+            timeoutMs = HTTP_BODY_TIMEOUT_MS;
+            break;
+        case 7:
+            httpStatus = 0;
+            command.appendf("AT+SHREQ=\"%s\",3", config.path);
+            break;
+        default:
+            // El código llega después del OK, en +SHREQ: "POST",<código>,<largo>
+            step = 8;
+            waitUntil = millis() + HTTP_RESPONSE_TIMEOUT_MS;
+            return;
+    }
+    send(command.c_str(), timeoutMs);
+}
+
+// Corta la sesión HTTP y espera a que el módem entre en PSM por su cuenta
+void Sim7080Uplink::runDisconnect() {
+    if (reply == Reply::Pending) {
+        return;
+    }
+    if (step == 0) {
+        step = 1;
+        if (httpConnected) {
+            httpConnected = false;
+            send("AT+SHDISC", COMMAND_TIMEOUT_MS);
+            return;
+        }
+    }
+    if (jobPending) {
+        enter(State::Ready);
+    } else if (millis() - stateSince > PSM_WAIT_MS) {
+        Serial.println("[GATEWAY] SIM7080: la red no concedió PSM, se apaga el módem.");
+        enter(State::PowerDown);
+    }
+}
+
+void Sim7080Uplink::runPowerDown() {
+    if (reply == Reply::None) {
+        send("AT+CPOWD=1", COMMAND_TIMEOUT_MS);
+        return;
+    }
+    if (reply == Reply::Pending) {
+        return;
+    }
+    setRadio(false);
+    configured = false;
+    pdpActive = false;
+    httpConnected = false;
+    enter(State::Off);
+}
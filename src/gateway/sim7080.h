@@ -0,0 +1,127 @@
+/*
+ * SIM7080.H - Subida por el módem LTE-M del LilyGo T-SIM7080G
+ *
+ * Máquina de estados sin bloqueos sobre comandos AT: service() se llama en
+ * cada loop() y avanza un paso cuando llega la respuesta esperada, así que
+ * la recepción del Solar Node sigue atendida mientras el módem se registra
+ * o sube. Un POST recorre, según de dónde parta:
+ *
+ *   Off ─ PowerOn ─ Boot ─ Configure ─ Attach ─ Activate ─ Ready ─ Http
+ *                  Sleeping ─┘ (despierta por PWRKEY, conserva el registro)
+ *
+ * Entre subidas el módem queda en PSM (AT+CPSMS): tras un rato sin pedidos
+ * se corta la sesión HTTP y el módem duerme solo al vencer T3324. Si la red
+ * no concede PSM se apaga con AT+CPOWD. La cola de subida junta lotes antes
+ * de cada POST, así que el módem despierta una vez por subida, no por lote.
+ *
+ * Sólo depende de un Stream, de millis() y del pin de PWRKEY, para probarlo
+ * en el host contra un módem simulado (test/host/test_sim7080.cpp). La
+ * métrica principal es el tiempo de radio encendida por KB subido.
+ */
+
+#ifndef GATEWAY_SIM7080_H
+#define GATEWAY_SIM7080_H
+
+#include <Arduino.h>
+#include "../common/fixed_string.h"
+#include "upload_body.h"
+
+class Sim7080Uplink {
+public:
+    // AT+SHBOD acepta a lo sumo 4096 bytes por pedido
+    static constexpr size_t BODY_MAX = 4096;
+
+    struct Config {
+        const char* host;
+        uint16_t port;
+        const char* path;
+        const char* apn;
+        int pwrkeyPin;           // en la placa, HIGH baja PWRKEY del módem
+    };
+
+    enum class Result : uint8_t { Idle, Pending, Done, Failed };
+
+    Sim7080Uplink(Stream& modem, const Config& config);
+
+    void begin();
+    void service();
+
+    // Copia el cuerpo y arranca el POST; false si hay otro en curso o si no
+    // cabe en BODY_MAX
+    bool post(UploadBody& body);
+    // Pending mientras corre; Done/Failed una sola vez, luego Idle
+    Result takeResult();
+    // false mientras hay un POST en curso
+    bool available() const;
+
+    int lastStatus() const { return status; }
+    unsigned long lastPostMs() const { return postMs; }
+    uint32_t uploadedBytes() const { return bytesUploaded; }
+    // Tiempo de radio encendida desde el arranque, incluido el período actual
+    unsigned long radioOnMs() const;
+
+private:
+    enum class State : uint8_t {
+        Off, PowerOn, Boot, Configure, Attach, Activate, Ready, Http, Disconnect, Sleeping, PowerDown
+    };
+    enum class Reply : uint8_t { None, Pending, Ok, Error, Timeout };
+
+    static constexpr size_t LINE_MAX = 128;
+    static constexpr size_t COMMAND_MAX = 160;
+
+    Stream& modem;
+    Config config;
+    State state;
+    uint8_t step;
+    Reply reply;
+    unsigned long replyDeadline;
+    unsigned long stateSince;
+    unsigned long waitUntil;
+    bool awaitingPrompt;
+    bool promptSeen;
+    FixedString<LINE_MAX> line;
+    FixedString<COMMAND_MAX> command;
+
+    // Respuestas con datos, de la línea +XXX: previa al OK o de un URC
+    uint32_t registration;
+    bool configured;
+    bool pdpActive;
+    bool httpConnected;
+    int httpStatus;
+
+    uint8_t payload[BODY_MAX];
+    size_t bodyLength;
+    size_t bodyWritten;
+    const char* contentType;
+    bool jobPending;
+    Result result;
+
+    int status;
+    unsigned long postStarted;
+    unsigned long postMs;
+    uint32_t bytesUploaded;
+    bool radioOn;
+    unsigned long radioSince;
+    unsigned long radioTotalMs;
+    unsigned long lastActivity;
+
+    void enter(State next);
+    void send(const char* text, unsigned long timeoutMs);
+    void readLines();
+    void handleLine(StringView text);
+    void setRadio(bool on);
+    void finishJob(bool success);
+    void fail(const char* reason);
+
+    void runPowerOn();
+    void runBoot();
+    void runConfigure();
+    void runAttach();
+    void runActivate();
+    void runReady();
+    void runHttp();
+    void runDisconnect();
+    void runPowerDown();
+};
+
+#endif
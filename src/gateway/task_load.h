@@ -0,0 +1,33 @@
+/*
+ * TASK_LOAD.H - Tiempo ocupado de cada tarea del gateway
+ *
+ * El core de Arduino compila FreeRTOS sin configGENERATE_RUN_TIME_STATS,
+ * así que no hay CPU por tarea del sistema. Cada tarea suma aquí los micros()
+ * de su trabajo, sin las esperas, y loop() lo reporta como fracción de la
+ * ventana transcurrida. Se suma desde una tarea y se lee desde otra.
+ */
+
+#ifndef GATEWAY_TASK_LOAD_H
+#define GATEWAY_TASK_LOAD_H
+
+#include <Arduino.h>
+#include <atomic>
+
+class TaskLoad {
+public:
+    TaskLoad() : busy(0) {}
+
+    // Tramo de trabajo que empezó en started (micros())
+    void add(uint32_t started) { busy.fetch_add(static_cast<uint32_t>(micros()) - started, std::memory_order_relaxed); }
+
+    // Por mil del tiempo ocupado en una ventana de windowUs; la reinicia
+    uint32_t takePermille(uint32_t windowUs) {
+        uint64_t spent = busy.exchange(0, std::memory_order_relaxed);
+        return windowUs > 0 ? static_cast<uint32_t>(spent * 1000 / windowUs) : 0;
+    }
+
+private:
+    std::atomic<uint32_t> busy;
+};
+
+#endif
@@ -0,0 +1,83 @@
+/*
+ * UPLINK.CPP - Conexión HTTPS persistente hacia el endpoint de subida
+ */
+
+#include "uplink.h"
+
+HttpUplink::HttpUplink(const char* endpointHost, uint16_t endpointPort, const char* endpointPath, const char* rootCa)
+    : host(endpointHost), port(endpointPort), path(endpointPath), tls(), http(), lastUse(0), requestCount(0),
+      reusedCount(0), connectCount(0), connectTotalMs(0) {
+    if (rootCa != nullptr) {
+        tls.setCACert(rootCa);
+    } else {
+        tls.setInsecure();
+    }
+    // Con reuse HTTPClient pide keep-alive y end() no cierra la conexión
+    // salvo que el servidor responda "Connection: close"
+    http.setReuse(true);
+}
+
+bool HttpUplink::connect(UplinkTiming& timing) {
+    unsigned long start = millis();
+    bool connected = tls.connect(host, port);
+    timing.connectMs = millis() - start;
+    if (!connected) {
+        Serial.printf("[GATEWAY] ERROR: No se pudo conectar a %s:%u (%lu ms).\n", host, port, timing.connectMs);
+        return false;
+    }
+    connectCount++;
+    connectTotalMs += timing.connectMs;
+    return true;
+}
+
+bool HttpUplink::post(UploadBody& body, UplinkTiming& timing) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        timing = UplinkTiming();
+        timing.reused = tls.connected();
+        if (!timing.reused && !connect(timing)) {
+            return false;
+        }
+
+        // HTTPClient usa la conexión ya abierta en vez de abrir otra
+        http.begin(tls, host, port, path, true);
+        http.addHeader("Content-Type", body.contentType());
+        body.rewind();
+        unsigned long start = millis();
+        timing.status = http.sendRequest("POST", &body, body.length());
+        if (timing.status > 0) {
+            // La respuesta se lee entera para dejar la conexión lista para el próximo pedido
+            http.getString();
+        }
+        timing.transferMs = millis() - start;
+        http.end();
+        lastUse = millis();
+
+        if (timing.status < 0) {
+            tls.stop();
+            if (timing.reused) {
+                // El servidor cerró la conexión ociosa sin que se notara:
+                // se repite una vez sobre una conexión nueva
+                continue;
+            }
+            Serial.printf("[GATEWAY] ERROR: HTTP POST falló: %s\n", HTTPClient::errorToString(timing.status).c_str());
+            return false;
+        }
+        requestCount++;
+        if (timing.reused) {
+            reusedCount++;
+        }
+        return timing.status >= 200 && timing.status < 300;
+    }
+    return false;
+}
+
+void HttpUplink::closeIfIdle(unsigned long idleMs) {
+    if (tls.connected() && millis() - lastUse >= idleMs) {
+        close();
+    }
+}
+
+void HttpUplink::close() {
+    http.end();
+    tls.stop();
+}
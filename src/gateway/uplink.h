@@ -0,0 +1,61 @@
+/*
+ * UPLINK.H - Conexión HTTPS persistente hacia el endpoint de subida
+ *
+ * Cada subida abría su propia conexión (TCP + handshake TLS) y la cerraba
+ * al terminar; con varios tramos seguidos el handshake costaba más que el
+ * envío. HttpUplink conserva la conexión entre pedidos (keep-alive) mientras
+ * el servidor la acepte, y mide por separado la conexión y el envío de cada
+ * pedido para ver cuánto se ahorra.
+ *
+ * El servidor cierra las conexiones ociosas a su ritmo: closeIfIdle() la
+ * cierra antes de ese plazo, y un pedido que falla sobre una conexión
+ * reutilizada se repite una vez sobre una nueva.
+ */
+
+#ifndef GATEWAY_UPLINK_H
+#define GATEWAY_UPLINK_H
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
+#include "upload_body.h"
+
+struct UplinkTiming {
+    bool reused = false;             // el pedido salió por una conexión ya abierta
+    unsigned long connectMs = 0;     // TCP + handshake TLS; 0 si se reutilizó
+    unsigned long transferMs = 0;    // envío del cuerpo hasta la respuesta
+    int status = 0;                  // código HTTP o error de HTTPClient (< 0)
+};
+
+class HttpUplink {
+public:
+    // rootCa en PEM; nullptr acepta cualquier certificado (endpoint de pruebas)
+    HttpUplink(const char* host, uint16_t port, const char* path, const char* rootCa);
+
+    // POST del cuerpo completo; true con respuesta 2xx
+    bool post(UploadBody& body, UplinkTiming& timing);
+    void closeIfIdle(unsigned long idleMs);
+    void close();
+
+    uint32_t requests() const { return requestCount; }
+    uint32_t reusedRequests() const { return reusedCount; }
+    uint32_t connects() const { return connectCount; }
+    // Promedio de TCP + TLS por conexión abierta
+    unsigned long averageConnectMs() const { return connectCount > 0 ? connectTotalMs / connectCount : 0; }
+
+private:
+    const char* host;
+    uint16_t port;
+    const char* path;
+    WiFiClientSecure tls;
+    HTTPClient http;
+    unsigned long lastUse;
+    uint32_t requestCount;
+    uint32_t reusedCount;
+    uint32_t connectCount;
+    unsigned long connectTotalMs;
+
+    bool connect(UplinkTiming& timing);
+};
+
+#endif
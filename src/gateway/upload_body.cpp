@@ -0,0 +1,69 @@
+/*
+ * UPLOAD_BODY.CPP - Cuerpo de una subida, generado a medida que se lee
+ */
+
+#include "upload_body.h"
+#include <string.h>
+
+UploadBody::UploadBody(const UploadSegment* list, size_t count)
+    : segments(list), segmentCount(count), nextSegment(0), nextRecord(0), piece(), pieceLength(0), total(0),
+      consumed(0), pieceOffset(0) {}
+
+void UploadBody::measure() {
+    rewind();
+    while (nextPiece()) {
+        total += pieceLength;
+    }
+    rewind();
+}
+
+size_t UploadBody::records() const {
+    size_t count = 0;
+    for (size_t i = 0; i < segmentCount; i++) {
+        count += segments[i].count;
+    }
+    return count;
+}
+
+void UploadBody::rewind() {
+    consumed = 0;
+    nextSegment = 0;
+    nextRecord = 0;
+    pieceLength = 0;
+    pieceOffset = 0;
+    restart();
+}
+
+bool UploadBody::nextPiece() {
+    pieceLength = 0;
+    pieceOffset = 0;
+    return fill();
+}
+
+void UploadBody::setPiece(const void* data, size_t length) {
+    pieceLength = length < PIECE_MAX ? length : PIECE_MAX;
+    memcpy(piece, data, pieceLength);
+}
+
+int UploadBody::available() {
+    size_t remaining = total - consumed;
+    return remaining > INT32_MAX ? INT32_MAX : static_cast<int>(remaining);
+}
+
+int UploadBody::peek() {
+    while (pieceOffset >= pieceLength) {
+        if (!nextPiece()) {
+            return -1;
+        }
+    }
+    return piece[pieceOffset];
+}
+
+int UploadBody::read() {
+    int c = peek();
+    if (c >= 0) {
+        pieceOffset++;
+        consumed++;
+    }
+    return c;
+}
@@ -0,0 +1,69 @@
+/*
+ * UPLOAD_BODY.H - Cuerpo de una subida, generado a medida que se lee
+ *
+ * HTTPClient::sendRequest() lee el cuerpo de un Stream. Las subclases arman
+ * el cuerpo pieza por pieza (encabezado de un lote, un registro, cierre)
+ * desde los puntos de la cola, así que la memoria de la subida es la de una
+ * pieza sin importar cuántos registros lleve. El largo total se conoce antes
+ * de enviar (Content-Length) armando una vez todas las piezas.
+ */
+
+#ifndef GATEWAY_UPLOAD_BODY_H
+#define GATEWAY_UPLOAD_BODY_H
+
+#include <Arduino.h>
+#include "../common/series_codec.h"
+
+// Registros consecutivos de una sesión dentro de una subida
+struct UploadSegment {
+    uint16_t sessionId;
+    const SeriesPoint* points;
+    size_t count;
+};
+
+class UploadBody : public Stream {
+public:
+    // Bytes del cuerpo completo (Content-Length)
+    size_t length() const { return total; }
+    size_t records() const;
+    // Vuelve al principio, p.ej. para repetir el pedido por otra conexión
+    void rewind();
+    virtual const char* contentType() const = 0;
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    // Sólo lectura
+    size_t write(uint8_t) override { return 0; }
+    size_t write(const uint8_t*, size_t) override { return 0; }
+
+protected:
+    static constexpr size_t PIECE_MAX = 112;
+
+    // segments debe seguir vivo mientras se lee el cuerpo
+    UploadBody(const UploadSegment* segments, size_t count);
+    // Las subclases lo llaman al final de su constructor
+    void measure();
+
+    // Agrega a piece (vacía) la próxima pieza; false al terminar el cuerpo
+    virtual bool fill() = 0;
+    // Vuelve la subclase a la primera pieza
+    virtual void restart() = 0;
+    void setPiece(const void* data, size_t length);
+
+    const UploadSegment* segments;
+    size_t segmentCount;
+    size_t nextSegment;
+    size_t nextRecord;
+    uint8_t piece[PIECE_MAX];
+    size_t pieceLength;
+
+private:
+    size_t total;
+    size_t consumed;
+    size_t pieceOffset;
+
+    bool nextPiece();
+};
+
+#endif
@@ -0,0 +1,232 @@
+/*
+ * UPLOAD_QUEUE.CPP - Cola persistente de lotes por subir
+ */
+
+#include "upload_queue.h"
+#include <stddef.h>
+#include "../common/crc32.h"
+#include "../common/fixed_string.h"
+
+namespace {
+constexpr char INDEX_PATH[] = "/gw_queue.bin";
+constexpr uint32_t INDEX_MAGIC = 0x51554555;  // "QUEU"
+constexpr uint32_t ENTRY_MAGIC = 0x51424154;  // "QBAT"
+
+using EntryPath = FixedString<STORAGE_PATH_MAX>;
+
+void entryPath(uint32_t number, EntryPath& path) {
+    path.clear();
+    path.appendf("/gw_q%lu.bin", static_cast<unsigned long>(number));
+}
+}  // namespace
+
+UploadQueue::UploadQueue(StorageBackend& backend)
+    : storage(backend), head(0), tail(0), pending(0), front(), frontLoaded(false) {}
+
+bool UploadQueue::begin() {
+    head = 0;
+    tail = 0;
+    pending = 0;
+    frontLoaded = false;
+
+    QueueIndex index;
+    if (storage.exists(INDEX_PATH)) {
+        if (storage.size(INDEX_PATH) == sizeof(index) &&
+            storage.read(INDEX_PATH, 0, &index, sizeof(index)) &&
+            index.magic == INDEX_MAGIC &&
+            index.crc == crc32(&index, offsetof(QueueIndex, crc)) &&
+            index.tail - index.head <= MAX_ENTRIES) {
+            head = index.head;
+            tail = index.tail;
+        } else {
+            Serial.println("[GATEWAY] WARN: Índice de la cola de subida inválido, se descarta.");
+            storage.remove(INDEX_PATH);
+        }
+    }
+
+    countPending();
+    loadFront();
+    if (!empty()) {
+        Serial.printf("[GATEWAY] Cola de subida: %lu lotes, %lu registros pendientes.\n",
+                      static_cast<unsigned long>(entries()), static_cast<unsigned long>(pending));
+    }
+    return true;
+}
+
+void UploadQueue::countPending() {
+    pending = 0;
+    for (uint32_t number = head; number != tail; number++) {
+        EntryHeader header;
+        if (readEntryHeader(number, header)) {
+            pending += header.records - header.uploaded;
+        }
+    }
+}
+
+bool UploadQueue::writeIndex() {
+    QueueIndex index;
+    index.magic = INDEX_MAGIC;
+    index.head = head;
+    index.tail = tail;
+    index.crc = crc32(&index, offsetof(QueueIndex, crc));
+    return storage.write(INDEX_PATH, 0, &index, sizeof(index));
+}
+
+bool UploadQueue::writeEntryHeader(uint32_t number, EntryHeader& header) {
+    EntryPath path;
+    entryPath(number, path);
+    header.crc = crc32(&header, offsetof(EntryHeader, crc));
+    return storage.write(path.c_str(), 0, &header, sizeof(header));
+}
+
+bool UploadQueue::readEntryHeader(uint32_t number, EntryHeader& header) {
+    EntryPath path;
+    entryPath(number, path);
+    return storage.size(path.c_str()) >= sizeof(header) &&
+           storage.read(path.c_str(), 0, &header, sizeof(header)) &&
+           header.magic == ENTRY_MAGIC &&
+           header.crc == crc32(&header, offsetof(EntryHeader, crc)) &&
+           header.uploaded <= header.records &&
+           storage.size(path.c_str()) >= sizeof(header) + header.records * sizeof(SeriesPoint);
+}
+
+bool UploadQueue::push(uint16_t sessionId, uint32_t firstSequence, const SeriesPoint* points, size_t count,
+                       size_t uploaded) {
+    if (uploaded >= count) {
+        return uploaded == count;  // ya subido entero antes de un reinicio
+    }
+    if (entries() >= MAX_ENTRIES) {
+        return false;
+    }
+
+    // Un archivo con este número sólo puede ser un resto de un corte previo
+    EntryPath path;
+    entryPath(tail, path);
+    storage.remove(path.c_str());
+
+    EntryHeader header = {};
+    header.magic = ENTRY_MAGIC;
+    header.firstSequence = firstSequence;
+    header.records = count;
+    header.uploaded = uploaded;
+    header.sessionId = sessionId;
+    if (!writeEntryHeader(tail, header) ||
+        (count > 0 && !storage.write(path.c_str(), sizeof(header), points, count * sizeof(SeriesPoint)))) {
+        storage.remove(path.c_str());
+        return false;
+    }
+
+    tail++;
+    if (!writeIndex()) {
+        tail--;
+        storage.remove(path.c_str());
+        return false;
+    }
+    pending += count - uploaded;
+    return true;
+}
+
+bool UploadQueue::loadFront() {
+    while (!frontLoaded && !empty()) {
+        if (readEntryHeader(head, front)) {
+            if (front.uploaded < front.records) {
+                frontLoaded = true;
+            } else {
+                dropFront();  // corte entre el último commit y el borrado
+            }
+        } else {
+            Serial.printf("[GATEWAY] WARN: Lote %lu de la cola ilegible, se descarta.\n",
+                          static_cast<unsigned long>(head));
+            dropFront();
+            // Sin header no se sabe cuántos registros tenía
+            countPending();
+        }
+    }
+    return frontLoaded;
+}
+
+void UploadQueue::dropFront() {
+    EntryPath path;
+    entryPath(head, path);
+    storage.remove(path.c_str());
+    head++;
+    frontLoaded = false;
+    writeIndex();
+}
+
+bool UploadQueue::readPoints(uint32_t number, uint32_t first, SeriesPoint* out, size_t count) {
+    EntryPath path;
+    entryPath(number, path);
+    uint32_t offset = sizeof(EntryHeader) + first * sizeof(SeriesPoint);
+    if (!storage.read(path.c_str(), offset, out, count * sizeof(SeriesPoint))) {
+        Serial.printf("[GATEWAY] WARN: No se pudo leer el lote %lu de la cola.\n", static_cast<unsigned long>(number));
+        return false;
+    }
+    return true;
+}
+
+size_t UploadQueue::peek(SeriesPoint* out, size_t capacity, UploadSegment* segments, size_t maxSegments,
+                         size_t& segmentCount) {
+    segmentCount = 0;
+    if (!loadFront()) {
+        return 0;
+    }
+
+    size_t total = 0;
+    uint32_t number = head;
+    while (number != tail && total < capacity && segmentCount < maxSegments) {
+        EntryHeader header;
+        if (number == head) {
+            header = front;
+        } else if (!readEntryHeader(number, header)) {
+            break;  // loadFront() lo descarta cuando llegue al frente
+        }
+
+        size_t count = header.records - header.uploaded;
+        if (count > capacity - total) {
+            count = capacity - total;
+        }
+        if (!readPoints(number, header.uploaded, out + total, count)) {
+            if (number != head) {
+                break;  // se descarta cuando llegue al frente
+            }
+            // Un frente ilegible trabaría la cola para siempre
+            Serial.printf("[GATEWAY] WARN: Lote %lu de la cola sin datos legibles, se descarta (%lu registros).\n",
+                          static_cast<unsigned long>(head),
+                          static_cast<unsigned long>(front.records - front.uploaded));
+            pending -= front.records - front.uploaded;
+            dropFront();
+            if (!loadFront()) {
+                break;
+            }
+            number = head;
+            continue;
+        }
+        segments[segmentCount++] = UploadSegment{header.sessionId, out + total, count};
+        total += count;
+        number++;
+    }
+    return total;
+}
+
+bool UploadQueue::commit(size_t count) {
+    while (count > 0) {
+        if (!loadFront()) {
+            return false;
+        }
+
+        size_t take = front.records - front.uploaded;
+        if (take > count) {
+            take = count;
+        }
+        count -= take;
+        front.uploaded += take;
+        pending -= take;
+        if (front.uploaded >= front.records) {
+            dropFront();
+        } else if (!writeEntryHeader(head, front)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,91 @@
+/*
+ * UPLOAD_QUEUE.H - Cola persistente de lotes por subir
+ *
+ * El gateway guarda cada lote completo aquí y confirma al Solar Node con
+ * TRANSFER_OK sin esperar la red; la tarea de subida la vacía hacia el
+ * uplink por tramos con su propio ritmo de reintentos. No se protege sola:
+ * quien la comparte entre tareas la usa bajo un mutex. Un lote por archivo,
+ * en orden:
+ *
+ *   /gw_queue.bin     índice: primer y siguiente número de lote
+ *   /gw_q<n>.bin      [EntryHeader][SeriesPoint][SeriesPoint]...
+ *
+ * Un lote entra a la cola recién cuando su archivo está escrito (el índice
+ * se actualiza después), y cada tramo subido se anota en su header, así que
+ * un reinicio no pierde lotes ni vuelve a subir tramos confirmados.
+ */
+
+#ifndef GATEWAY_UPLOAD_QUEUE_H
+#define GATEWAY_UPLOAD_QUEUE_H
+
+#include <Arduino.h>
+#include "../common/series_codec.h"
+#include "../storage/storage_backend.h"
+#include "upload_body.h"
+
+class UploadQueue {
+public:
+    // Lotes como máximo en la cola; llena, el gateway sube el lote directo
+    // antes de responder (TRANSFER_FAIL sólo si esa subida también falla)
+    static constexpr uint32_t MAX_ENTRIES = 32;
+
+    explicit UploadQueue(StorageBackend& storage);
+
+    // Carga el índice y descarta lotes ilegibles al frente
+    bool begin();
+
+    // uploaded: registros del principio ya subidos (sesión reanudada)
+    bool push(uint16_t sessionId, uint32_t firstSequence, const SeriesPoint* points, size_t count,
+              size_t uploaded);
+
+    bool empty() const { return head == tail; }
+    uint32_t entries() const { return tail - head; }
+    uint32_t pendingRecords() const { return pending; }
+
+    // Próximos registros sin subir desde el frente, siguiendo con los lotes
+    // de atrás hasta llenar capacity o maxSegments tramos (uno por lote);
+    // segments apunta dentro de out. Devuelve el total de registros.
+    size_t peek(SeriesPoint* out, size_t capacity, UploadSegment* segments, size_t maxSegments,
+                size_t& segmentCount);
+    // Anota count registros como subidos, en orden desde el frente; borra
+    // cada lote al completarlo
+    bool commit(size_t count);
+
+private:
+    struct QueueIndex {
+        uint32_t magic;
+        uint32_t head;
+        uint32_t tail;
+        uint32_t crc;
+    };
+
+    struct EntryHeader {
+        uint32_t magic;
+        uint32_t firstSequence;
+        uint32_t records;
+        uint32_t uploaded;
+        uint16_t sessionId;
+        uint16_t reserved;
+        uint32_t crc;
+    };
+
+    StorageBackend& storage;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t pending;
+    EntryHeader front;
+    bool frontLoaded;
+
+    bool writeIndex();
+    bool writeEntryHeader(uint32_t number, EntryHeader& header);
+    bool readEntryHeader(uint32_t number, EntryHeader& header);
+    // Deja en front el primer lote legible, descartando los que no lo son
+    bool loadFront();
+    // Suma lo pendiente de los lotes legibles (al arrancar o tras descartar
+    // uno cuyo header no se pudo leer)
+    void countPending();
+    void dropFront();
+    bool readPoints(uint32_t number, uint32_t first, SeriesPoint* out, size_t count);
+};
+
+#endif
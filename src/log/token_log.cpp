@@ -0,0 +1,85 @@
+/*
+ * TOKEN_LOG.CPP - Codificación de registros de log tokenizados
+ */
+
+#include "token_log.h"
+#include <string.h>
+
+namespace token_log {
+
+namespace {
+// Lugar que una cadena recortada deja a cada argumento siguiente: un entero
+// de hasta 28 bits en varint, o un float
+constexpr size_t RESERVED_PER_ARGUMENT = 4;
+}  // namespace
+
+Record::Record(uint32_t token) : buffer(), length(0), remaining(0), truncated(false) {
+    putByte(RECORD_MARKER);
+    putByte(0);  // Longitud, se completa en write()
+    for (uint8_t i = 0; i < 4; i++) {
+        putByte(static_cast<uint8_t>(token >> (8 * i)));
+    }
+}
+
+void Record::putByte(uint8_t value) {
+    if (length >= MAX_RECORD_SIZE) {
+        truncated = true;
+        return;
+    }
+    buffer[length++] = value;
+}
+
+void Record::putVarint(uint64_t value) {
+    while (value >= 0x80) {
+        putByte(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    putByte(static_cast<uint8_t>(value));
+}
+
+void Record::putSigned(int64_t value) {
+    uint64_t zigzag = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    putVarint(zigzag);
+}
+
+void Record::put(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    for (uint8_t i = 0; i < 4; i++) {
+        putByte(static_cast<uint8_t>(bits >> (8 * i)));
+    }
+}
+
+void Record::put(const char* value) {
+    if (!value) {
+        value = "";
+    }
+    putString(value, strlen(value));
+}
+
+void Record::putString(const char* value, size_t len) {
+    // Una cadena larga se recorta a lo que cabe (room < 128: un byte de
+    // longitud) y el registro sigue decodificable con la cadena recortada
+    size_t reserved = remaining * RESERVED_PER_ARGUMENT;
+    size_t room = (length + 1 + reserved < MAX_RECORD_SIZE) ? MAX_RECORD_SIZE - length - 1 - reserved : 0;
+    if (len > room) {
+        len = room;
+    }
+    putVarint(len);
+    for (size_t i = 0; i < len; i++) {
+        putByte(static_cast<uint8_t>(value[i]));
+    }
+}
+
+void Record::write() {
+    // Un argumento que no entró entero (número o longitud de cadena sin
+    // lugar) deja el registro sin decodificar; se emite sólo el token para
+    // que el host muestre el mensaje sin valores.
+    if (truncated) {
+        length = 6;
+    }
+    buffer[1] = static_cast<uint8_t>(length - 2);
+    Serial.write(buffer, length);
+}
+
+}  // namespace token_log
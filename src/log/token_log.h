@@ -0,0 +1,107 @@
+/*
+ * TOKEN_LOG.H - Logs de diagnóstico con cadenas tokenizadas
+ *
+ * TLOG(fmt, ...) se comporta como Serial.printf + salto de línea en el modo
+ * normal. Compilando con -DTOKENIZED_LOG la cadena de formato se sustituye en
+ * tiempo de compilación por su hash FNV-1a de 32 bits y sólo se emite por
+ * serial un registro binario compacto:
+ *
+ *   [0x1E][len][token u32 LE][args...]
+ *
+ * len cuenta los bytes posteriores a él (token + args). Los enteros se
+ * codifican como varint zigzag, los float/double como float32 LE y las
+ * cadenas como varint de longitud + bytes. El literal no llega a flash.
+ *
+ * El host expande los registros con tools/detokenize.py usando el diccionario
+ * generado a partir de las llamadas TLOG del código fuente.
+ */
+
+#ifndef TOKEN_LOG_H
+#define TOKEN_LOG_H
+
+#include <Arduino.h>
+#include <type_traits>
+
+namespace token_log {
+
+constexpr uint8_t RECORD_MARKER = 0x1E;
+constexpr size_t MAX_RECORD_SIZE = 64;
+
+// FNV-1a 32 bits; debe coincidir con tools/detokenize.py
+constexpr uint32_t hash(const char* text) {
+    uint32_t h = 2166136261u;
+    while (*text) {
+        h = (h ^ static_cast<uint8_t>(*text++)) * 16777619u;
+    }
+    return h;
+}
+
+// Fuerza la evaluación del hash en compilación
+template <uint32_t Token>
+struct TokenValue {
+    static constexpr uint32_t value = Token;
+};
+
+class Record {
+public:
+    explicit Record(uint32_t token);
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value>::type put(T value) {
+        putSigned(static_cast<int64_t>(value));
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_enum<T>::value>::type put(T value) {
+        putSigned(static_cast<int64_t>(value));
+    }
+
+    void put(float value);
+    void put(double value) { put(static_cast<float>(value)); }
+    void put(const char* value);
+    // Argumentos que faltan después del actual; una cadena recortada les
+    // deja lugar
+    void setRemaining(size_t count) { remaining = count; }
+
+    void write();
+
+private:
+    uint8_t buffer[MAX_RECORD_SIZE];
+    size_t length;
+    size_t remaining;
+    bool truncated;
+
+    void putByte(uint8_t value);
+    void putVarint(uint64_t value);
+    void putSigned(int64_t value);
+    void putString(const char* value, size_t len);
+};
+
+inline void emit(Record& record) {
+    record.write();
+}
+
+// Argumentos por valor: permite pasar campos de structs empaquetados
+template <typename T, typename... Rest>
+void emit(Record& record, T first, Rest... rest) {
+    record.setRemaining(sizeof...(rest));
+    record.put(first);
+    emit(record, rest...);
+}
+
+template <typename... Args>
+void log(uint32_t token, Args... args) {
+    Record record(token);
+    emit(record, args...);
+}
+
+}  // namespace token_log
+
+#if defined(TOKENIZED_LOG)
+#define TLOG(fmt, ...) \
+    ::token_log::log(::token_log::TokenValue<::token_log::hash(fmt)>::value, ##__VA_ARGS__)
+#else
+#define TLOG(fmt, ...) Serial.printf(fmt "\n", ##__VA_ARGS__)
+#endif
+
+#endif
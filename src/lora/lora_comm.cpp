@@ -7,6 +7,7 @@
 #include "../lora.h"
 #include "../gps/gps_manager.h"
 #include "../roles/end_node_repeater_role.h"
+#include "../log/token_log.h"
 
 /*
  * ENVÍO DE DATOS GPS (sin cambios)
@@ -35,7 +36,7 @@ bool LoRaManager::sendPacket(LoRaMessageType msgType, const uint8_t* payload, ui
     if (status != LORA_STATUS_READY) {
         // SOLO mostrar error en modo ADMIN
         if (configManager.isAdminMode()) {
-            Serial.println("[LoRa] ERROR: Sistema no está listo para transmitir");
+            TLOG("[LoRa] ERROR: Sistema no está listo para transmitir");
         }
         return false;
     }
@@ -43,7 +44,7 @@ bool LoRaManager::sendPacket(LoRaMessageType msgType, const uint8_t* payload, ui
     if (payloadLength > LORA_MAX_PAYLOAD_SIZE) {
         // SOLO mostrar error en modo ADMIN
         if (configManager.isAdminMode()) {
-            Serial.println("[LoRa] ERROR: Payload demasiado grande");
+            TLOG("[LoRa] ERROR: Payload demasiado grande");
         }
         return false;
     }
@@ -84,8 +85,9 @@ bool LoRaManager::sendPacket(LoRaMessageType msgType, const uint8_t* payload, ui
         
         // SOLO mostrar debug en modo ADMIN
         if (configManager.isAdminMode() && currentRole != ROLE_END_NODE_REPEATER) {
-            Serial.println("[LoRa] Packet enviado exitosamente");
-            Serial.println("[LoRa] PacketID: " + String(packet.packetID) + ", Air time: " + String(airTime) + " ms");
+            TLOG("[LoRa] Packet enviado exitosamente");
+            TLOG("[LoRa] PacketID: %lu, Air time: %lu ms",
+                 static_cast<unsigned long>(packet.packetID), static_cast<unsigned long>(airTime));
         }
         
         // Volver a modo recepción
@@ -97,8 +99,8 @@ bool LoRaManager::sendPacket(LoRaMessageType msgType, const uint8_t* payload, ui
         
         // SOLO mostrar error en modo ADMIN
         if (configManager.isAdminMode()) {
-            Serial.println("[LoRa] ERROR: Fallo en transmisión");
-            Serial.println("[LoRa] Error code: " + String(state));
+            TLOG("[LoRa] ERROR: Fallo en transmisión");
+            TLOG("[LoRa] Error code: %d", state);
         }
         
         // Volver a modo recepción
@@ -137,7 +139,7 @@ bool LoRaManager::receivePacket(LoRaPacket* packet) {
             stats.packetsLost++;
             // SOLO mostrar en modo ADMIN
             if (configManager.isAdminMode()) {
-                Serial.println("[LoRa] Packet inválido (checksum)");
+                TLOG("[LoRa] Packet inválido (checksum)");
             }
             return false;
         }
@@ -148,8 +150,9 @@ bool LoRaManager::receivePacket(LoRaPacket* packet) {
             
             // Log opcional para debugging en modo ADMIN
             if (configManager.isAdminMode()) {
-                Serial.printf("[NETWORK] Packet filtrado - Hash recibido: %08X vs activo: %08X\n", 
-                             packet->networkHash, configManager.getActiveNetworkHash());
+                TLOG("[NETWORK] Packet filtrado - Hash recibido: %08lX vs activo: %08lX",
+                     static_cast<unsigned long>(packet->networkHash),
+                     static_cast<unsigned long>(configManager.getActiveNetworkHash()));
             }
             
             return false; // Rechazar packet de network diferente
@@ -160,7 +163,8 @@ bool LoRaManager::receivePacket(LoRaPacket* packet) {
             stats.duplicatesIgnored++;
             // SOLO mostrar en modo ADMIN
             if (configManager.isAdminMode()) {
-                Serial.println("[LoRa] Packet duplicado ignorado (sourceID=" + String(packet->sourceID) + ", packetID=" + String(packet->packetID) + ")");
+                TLOG("[LoRa] Packet duplicado ignorado (sourceID=%u, packetID=%lu)",
+                     packet->sourceID, static_cast<unsigned long>(packet->packetID));
             }
             return false;  // Packet duplicado, ignorar
         }
@@ -192,21 +196,20 @@ bool LoRaManager::receivePacket(LoRaPacket* packet) {
                     break;
             }
 
-            Serial.println("============== STATUS ==============");
-            Serial.println("Role: " + roleName);
-            Serial.println("Estado LoRa: " + getStatusString());
+            TLOG("============== STATUS ==============");
+            TLOG("Role: %s", roleName.c_str());
+            TLOG("Estado LoRa: %s", getStatusString().c_str());
 
             if (configManager.hasActiveNetwork()) {
                 SimpleNetwork* network = configManager.getActiveNetwork();
                 if (network) {
-                    String hashStr = String(network->hash, HEX);
-                    hashStr.toLowerCase();
-                    Serial.println("Network: " + network->name + " (Hash: " + hashStr + ")");
+                    TLOG("Network: %s (Hash: %lx)", network->name.c_str(),
+                         static_cast<unsigned long>(network->hash));
                 } else {
-                    Serial.println("Network: NINGUNA ACTIVA - Modo legacy");
+                    TLOG("Network: NINGUNA ACTIVA - Modo legacy");
                 }
             } else {
-                Serial.println("Network: NINGUNA ACTIVA - Modo legacy");
+                TLOG("Network: NINGUNA ACTIVA - Modo legacy");
             }
 
             // Posición propia removida por solicitud
@@ -224,20 +227,18 @@ bool LoRaManager::receivePacket(LoRaPacket* packet) {
                 uint16_t sourceID;
                 if (processGPSPacket(packet, &lat, &lon, &timestamp, &sourceID)) {
                     GPSPayload* gpsPayload = (GPSPayload*)packet->payload;
-                    String sourceStr = String(sourceID);
-                    while (sourceStr.length() < 3) {
-                        sourceStr = "0" + sourceStr;
-                    }
                     receivedLat = lat;
                     receivedLon = lon;
                     receivedTimestamp = timestamp;
                     receivedVoltage = gpsPayload->batteryVoltage;
                     hasGPSDetails = true;
-                    lastSimplePacket = sourceStr + "," +
-                                       String(lat, 6) + "," +
-                                       String(lon, 6) + "," +
-                                       String(gpsPayload->batteryVoltage) + "," +
-                                       String(timestamp);
+                    lastSimplePacket.clear();
+                    lastSimplePacket.appendf("%03u,", sourceID);
+                    lastSimplePacket.appendFloat(lat, 6);
+                    lastSimplePacket.append(',');
+                    lastSimplePacket.appendFloat(lon, 6);
+                    lastSimplePacket.appendf(",%u,%lu", gpsPayload->batteryVoltage,
+                                             static_cast<unsigned long>(timestamp));
                     simplePacketPending = true;
 
                     if (currentRole == ROLE_END_NODE_REPEATER) {
@@ -256,7 +257,7 @@ bool LoRaManager::receivePacket(LoRaPacket* packet) {
             case MSG_DISCOVERY_REQUEST:
                 // NUEVO: Procesar solicitud de discovery
                 if (adminMode) {
-                    Serial.println("[LoRa] Discovery request recibido de device " + String(packet->sourceID));
+                    TLOG("[LoRa] Discovery request recibido de device %u", packet->sourceID);
                 }
                 // Procesar inmediatamente
                 processDiscoveryRequest(packet);
@@ -265,7 +266,7 @@ bool LoRaManager::receivePacket(LoRaPacket* packet) {
             case MSG_DISCOVERY_RESPONSE:
                 // NUEVO: Procesar respuesta de discovery
                 if (adminMode) {
-                    Serial.println("[LoRa] Discovery response recibido de device " + String(packet->sourceID));
+                    TLOG("[LoRa] Discovery response recibido de device %u", packet->sourceID);
                 }
                 // Procesar inmediatamente
                 processDiscoveryResponse(packet);
@@ -274,7 +275,7 @@ bool LoRaManager::receivePacket(LoRaPacket* packet) {
             case MSG_CONFIG_CMD:
                 // NUEVO: Procesar comando de configuración remota
                 if (adminMode) {
-                    Serial.println("[LoRa] Comando de configuración recibido de device " + String(packet->sourceID));
+                    TLOG("[LoRa] Comando de configuración recibido de device %u", packet->sourceID);
                 }
                 // Procesar inmediatamente
                 processRemoteConfigCommand(packet);
@@ -283,7 +284,7 @@ bool LoRaManager::receivePacket(LoRaPacket* packet) {
             case MSG_CONFIG_RESPONSE:
                 // NUEVO: Procesar respuesta de configuración
                 if (adminMode) {
-                    Serial.println("[LoRa] Respuesta de configuración recibida de device " + String(packet->sourceID));
+                    TLOG("[LoRa] Respuesta de configuración recibida de device %u", packet->sourceID);
                 }
                 // Procesar inmediatamente
                 processRemoteConfigResponse(packet);
@@ -292,27 +293,24 @@ bool LoRaManager::receivePacket(LoRaPacket* packet) {
             case MSG_HEARTBEAT:
                 // SOLO mostrar en modo ADMIN
                 if (adminMode) {
-                    Serial.println("[LoRa] Heartbeat recibido de device " + String(packet->sourceID));
+                    TLOG("[LoRa] Heartbeat recibido de device %u", packet->sourceID);
                 }
                 break;
                 
             default:
                 // SOLO mostrar en modo ADMIN
                 if (adminMode) {
-                    Serial.println("[LoRa] Packet tipo desconocido: " + String(packet->messageType));
+                    TLOG("[LoRa] Packet tipo desconocido: %u", packet->messageType);
                 }
                 break;
         }
 
         if (adminMode) {
-            Serial.println("Packet válido recibido");
+            TLOG("Packet válido recibido");
             if (hasGPSDetails) {
-                String packetData = "  └─ Packet: from=" + String(packet->sourceID) +
-                                    ", lat=" + String(receivedLat, 4) +
-                                    ", lon=" + String(receivedLon, 4) +
-                                    ", v=" + String(receivedVoltage, 2) +
-                                    ", ts=" + String(receivedTimestamp);
-                Serial.println(packetData);
+                TLOG("  └─ Packet: from=%u, lat=%.4f, lon=%.4f, v=%.2f, ts=%lu",
+                     packet->sourceID, receivedLat, receivedLon, receivedVoltage,
+                     static_cast<unsigned long>(receivedTimestamp));
             }
         }
 
@@ -329,7 +327,7 @@ bool LoRaManager::receivePacket(LoRaPacket* packet) {
 
         if (adminMode) {
             // El resto de las estadísticas fueron removidas por solicitud.
-            Serial.println("=====================================");
+            TLOG("=====================================");
         }
 
         return true;
@@ -337,8 +335,8 @@ bool LoRaManager::receivePacket(LoRaPacket* packet) {
     } else {
         // SOLO mostrar error en modo ADMIN
         if (configManager.isAdminMode()) {
-            Serial.println("[LoRa] ERROR: Fallo en recepción");
-            Serial.println("[LoRa] Error code: " + String(state));
+            TLOG("[LoRa] ERROR: Fallo en recepción");
+            TLOG("[LoRa] Error code: %d", state);
         }
         return false;
     }
@@ -368,7 +366,7 @@ bool LoRaManager::processGPSPacket(const LoRaPacket* packet, float* lat, float*
     return true;
 }
 
-bool LoRaManager::fetchSimplePacket(String& out) {
+bool LoRaManager::fetchSimplePacket(SimplePacketText& out) {
     if (!simplePacketPending) {
         return false;
     }
@@ -11,9 +11,13 @@
 #include <RadioLib.h>
 #include <vector>
 #include "../config/config_manager.h"  // AGREGAR ESTA LÍNEA
+#include "../common/fixed_string.h"
 #include "lora_types.h"
 #include "lora_hardware.h"
 
+// Línea "id,lat,lon,voltaje,timestamp" para la vista SIMPLE
+typedef FixedString<64> SimplePacketText;
+
 /*
  * CLASE PRINCIPAL - LoRaManager
  */
@@ -26,7 +30,7 @@ private:
     uint16_t deviceID;
     uint32_t packetCounter;
     uint8_t receiveBuffer[256];
-    String lastSimplePacket;
+    SimplePacketText lastSimplePacket;
     bool simplePacketPending;
     
     // === COMPONENTES MESHTASTIC ===
@@ -93,7 +97,7 @@ public:
     bool isPacketAvailable();
     bool receivePacket(LoRaPacket* packet);
     bool processGPSPacket(const LoRaPacket* packet, float* lat, float* lon, uint32_t* timestamp, uint16_t* sourceID);
-    bool fetchSimplePacket(String& out);
+    bool fetchSimplePacket(SimplePacketText& out);
     
     /*
      * MÉTODOS DE MESH
@@ -4,6 +4,7 @@
 
 #include "end_node_repeater_role.h"
 #include "../config/config_manager.h"
+#include "../log/token_log.h"
 
 #if !CONFIG_MANAGER_HAS_PREFERENCES
 #include <Adafruit_LittleFS.h>
@@ -13,19 +14,48 @@ using namespace Adafruit_LittleFS_Namespace;
 
 namespace {
 #if !CONFIG_MANAGER_HAS_PREFERENCES
-constexpr char LOG_FILE_PATH[] = "/lora_log.csv";
-constexpr char LOG_FILE_HEADER[] = "timestamp,source_id,latitude,longitude,voltage_mV,rssi_dBm,snr_dB";
+// Log CSV de versiones anteriores: se importa una vez y se elimina
+constexpr char LEGACY_LOG_PATH[] = "/lora_log.csv";
 #endif
 
-constexpr uint32_t GATEWAY_BAUD = 115200;
+constexpr uint32_t GATEWAY_BAUD = UART_BAUD_BASE;
+// Sin BAUD_TEST tras aceptar, o sin tramas del gateway a una velocidad
+// negociada, se vuelve a la base (el gateway hace PING cada 60 s)
+constexpr unsigned long BAUD_TRIAL_TIMEOUT_MS = 1000;
+constexpr unsigned long LINK_SILENCE_MS = 150000;
 constexpr unsigned long STATUS_INTERVAL_MS = 10000;
 constexpr unsigned long STORAGE_RETRY_INTERVAL_MS = 5000;
-constexpr unsigned long DATA_SEND_INTERVAL_MS = 20;
+// Sin avance de la base en este tiempo se reenvía la ventana
+constexpr unsigned long RETRANSMIT_TIMEOUT_MS = 500;
+constexpr uint8_t MAX_RETRANSMIT_ROUNDS = 6;
 constexpr unsigned long ACK_TIMEOUT_MS = 2000;
 constexpr unsigned long RESULT_TIMEOUT_MS = 5000;
 constexpr uint8_t MAX_START_RETRIES = 3;
 
 HardwareSerial& gatewaySerial = Serial1;
+
+#if !CONFIG_MANAGER_HAS_PREFERENCES
+// Lee una línea del log en el buffer del llamador; false al final del archivo
+bool readLogLine(File& file, EndNodeRepeaterRole::RecordLine& line) {
+    line.clear();
+    bool readAny = false;
+    while (file.available()) {
+        int c = file.read();
+        if (c < 0) {
+            break;
+        }
+        readAny = true;
+        if (c == '\n') {
+            break;
+        }
+        if (c != '\r') {
+            line.append(static_cast<char>(c));
+        }
+    }
+    return readAny;
+}
+#endif
+
 }  // namespace
 
 EndNodeRepeaterRole endNodeRepeaterRole;
@@ -37,28 +67,40 @@ EndNodeRepeaterRole::EndNodeRepeaterRole()
       uartReady(false),
       lastStatusLog(0),
       lastStorageRetry(0),
-      lastDataSend(0),
+      lastAckProgress(0),
       lastBatchAnnounce(0),
       resultWaitStart(0),
-      storedCount(0),
       currentSessionId(0),
       nextSessionId(1),
       nextRecordIndex(0),
+      ackedBase(0),
+      retransmitIndex(0),
+      retransmitEnd(0),
+      recoveryEnd(0),
+      retransmitRounds(0),
+      ackedBits(),
       batchTotalBytes(0),
-      resendPending(false),
-      resendIndex(0),
+      batchCodec(BatchCodec::Plain),
+      dataFrames(0),
       announceAttempts(0),
       transferState(TransferState::Idle),
-      batchRecords(),
-      serialBuffer("") {}
+      flashStorage(),
+      logStorage(flashStorage, LOG_BURST_BYTES, LOG_BURST_MAX_AGE_MS),
+      recordLog(logStorage, LOG_SEGMENTS),
+      batchReader(recordLog),
+      batchQuery(recordLog),
+      batchIsQuery(false),
+      gatewayDecoder(),
+      linkBaud(GATEWAY_BAUD),
+      trialBaud(0),
+      baudTrialStart(0),
+      lastGatewayFrame(0),
+      baudChanges(0),
+      baudFallbacks(0) {}
 
 EndNodeRepeaterRole::~EndNodeRepeaterRole() = default;
 
 bool EndNodeRepeaterRole::ensureInitialized() {
-#if CONFIG_MANAGER_HAS_PREFERENCES
-    storageReady = false;
-    return false;
-#else
     if (storageReady) {
         return true;
     }
@@ -67,19 +109,20 @@ bool EndNodeRepeaterRole::ensureInitialized() {
         initialized = true;
     }
 
-    storageReady = InternalFS.begin();
+    // El cursor del log trae cabeza y cola: sólo se recorre el segmento actual
+    RetentionPolicy retention;
+    retention.resolutionSeconds = RETENTION_RESOLUTION_S;
+    recordLog.setRetention(retention);
+    storageReady = recordLog.begin();
     if (!storageReady) {
-        Serial.println("[END_NODE] ERROR: No se pudo montar InternalFS.");
+        TLOG("[END_NODE] ERROR: No se pudo abrir el log binario.");
         return false;
     }
+    TLOG("[END_NODE] Log sobre %s, buffer de ráfagas de %u B.",
+         logStorage.name(), static_cast<unsigned>(logStorage.bufferCapacity()));
 
-    if (!InternalFS.exists(LOG_FILE_PATH)) {
-        createLogFile();
-    } else {
-        loadExistingLog();
-    }
+    migrateLegacyCsv();
     return storageReady;
-#endif
 }
 
 bool EndNodeRepeaterRole::ensureSerialReady() {
@@ -90,170 +133,124 @@ bool EndNodeRepeaterRole::ensureSerialReady() {
     // Forzar el uso de Serial1. La comprobación en tiempo de compilación
     // (#if defined) falla incorrectamente para la variante de placa personalizada.
     // Como este rol es solo para el Solar Node, podemos asumir que Serial1 existe.
-    Serial1.begin(GATEWAY_BAUD);
+    Serial1.begin(linkBaud);
     uartReady = true;
-    Serial.println("[END_NODE] UART con gateway inicializado @115200.");
+    TLOG("[END_NODE] UART con gateway inicializado @%lu.", static_cast<unsigned long>(linkBaud));
     return uartReady;
 }
 
-void EndNodeRepeaterRole::createLogFile() {
+void EndNodeRepeaterRole::migrateLegacyCsv() {
 #if !CONFIG_MANAGER_HAS_PREFERENCES
-    InternalFS.remove(LOG_FILE_PATH);
-
-    File file(InternalFS);
-    if (!file.open(LOG_FILE_PATH, FILE_O_WRITE)) {
-        storageReady = false;
-        Serial.println("[END_NODE] ERROR: No se pudo crear el archivo de log.");
+    if (!InternalFS.exists(LEGACY_LOG_PATH)) {
         return;
     }
-    file.println(LOG_FILE_HEADER);
-    file.close();
-    storedCount = 0;
-#endif
-}
 
-void EndNodeRepeaterRole::loadExistingLog() {
-#if !CONFIG_MANAGER_HAS_PREFERENCES
     File file(InternalFS);
-    if (!file.open(LOG_FILE_PATH, FILE_O_READ)) {
-        Serial.println("[END_NODE] WARN: No se pudo abrir log existente, recreando archivo.");
-        createLogFile();
+    if (!file.open(LEGACY_LOG_PATH, FILE_O_READ)) {
+        InternalFS.remove(LEGACY_LOG_PATH);
         return;
     }
 
-    storedCount = 0;
+    // Formato: timestamp,source_id,latitude,longitude,voltage_mV,rssi_dBm,snr_dB
+    size_t imported = 0;
     bool headerSkipped = false;
-    while (file.available()) {
-        String line = file.readStringUntil('\n');
+    RecordLine line;
+    while (readLogLine(file, line)) {
         if (!headerSkipped) {
             headerSkipped = true;
             continue;
         }
-        line.trim();
-        if (line.length() == 0) {
+        if (line.empty()) {
             continue;
         }
-        storedCount++;
+
+        char* cursor = line.data();
+        char* end = nullptr;
+        uint32_t timestamp = strtoul(cursor, &end, 10);
+        if (*end != ',') continue;
+        uint16_t sourceId = static_cast<uint16_t>(strtoul(end + 1, &end, 10));
+        if (*end != ',') continue;
+        float latitude = strtod(end + 1, &end);
+        if (*end != ',') continue;
+        float longitude = strtod(end + 1, &end);
+        if (*end != ',') continue;
+        uint16_t voltage = static_cast<uint16_t>(strtoul(end + 1, &end, 10));
+        if (*end != ',') continue;
+        float rssi = strtod(end + 1, &end);
+        if (*end != ',') continue;
+        float snr = strtod(end + 1, &end);
+
+        if (recordLog.append(RecordLog::makeRecord(sourceId, latitude, longitude,
+                                                   timestamp, voltage, rssi, snr))) {
+            imported++;
+        }
     }
     file.close();
+    InternalFS.remove(LEGACY_LOG_PATH);
 
-    if (storedCount > MAX_LOG_ENTRIES) {
-        pruneLogIfNeeded();
-    }
+    TLOG("[END_NODE] Log CSV anterior migrado: %u registros.", static_cast<unsigned>(imported));
 #endif
 }
 
-bool EndNodeRepeaterRole::appendRecord(const String& line) {
-#if CONFIG_MANAGER_HAS_PREFERENCES
-    (void)line;
-    return false;
-#else
-    File file(InternalFS);
-    if (!file.open(LOG_FILE_PATH, FILE_O_WRITE)) {
-        Serial.println("[END_NODE] ERROR: No se pudo abrir log para escritura.");
-        storageReady = false;
-        return false;
-    }
-
-    size_t written = file.println(line);
-    file.close();
+bool EndNodeRepeaterRole::loadBatchFromLog() {
+    batchTotalBytes = 0;
 
-    if (written == 0) {
-        Serial.println("[END_NODE] ERROR: Fallo al escribir registro en log.");
+    // Los bloques abiertos se cierran antes de fijar el lote
+    recordLog.flush();
+    size_t limit = recordLog.count();
+    if (limit > MAX_BATCH_RECORDS) {
+        limit = MAX_BATCH_RECORDS;
+    }
+    uint32_t first = recordLog.firstSequence();
+    batchReader.open(first, limit);
+
+    // Recorrido previo para START_BATCH: suma los bytes de los puntos tal
+    // como viajan en DATA. El lote termina en el primer registro ilegible para
+    // que el índice siga siendo la posición en el log.
+    size_t valid = 0;
+    StoredRecord record;
+    while (valid < limit && batchReader.read(valid, record)) {
+        batchTotalBytes += framePointSize(record);
+        valid++;
+    }
+
+    if (valid == 0) {
+        batchReader.close();
+        if (limit > 0) {
+            TLOG("[END_NODE] WARN: Registro %lu ilegible, se descarta.", static_cast<unsigned long>(first));
+            recordLog.dropOldest(1);
+        }
         return false;
     }
 
-    storedCount++;
-    pruneLogIfNeeded();
+    batchReader.open(first, valid);
     return true;
-#endif
 }
 
-void EndNodeRepeaterRole::pruneLogIfNeeded() {
-#if !CONFIG_MANAGER_HAS_PREFERENCES
-    if (storedCount <= MAX_LOG_ENTRIES) {
-        return;
-    }
-
-    File file(InternalFS);
-    if (!file.open(LOG_FILE_PATH, FILE_O_READ)) {
-        Serial.println("[END_NODE] WARN: No se pudo abrir log para poda.");
-        storageReady = false;
-        return;
-    }
-
-    bool headerSkipped = false;
-    std::vector<String> tail;
-    tail.reserve(MAX_LOG_ENTRIES);
-
-    while (file.available()) {
-        String line = file.readStringUntil('\n');
-        if (!headerSkipped) {
-            headerSkipped = true;
-            continue;
-        }
-        line.trim();
-        if (line.length() == 0) {
-            continue;
-        }
-        tail.push_back(line);
-        if (tail.size() > MAX_LOG_ENTRIES) {
-            tail.erase(tail.begin());
+// Lote con los registros retenidos que cumplen el filtro, confirmados o no.
+// Un registro ilegible descarta la consulta: el gateway puede repetirla.
+bool EndNodeRepeaterRole::loadQueryBatch(const RecordFilter& filter, uint32_t fromSequence) {
+    batchTotalBytes = 0;
+    recordLog.flush();
+    size_t found = batchQuery.run(filter, fromSequence, MAX_BATCH_RECORDS);
+
+    StoredRecord record;
+    for (size_t i = 0; i < found; i++) {
+        if (!batchQuery.read(i, record)) {
+            batchQuery.close();
+            return false;
         }
+        batchTotalBytes += framePointSize(record);
     }
-    file.close();
-
-    InternalFS.remove(LOG_FILE_PATH);
-    File writer(InternalFS);
-    if (!writer.open(LOG_FILE_PATH, FILE_O_WRITE)) {
-        Serial.println("[END_NODE] ERROR: No se pudo reescribir log al podar.");
-        storageReady = false;
-        return;
-    }
-
-    writer.println(LOG_FILE_HEADER);
-    for (const auto& line : tail) {
-        writer.println(line);
-    }
-    writer.close();
-
-    storedCount = tail.size();
-#endif
-}
-
-bool EndNodeRepeaterRole::loadBatchFromLog() {
-#if CONFIG_MANAGER_HAS_PREFERENCES
-    return false;
-#else
-    batchRecords.clear();
-    batchTotalBytes = 0;
-
-    File file(InternalFS);
-    if (!file.open(LOG_FILE_PATH, FILE_O_READ)) {
-        Serial.println("[END_NODE] ERROR: No se pudo abrir log para lectura.");
-        storageReady = false;
+    if (found == 0) {
+        batchQuery.close();
         return false;
     }
+    return true;
+}
 
-    bool headerSkipped = false;
-    while (file.available()) {
-        String line = file.readStringUntil('\n');
-        if (!headerSkipped) {
-            headerSkipped = true;
-            continue;
-        }
-        line.trim();
-        if (line.length() == 0) {
-            continue;
-        }
-        batchRecords.push_back(line);
-        batchTotalBytes += line.length();
-    }
-    file.close();
-
-    storedCount = batchRecords.size();
-    return !batchRecords.empty();
-#endif
+bool EndNodeRepeaterRole::readBatchRecord(size_t index, StoredRecord& out) {
+    return batchIsQuery ? batchQuery.read(index, out) : batchReader.read(index, out);
 }
 
 void EndNodeRepeaterRole::recordLoRaPacket(uint16_t sourceID,
@@ -267,42 +264,20 @@ void EndNodeRepeaterRole::recordLoRaPacket(uint16_t sourceID,
         return;
     }
 
-#if CONFIG_MANAGER_HAS_PREFERENCES
-    (void)sourceID;
-    (void)latitude;
-    (void)longitude;
-    (void)timestamp;
-    (void)voltageMilli;
-    (void)rssi;
-    (void)snr;
-    return;
-#else
-    String line;
-    line.reserve(96);
-    line += String(timestamp);
-    line += ",";
-    line += String(sourceID);
-    line += ",";
-    line += String(latitude, 6);
-    line += ",";
-    line += String(longitude, 6);
-    line += ",";
-    line += String(voltageMilli);
-    line += ",";
-    line += String(rssi, 2);
-    line += ",";
-    line += String(snr, 2);
-
-    appendRecord(line);
-#endif
+    // Con el anillo lleno el log compacta el segmento más antiguo
+    if (!recordLog.append(RecordLog::makeRecord(sourceID, latitude, longitude,
+                                                timestamp, voltageMilli, rssi, snr))) {
+        storageReady = false;
+    }
 }
 
 void EndNodeRepeaterRole::handleMode() {
     unsigned long now = millis();
 
     if (!announced) {
-        Serial.println("[END_NODE] Rol END_NODE_REPEATER activo.");
-        Serial.println("[END_NODE] Activando almacenamiento de packets LoRa (límite 512 registros).");
+        TLOG("[END_NODE] Rol END_NODE_REPEATER activo.");
+        TLOG("[END_NODE] Activando almacenamiento de packets LoRa (%u segmentos de %u B).",
+             static_cast<unsigned>(LOG_SEGMENTS), static_cast<unsigned>(RecordLog::SEGMENT_BYTES));
         announced = true;
     }
 
@@ -318,7 +293,9 @@ void EndNodeRepeaterRole::handleMode() {
         return;
     }
 
+    recordLog.poll();
     processGatewayInput();
+    checkLinkBaud();
 
     if (transferState == TransferState::WaitingAck &&
         announceAttempts > 0 &&
@@ -326,32 +303,63 @@ void EndNodeRepeaterRole::handleMode() {
         if (announceAttempts < MAX_START_RETRIES) {
             sendStartBatch();
         } else {
-            Serial.println("[END_NODE] WARN: Timeout esperando ACK, reintentará más tarde.");
+            TLOG("[END_NODE] WARN: Timeout esperando ACK, reintentará más tarde.");
             resetTransfer(true);
         }
     }
 
     if (transferState == TransferState::SendingData) {
-        if ((millis() - lastDataSend) >= DATA_SEND_INTERVAL_MS) {
-            sendNextRecord();
-        }
+        sendWindow();
     } else if (transferState == TransferState::AwaitingResult &&
                resultWaitStart > 0 &&
                (millis() - resultWaitStart) > RESULT_TIMEOUT_MS) {
-        Serial.println("[END_NODE] WARN: Timeout esperando TRANSFER_OK/FAIL.");
+        TLOG("[END_NODE] WARN: Timeout esperando TRANSFER_OK/FAIL.");
         resetTransfer(true);
     }
 
     if (now - lastStatusLog >= STATUS_INTERVAL_MS) {
         lastStatusLog = now;
-        Serial.println("[END_NODE] Packets almacenados: " + String(storedCount) +
-                       "/" + String(MAX_LOG_ENTRIES));
+        TLOG("[END_NODE] Packets almacenados: %u (%u/%u segmentos)",
+             static_cast<unsigned>(getStoredCount()),
+             static_cast<unsigned>(recordLog.segmentsInUse()),
+             static_cast<unsigned>(recordLog.segmentCount()));
+        const LogStats& stats = recordLog.stats();
+        if (stats.recordsAppended > 0) {
+            uint32_t amplification = recordLog.writeAmplificationX100();
+            uint32_t commits = recordLog.commitsPerRecordX100();
+            TLOG("[END_NODE] Amplificación de escritura: %lu.%02lu (%lu B útiles, %lu B escritos, %u cursor)",
+                 static_cast<unsigned long>(amplification / 100),
+                 static_cast<unsigned long>(amplification % 100),
+                 static_cast<unsigned long>(stats.payloadBytes),
+                 static_cast<unsigned long>(stats.flashBytes),
+                 stats.cursorWrites);
+            TLOG("[END_NODE] Commits de flash por registro: %lu.%02lu",
+                 static_cast<unsigned long>(commits / 100),
+                 static_cast<unsigned long>(commits % 100));
+            uint32_t ratio = recordLog.compressionRatioX100();
+            TLOG("[END_NODE] Compresión: %lu.%02lux frente a registros fijos",
+                 static_cast<unsigned long>(ratio / 100),
+                 static_cast<unsigned long>(ratio % 100));
+            if (logStorage.bufferCapacity() > 0) {
+                TLOG("[END_NODE] Buffer de ráfagas: %u B pendientes, %lu volcados",
+                     static_cast<unsigned>(logStorage.pendingBytes()),
+                     static_cast<unsigned long>(logStorage.spillCount()));
+            }
+            if (stats.compactions > 0) {
+                TLOG("[END_NODE] Compactaciones: %u (%lu registros antiguos descartados)",
+                     stats.compactions,
+                     static_cast<unsigned long>(stats.recordsCompacted));
+            }
+        }
+        TLOG("[END_NODE] UART @%lu bps (%u cambios, %u caídas a la base)",
+             static_cast<unsigned long>(linkBaud), baudChanges, baudFallbacks);
         if (transferState != TransferState::Idle) {
-            Serial.println("[END_NODE] Estado transferencia activo, sesión " + String(currentSessionId));
+            TLOG("[END_NODE] Estado transferencia activo, sesión %u", currentSessionId);
         }
     }
 
-    delay(20);
+    // Durante el envío el ritmo lo marca la ventana, no el lazo
+    delay(transferState == TransferState::SendingData ? 1 : 20);
 }
 
 void EndNodeRepeaterRole::processGatewayInput() {
@@ -360,78 +368,115 @@ void EndNodeRepeaterRole::processGatewayInput() {
     }
 
     while (gatewaySerial.available()) {
-        char c = gatewaySerial.read();
-        if (c == '\r') {
-            continue;
+        int c = gatewaySerial.read();
+        if (c >= 0 && gatewayDecoder.push(static_cast<uint8_t>(c))) {
+            handleGatewayFrame(gatewayDecoder.frame());
         }
-        if (c == '\n') {
-            String line = serialBuffer;
-            serialBuffer = "";
-            line.trim();
-            if (line.length() > 0) {
-                handleGatewayLine(line);
-            }
+    }
+}
+
+void EndNodeRepeaterRole::handleGatewayFrame(FrameReader frame) {
+    FrameType type = frame.type();
+    lastGatewayFrame = millis();
+    if (type == FrameType::BaudPropose || type == FrameType::BaudTest) {
+        uint32_t baud = 0;
+        if (!frame.get(baud)) {
+            TLOG("[END_NODE] WARN: %s malformado.", frameTypeName(type));
+            return;
+        }
+        if (type == FrameType::BaudPropose) {
+            handleBaudPropose(baud);
         } else {
-            serialBuffer += c;
-            if (serialBuffer.length() > 256) {
-                serialBuffer.remove(0);
-            }
+            handleBaudTest(baud, frame);
         }
+        return;
     }
-}
 
-void EndNodeRepeaterRole::handleGatewayLine(const String& line) {
-    if (line == "PING") {
+    if (type == FrameType::Ping) {
         handlePing();
         return;
     }
 
-    if (line == "IDLE" || line == "BUSY") {
+    if (type == FrameType::Idle || type == FrameType::Busy) {
         // Estas respuestas no requieren acción.
         return;
     }
 
-    int colon = line.indexOf(':');
-    if (colon < 0) {
-        Serial.println("[END_NODE] WARN: Comando desconocido del gateway: " + line);
+    if (type == FrameType::QuerySince || type == FrameType::QuerySource) {
+        // QUERY_SINCE: timestamp, secuencia / QUERY_SOURCE: fuente, secuencia
+        uint32_t value = 0;
+        uint32_t fromSequence = 0;
+        if (!frame.get(value) || !frame.get(fromSequence)) {
+            TLOG("[END_NODE] WARN: %s malformado.", frameTypeName(type));
+            return;
+        }
+        RecordFilter filter = {};
+        if (type == FrameType::QuerySince) {
+            filter.since = value;
+        } else {
+            filter.sourceId = static_cast<uint16_t>(value);
+            filter.bySource = true;
+        }
+        handleQuery(filter, fromSequence);
         return;
     }
 
-    String command = line.substring(0, colon);
-    String payload = line.substring(colon + 1);
+    uint32_t session = 0;
+    if (!frame.get(session)) {
+        TLOG("[END_NODE] WARN: %s sin sesión.", frameTypeName(type));
+        return;
+    }
 
-    if (command == "ACK") {
-        handleAck(payload.toInt());
-    } else if (command == "TRANSFER_OK") {
-        handleTransferOk(payload.toInt());
-    } else if (command == "TRANSFER_FAIL") {
-        int secondColon = payload.indexOf(':');
-        uint16_t session = payload.toInt();
-        String reason = (secondColon > 0) ? payload.substring(secondColon + 1) : "UNKNOWN";
-        handleTransferFail(session, reason);
-    } else if (command == "RESEND") {
-        int secondColon = payload.indexOf(':');
-        if (secondColon < 0) {
-            Serial.println("[END_NODE] WARN: RESEND malformado.");
+    if (type == FrameType::Ack) {
+        uint32_t held = 0;
+        uint32_t codec = 0;
+        if (!frame.get(held)) {
+            TLOG("[END_NODE] WARN: ACK malformado.");
+            return;
+        }
+        // Un gateway sin compresión no manda el campo
+        frame.get(codec);
+        handleAck(static_cast<uint16_t>(session), held,
+                  codec == static_cast<uint32_t>(BatchCodec::Delta) ? BatchCodec::Delta : BatchCodec::Plain);
+    } else if (type == FrameType::ChunkOk) {
+        uint32_t records = 0;
+        if (!frame.get(records)) {
+            TLOG("[END_NODE] WARN: CHUNK_OK malformado.");
+            return;
+        }
+        handleChunkOk(static_cast<uint16_t>(session), records);
+    } else if (type == FrameType::TransferOk) {
+        handleTransferOk(static_cast<uint16_t>(session));
+    } else if (type == FrameType::TransferFail) {
+        const uint8_t* reason = nullptr;
+        size_t reasonLength = 0;
+        StringView text = frame.getBytes(reason, reasonLength)
+            ? StringView(reinterpret_cast<const char*>(reason), reasonLength)
+            : StringView("UNKNOWN");
+        handleTransferFail(static_cast<uint16_t>(session), text);
+    } else if (type == FrameType::Sack) {
+        uint32_t base = 0;
+        uint32_t bitmap = 0;
+        if (!frame.get(base) || !frame.get(bitmap)) {
+            TLOG("[END_NODE] WARN: SACK malformado.");
             return;
         }
-        uint16_t session = payload.substring(0, secondColon).toInt();
-        size_t index = payload.substring(secondColon + 1).toInt();
-        handleResend(session, index);
-    } else if (command == "CANCEL") {
-        handleCancel(payload.toInt());
+        handleSack(static_cast<uint16_t>(session), base, bitmap);
+    } else if (type == FrameType::Cancel) {
+        handleCancel(static_cast<uint16_t>(session));
     } else {
-        Serial.println("[END_NODE] WARN: Comando no soportado: " + command);
+        TLOG("[END_NODE] WARN: Trama no soportada: %u", static_cast<unsigned>(type));
     }
 }
 
 void EndNodeRepeaterRole::handlePing() {
     if (transferState != TransferState::Idle) {
-        sendLine("BUSY");
+        FrameWriter busy(FrameType::Busy);
+        sendFrame(busy);
         return;
     }
 
-    if (!storageReady || storedCount == 0) {
+    if (!storageReady || !hasPendingData()) {
         sendIdleResponse();
         return;
     }
@@ -441,6 +486,26 @@ void EndNodeRepeaterRole::handlePing() {
         return;
     }
 
+    batchIsQuery = false;
+    startBatchTransfer();
+}
+
+void EndNodeRepeaterRole::handleQuery(const RecordFilter& filter, uint32_t fromSequence) {
+    if (transferState != TransferState::Idle) {
+        FrameWriter busy(FrameType::Busy);
+        sendFrame(busy);
+        return;
+    }
+
+    // Sin coincidencias la respuesta es la misma que sin datos pendientes
+    if (!storageReady || !loadQueryBatch(filter, fromSequence)) {
+        sendIdleResponse();
+        return;
+    }
+
+    batchIsQuery = true;
+    TLOG("[END_NODE] Consulta desde secuencia %lu: %u registros.",
+         static_cast<unsigned long>(fromSequence), static_cast<unsigned>(batchQuery.size()));
     startBatchTransfer();
 }
 
@@ -451,14 +516,12 @@ void EndNodeRepeaterRole::startBatchTransfer() {
     }
 
     transferState = TransferState::WaitingAck;
-    nextRecordIndex = 0;
-    resendPending = false;
     announceAttempts = 0;
     lastBatchAnnounce = 0;
     resultWaitStart = 0;
 
-    Serial.println("[END_NODE] Iniciando transferencia. Sesión " + String(currentSessionId) +
-                   " con " + String(batchRecords.size()) + " registros.");
+    TLOG("[END_NODE] Iniciando transferencia. Sesión %u con %u registros.",
+         currentSessionId, static_cast<unsigned>(batchSize()));
     sendStartBatch();
 }
 
@@ -469,63 +532,158 @@ void EndNodeRepeaterRole::sendStartBatch() {
     announceAttempts++;
     lastBatchAnnounce = millis();
 
-    String cmd = "START_BATCH:";
-    cmd += String(currentSessionId);
-    cmd += ":";
-    cmd += String(batchRecords.size());
-    cmd += ":";
-    cmd += String(batchTotalBytes);
-
-    sendLine(cmd);
+    // Secuencia desde la que continuar una consulta (0 = completa). Un lote del
+    // log empieza siempre en la cabeza persistida: con esa secuencia y la
+    // época del log el gateway reconoce un lote que ya recibió en parte antes
+    // de un reinicio.
+    FrameWriter frame(FrameType::StartBatch);
+    frame.put(currentSessionId)
+        .put(static_cast<uint32_t>(batchSize()))
+        .put(static_cast<uint32_t>(batchTotalBytes))
+        .put(batchIsQuery ? 1 : 0)
+        .put(batchIsQuery ? batchQuery.resumeSequence() : 0)
+        .put(batchIsQuery ? 0 : batchReader.firstSequence())
+        .put(static_cast<uint32_t>(BatchCodec::Delta))
+        .put(recordLog.epoch());
+    sendFrame(frame);
 }
 
-void EndNodeRepeaterRole::handleAck(uint16_t session) {
+// held: registros del principio del lote que el gateway ya tiene guardados
+// de una sesión interrumpida; se continúa desde ahí
+void EndNodeRepeaterRole::handleAck(uint16_t session, size_t held, BatchCodec codec) {
     if (transferState != TransferState::WaitingAck || session != currentSessionId) {
-        sendLine("CANCEL:" + String(session));
+        sendSessionFrame(FrameType::Cancel, session);
         return;
     }
 
+    if (held > batchSize()) {
+        held = batchSize();
+    }
     transferState = TransferState::SendingData;
-    resendPending = false;
-    lastDataSend = 0;
-    Serial.println("[END_NODE] ACK recibido. Enviando lote...");
+    batchCodec = codec;
+    dataFrames = 0;
+    memset(ackedBits, 0, sizeof(ackedBits));
+    for (size_t i = 0; i < held; i++) {
+        markAcked(i);
+    }
+    nextRecordIndex = held;
+    ackedBase = held;
+    retransmitIndex = 0;
+    retransmitEnd = 0;
+    recoveryEnd = held;
+    retransmitRounds = 0;
+    lastAckProgress = millis();
+    if (held > 0) {
+        TLOG("[END_NODE] ACK recibido. Reanudando desde #%u.", static_cast<unsigned>(held));
+    } else {
+        TLOG("[END_NODE] ACK recibido. Enviando lote con ventana de %u%s.", static_cast<unsigned>(BATCH_WINDOW),
+             batchCodec == BatchCodec::Delta ? " y compresión delta" : "");
+    }
 }
 
-void EndNodeRepeaterRole::sendNextRecord() {
+// Envía las retransmisiones pendientes y los registros nuevos que quepan en
+// la ventana. El ritmo lo marcan los SACK del gateway, no un intervalo fijo.
+void EndNodeRepeaterRole::sendWindow() {
     if (transferState != TransferState::SendingData || !uartReady) {
         return;
     }
 
-    size_t index = resendPending ? resendIndex : nextRecordIndex;
-    if (index >= batchRecords.size()) {
+    size_t total = batchSize();
+    if (ackedBase >= total) {
         transferState = TransferState::AwaitingResult;
         sendEndBatch();
         return;
     }
 
-    const String& record = batchRecords[index];
-    String payloadHex = hexEncode(record);
+    while (retransmitIndex < retransmitEnd) {
+        if (isAcked(retransmitIndex)) {
+            retransmitIndex++;
+            continue;
+        }
+        size_t sent = sendRecords(retransmitIndex, retransmitEnd);
+        if (sent == 0) {
+            return;
+        }
+        retransmitIndex += sent;
+    }
 
-    String cmd = "DATA:";
-    cmd += String(currentSessionId);
-    cmd += ":";
-    cmd += String(index);
-    cmd += ":";
-    cmd += String(record.length());
-    cmd += ":";
-    cmd += payloadHex;
+    size_t windowEnd = ackedBase + BATCH_WINDOW;
+    if (windowEnd > total) {
+        windowEnd = total;
+    }
+    while (nextRecordIndex < windowEnd) {
+        size_t sent = sendRecords(nextRecordIndex, windowEnd);
+        if (sent == 0) {
+            return;
+        }
+        nextRecordIndex += sent;
+    }
 
-    sendLine(cmd);
-    lastDataSend = millis();
+    // Sin SACK que avance la base se reenvía todo lo no confirmado
+    if (millis() - lastAckProgress > RETRANSMIT_TIMEOUT_MS) {
+        if (++retransmitRounds > MAX_RETRANSMIT_ROUNDS) {
+            TLOG("[END_NODE] WARN: Sin SACK del gateway, se cancela la sesión.");
+            sendSessionFrame(FrameType::Cancel, currentSessionId);
+            resetTransfer(true);
+            return;
+        }
+        TLOG("[END_NODE] Timeout de SACK, reenviando desde #%u", static_cast<unsigned>(ackedBase));
+        scheduleRetransmit(ackedBase, nextRecordIndex);
+        lastAckProgress = millis();
+    }
+}
 
-    if (resendPending) {
-        resendPending = false;
-    } else {
-        nextRecordIndex++;
-        if (nextRecordIndex >= batchRecords.size()) {
-            transferState = TransferState::AwaitingResult;
-            sendEndBatch();
+// Envía el registro index y, con compresión, los siguientes sin confirmar
+// antes de end que quepan en la misma trama. Devuelve cuántos envió; 0 si se
+// canceló la sesión.
+size_t EndNodeRepeaterRole::sendRecords(size_t index, size_t end) {
+    StoredRecord stored;
+    if (!readBatchRecord(index, stored)) {
+        // El log descartó el registro por capacidad durante la transferencia
+        TLOG("[END_NODE] WARN: Registro #%u ya no disponible, se cancela la sesión.",
+             static_cast<unsigned>(index));
+        sendSessionFrame(FrameType::Cancel, currentSessionId);
+        resetTransfer(true);
+        return 0;
+    }
+
+    dataFrames++;
+    if (batchCodec == BatchCodec::Plain) {
+        FrameWriter frame(FrameType::Data);
+        frame.put(currentSessionId).put(static_cast<uint32_t>(index)).putPoint(stored);
+        sendFrame(frame);
+        return 1;
+    }
+
+    FrameWriter frame(FrameType::DataBlock);
+    frame.put(currentSessionId).put(static_cast<uint32_t>(index)).putPoint(stored);
+    SeriesPoint previous = stored;
+    size_t count = 1;
+    // Un registro ilegible corta el bloque; se cancela al enviarlo solo
+    while (index + count < end && !isAcked(index + count) && readBatchRecord(index + count, stored)) {
+        size_t mark = frame.size();
+        frame.putPointDelta(stored, previous);
+        if (frame.overflowed()) {
+            frame.rewind(mark);
+            break;
         }
+        previous = stored;
+        count++;
+    }
+    sendFrame(frame);
+    return count;
+}
+
+void EndNodeRepeaterRole::scheduleRetransmit(size_t from, size_t to) {
+    if (retransmitIndex >= retransmitEnd) {
+        retransmitIndex = from;
+        retransmitEnd = to;
+    } else {
+        retransmitIndex = from < retransmitIndex ? from : retransmitIndex;
+        retransmitEnd = to > retransmitEnd ? to : retransmitEnd;
+    }
+    if (to > recoveryEnd) {
+        recoveryEnd = to;
     }
 }
 
@@ -534,73 +692,50 @@ void EndNodeRepeaterRole::sendEndBatch() {
         return;
     }
 
-    String cmd = "END_BATCH:";
-    cmd += String(currentSessionId);
-    sendLine(cmd);
+    TLOG("[END_NODE] Lote enviado en %u tramas de datos (%u registros).",
+         static_cast<unsigned>(dataFrames), static_cast<unsigned>(batchSize()));
+    sendSessionFrame(FrameType::EndBatch, currentSessionId);
     resultWaitStart = millis();
 }
 
 void EndNodeRepeaterRole::deleteRecordsFromLog(size_t recordsToDelete) {
-#if !CONFIG_MANAGER_HAS_PREFERENCES
     if (recordsToDelete == 0) {
         return;
     }
-    if (recordsToDelete >= storedCount) {
-        createLogFile();
-        return;
-    }
 
-    File file(InternalFS);
-    if (!file.open(LOG_FILE_PATH, FILE_O_READ)) {
-        Serial.println("[END_NODE] WARN: No se pudo abrir log para eliminación, recreando.");
-        createLogFile();
+    // Sólo avanza la cabeza y reescribe el cursor; los registros confirmados
+    // quedan en flash para QUERY_* hasta que el anillo necesite el espacio
+    if (!recordLog.dropOldest(recordsToDelete)) {
+        TLOG("[END_NODE] WARN: No se pudo persistir el cursor del log.");
         return;
     }
 
-    std::vector<String> remainingRecords;
-    remainingRecords.reserve(storedCount - recordsToDelete);
-
-    bool headerSkipped = false;
-    size_t skippedRecords = 0;
-
-    while (file.available()) {
-        String line = file.readStringUntil('\n');
-        if (!headerSkipped) {
-            headerSkipped = true;
-            continue;
-        }
-        line.trim();
-        if (line.length() == 0) {
-            continue;
-        }
+    TLOG("[END_NODE] %u registros confirmados. %u pendientes.",
+         static_cast<unsigned>(recordsToDelete), static_cast<unsigned>(recordLog.count()));
+}
 
-        if (skippedRecords < recordsToDelete) {
-            skippedRecords++;
-            continue;
-        }
-        remainingRecords.push_back(line);
+// Avanza la cabeza del log hasta el registro records del lote. Si el log
+// descartó registros por capacidad, la cabeza ya puede estar más adelante.
+void EndNodeRepeaterRole::commitBatchPrefix(size_t records) {
+    uint32_t end = batchReader.firstSequence() + records;
+    if (end > recordLog.firstSequence()) {
+        deleteRecordsFromLog(end - recordLog.firstSequence());
     }
-    file.close();
+}
 
-    InternalFS.remove(LOG_FILE_PATH);
-    File writer(InternalFS);
-    if (!writer.open(LOG_FILE_PATH, FILE_O_WRITE)) {
-        Serial.println("[END_NODE] ERROR: No se pudo reescribir log tras eliminar.");
-        storageReady = false;
-        storedCount = 0; // Perdimos el log
+// El gateway ya reenvió los primeros records del lote: se confirman sin
+// esperar al resto, así un fallo posterior sólo repite lo que falta
+void EndNodeRepeaterRole::handleChunkOk(uint16_t session, size_t records) {
+    if (transferState != TransferState::AwaitingResult || session != currentSessionId ||
+        records > batchSize()) {
         return;
     }
 
-    writer.println(LOG_FILE_HEADER);
-    for (const auto& record : remainingRecords) {
-        writer.println(record);
+    // Cada tramo subido reinicia la espera del resultado final
+    resultWaitStart = millis();
+    if (!batchIsQuery) {
+        commitBatchPrefix(records);
     }
-    writer.close();
-
-    storedCount = remainingRecords.size();
-    Serial.println("[END_NODE] " + String(recordsToDelete) + " registros eliminados. " +
-                   String(storedCount) + " restantes.");
-#endif
 }
 
 void EndNodeRepeaterRole::handleTransferOk(uint16_t session) {
@@ -608,89 +743,203 @@ void EndNodeRepeaterRole::handleTransferOk(uint16_t session) {
         return;
     }
 
-    Serial.println("[END_NODE] Transferencia exitosa. Limpieza de log.");
-    deleteRecordsFromLog(batchRecords.size());
+    if (batchIsQuery) {
+        // Una consulta sólo copia: la cabeza del log no se mueve
+        TLOG("[END_NODE] Consulta entregada (%u registros).", static_cast<unsigned>(batchQuery.size()));
+        resetTransfer(true);
+        return;
+    }
+
+    TLOG("[END_NODE] Transferencia exitosa. Limpieza de log.");
+    commitBatchPrefix(batchReader.size());
     resetTransfer(true); // Preserva los registros restantes
 }
 
-void EndNodeRepeaterRole::handleTransferFail(uint16_t session, const String& reason) {
+void EndNodeRepeaterRole::handleTransferFail(uint16_t session, StringView reason) {
     if (session != currentSessionId) {
         return;
     }
 
-    Serial.println("[END_NODE] TRANSFER_FAIL (" + String(session) + "): " + reason);
+    FixedString<32> text(reason);
+    TLOG("[END_NODE] TRANSFER_FAIL (%u): %s", session, text.c_str());
     resetTransfer(true);
 }
 
-void EndNodeRepeaterRole::handleResend(uint16_t session, size_t index) {
-    if (session != currentSessionId || transferState == TransferState::Idle) {
+void EndNodeRepeaterRole::handleSack(uint16_t session, size_t base, uint32_t bitmap) {
+    if (session != currentSessionId || transferState != TransferState::SendingData) {
         return;
     }
 
-    if (index >= batchRecords.size()) {
-        Serial.println("[END_NODE] WARN: Índice RESEND fuera de rango.");
-        sendLine("CANCEL:" + String(session));
-        resetTransfer(true);
+    size_t total = batchSize();
+    if (base > nextRecordIndex) {
+        TLOG("[END_NODE] WARN: SACK fuera de rango.");
         return;
     }
 
-    resendPending = true;
-    resendIndex = index;
-    transferState = TransferState::SendingData;
-    lastDataSend = 0;
-    Serial.println("[END_NODE] Reenviando registro #" + String(index));
+    for (size_t i = ackedBase; i < base; i++) {
+        markAcked(i);
+    }
+    size_t highest = base;
+    for (size_t bit = 0; bit < SACK_WINDOW; bit++) {
+        size_t index = base + 1 + bit;
+        if (index < total && (bitmap & (1UL << bit))) {
+            markAcked(index);
+            highest = index;
+        }
+    }
+    if (base > ackedBase) {
+        ackedBase = base;
+        lastAckProgress = millis();
+        retransmitRounds = 0;
+    }
+
+    // Un registro confirmado después de un hueco indica pérdida: los huecos
+    // se reenvían juntos. Los ya reprogramados esperan al timeout.
+    size_t from = base > recoveryEnd ? base : recoveryEnd;
+    if (highest > from) {
+        TLOG("[END_NODE] SACK %u: reenviando huecos hasta #%u",
+             static_cast<unsigned>(base), static_cast<unsigned>(highest));
+        scheduleRetransmit(from, highest);
+    }
 }
 
 void EndNodeRepeaterRole::handleCancel(uint16_t session) {
     if (session != currentSessionId) {
         return;
     }
-    Serial.println("[END_NODE] Gateway canceló la sesión " + String(session));
+    TLOG("[END_NODE] Gateway canceló la sesión %u", session);
     resetTransfer(true);
 }
 
+// Se acepta a la velocidad actual y se cambia enseguida; el gateway cambia
+// al recibir BAUD_ACCEPT y envía el patrón de prueba a la nueva
+void EndNodeRepeaterRole::handleBaudPropose(uint32_t baud) {
+    if (transferState != TransferState::Idle) {
+        FrameWriter busy(FrameType::Busy);
+        sendFrame(busy);
+        return;
+    }
+    if (!isNegotiableBaud(baud)) {
+        sendIdleResponse();
+        return;
+    }
+
+    FrameWriter accept(FrameType::BaudAccept);
+    accept.put(baud);
+    sendFrame(accept);
+    switchBaud(baud);
+    trialBaud = baud;
+    baudTrialStart = millis();
+}
+
+void EndNodeRepeaterRole::handleBaudTest(uint32_t baud, FrameReader& frame) {
+    if (trialBaud == 0) {
+        return;
+    }
+
+    uint8_t expected[BAUD_TEST_BYTES];
+    fillBaudTestPattern(expected);
+    const uint8_t* pattern = nullptr;
+    size_t length = 0;
+    if (baud != trialBaud || !frame.getBytes(pattern, length) ||
+        length != BAUD_TEST_BYTES || memcmp(pattern, expected, length) != 0) {
+        TLOG("[END_NODE] WARN: Patrón de prueba inválido a %lu bps.", static_cast<unsigned long>(trialBaud));
+        fallbackBaud();
+        return;
+    }
+
+    // El eco confirma la velocidad al gateway
+    FrameWriter echo(FrameType::BaudTest);
+    echo.put(baud).putBytes(pattern, length);
+    sendFrame(echo);
+    linkBaud = baud;
+    trialBaud = 0;
+    baudChanges++;
+    TLOG("[END_NODE] Enlace con gateway a %lu bps.", static_cast<unsigned long>(linkBaud));
+}
+
+void EndNodeRepeaterRole::checkLinkBaud() {
+    unsigned long now = millis();
+    if (trialBaud != 0) {
+        if (now - baudTrialStart > BAUD_TRIAL_TIMEOUT_MS) {
+            TLOG("[END_NODE] WARN: Sin patrón de prueba a %lu bps.", static_cast<unsigned long>(trialBaud));
+            fallbackBaud();
+        }
+    } else if (linkBaud != GATEWAY_BAUD && transferState == TransferState::Idle &&
+               now - lastGatewayFrame > LINK_SILENCE_MS) {
+        TLOG("[END_NODE] WARN: Gateway sin tramas a %lu bps.", static_cast<unsigned long>(linkBaud));
+        fallbackBaud();
+    }
+}
+
+void EndNodeRepeaterRole::switchBaud(uint32_t baud) {
+    // flush espera a que salga la última trama a la velocidad anterior
+    gatewaySerial.flush();
+    gatewaySerial.end();
+    gatewaySerial.begin(baud);
+    gatewayDecoder.reset();
+}
+
+void EndNodeRepeaterRole::fallbackBaud() {
+    switchBaud(GATEWAY_BAUD);
+    linkBaud = GATEWAY_BAUD;
+    trialBaud = 0;
+    baudFallbacks++;
+    lastGatewayFrame = millis();
+    TLOG("[END_NODE] UART de vuelta a %lu bps.", static_cast<unsigned long>(GATEWAY_BAUD));
+}
+
 void EndNodeRepeaterRole::resetTransfer(bool preserveData) {
     transferState = TransferState::Idle;
     currentSessionId = 0;
     nextRecordIndex = 0;
-    resendPending = false;
-    resendIndex = 0;
+    ackedBase = 0;
+    retransmitIndex = 0;
+    retransmitEnd = 0;
+    recoveryEnd = 0;
+    retransmitRounds = 0;
     batchTotalBytes = 0;
-    lastDataSend = 0;
+    batchCodec = BatchCodec::Plain;
+    dataFrames = 0;
+    lastAckProgress = 0;
     lastBatchAnnounce = 0;
     announceAttempts = 0;
     resultWaitStart = 0;
-    serialBuffer = "";
-    batchRecords.clear();
+    batchReader.close();
+    batchQuery.close();
+    batchIsQuery = false;
 
-    if (preserveData) {
-        loadExistingLog();
-    } else {
-        createLogFile();
+    // El log binario ya refleja lo persistido: sólo se limpia si se pide
+    if (!preserveData) {
+        recordLog.clear();
     }
 }
 
 void EndNodeRepeaterRole::sendIdleResponse() {
-    sendLine("IDLE");
+    FrameWriter frame(FrameType::Idle);
+    sendFrame(frame);
 }
 
-void EndNodeRepeaterRole::sendLine(const String& line) {
+void EndNodeRepeaterRole::sendSessionFrame(FrameType type, uint16_t session) {
+    FrameWriter frame(type);
+    frame.put(session);
+    sendFrame(frame);
+}
+
+void EndNodeRepeaterRole::sendFrame(FrameWriter& frame) {
     if (!uartReady) {
         return;
     }
-    gatewaySerial.print(line);
-    gatewaySerial.print('\n');
-    Serial.println("[END_NODE] UART >>> " + line);
-}
-
-String EndNodeRepeaterRole::hexEncode(const String& input) {
-    static const char HEX_CHARS[] = "0123456789ABCDEF";
-    String out;
-    out.reserve(input.length() * 2);
-    for (size_t i = 0; i < input.length(); i++) {
-        uint8_t b = static_cast<uint8_t>(input.charAt(i));
-        out += HEX_CHARS[b >> 4];
-        out += HEX_CHARS[b & 0x0F];
+    uint8_t encoded[FRAME_ENCODED_MAX];
+    size_t length = frame.encode(encoded);
+    if (length == 0) {
+        TLOG("[END_NODE] ERROR: Trama %s excede %u B.", frameTypeName(frame.type()),
+             static_cast<unsigned>(FRAME_PAYLOAD_MAX));
+        return;
+    }
+    gatewaySerial.write(encoded, length);
+    // Las DATA van a ritmo de línea: registrarlas saturaría la consola
+    if (frame.type() != FrameType::Data && frame.type() != FrameType::DataBlock) {
+        TLOG("[END_NODE] UART >>> %s (%u B)", frameTypeName(frame.type()), static_cast<unsigned>(length));
     }
-    return out;
-}
\ No newline at end of file
+}
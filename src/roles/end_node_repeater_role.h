@@ -6,7 +6,11 @@
 #define END_NODE_REPEATER_ROLE_H
 
 #include <Arduino.h>
-#include <vector>
+#include "../common/fixed_string.h"
+#include "../common/uart_frame.h"
+#include "../storage/flash_storage.h"
+#include "../storage/record_log.h"
+#include "../storage/tiered_storage.h"
 
 /*
  * CLASE PARA MANEJO DEL ROL END_NODE_REPEATER
@@ -23,7 +27,27 @@ class EndNodeRepeaterRole {
     };
 
 public:
-    static constexpr size_t MAX_LOG_ENTRIES = 512;
+    // Segmentos de RecordLog::SEGMENT_BYTES: ~20 KB de InternalFS (~28 KB).
+    // La cantidad de registros depende de la compresión, no de la RAM.
+    static constexpr uint8_t LOG_SEGMENTS = 10;
+    // Separación mínima entre puntos de una fuente al compactar historia vieja
+    static constexpr uint32_t RETENTION_RESOLUTION_S = 300;
+    // Buffer de ráfagas delante de la flash (PSRAM en ESP32 si la hay). Un
+    // corte de energía pierde como mucho LOG_BURST_MAX_AGE_MS de escrituras.
+#if defined(ARDUINO_ARCH_ESP32)
+    static constexpr size_t LOG_BURST_BYTES = 16384;
+#else
+    static constexpr size_t LOG_BURST_BYTES = 1024;
+#endif
+    static constexpr unsigned long LOG_BURST_MAX_AGE_MS = 30000;
+    // Máximo de registros por sesión que acepta el gateway
+    static constexpr size_t MAX_BATCH_RECORDS = 512;
+    // Registros DATA en vuelo sin confirmar; no supera lo que cubre un SACK
+    static constexpr size_t BATCH_WINDOW = SACK_WINDOW;
+    // Línea del log CSV anterior (sólo migración)
+    static constexpr size_t MAX_RECORD_LENGTH = 96;
+
+    using RecordLine = FixedString<MAX_RECORD_LENGTH>;
 
     EndNodeRepeaterRole();
     ~EndNodeRepeaterRole();
@@ -37,8 +61,8 @@ public:
                           float rssi,
                           float snr);
 
-    size_t getStoredCount() const { return storedCount; }
-    bool hasPendingData() const { return storedCount > 0; }
+    size_t getStoredCount() const { return recordLog.count() + recordLog.stagedCount(); }
+    bool hasPendingData() const { return getStoredCount() > 0; }
 
 private:
     bool announced;
@@ -47,45 +71,75 @@ private:
     bool uartReady;
     unsigned long lastStatusLog;
     unsigned long lastStorageRetry;
-    unsigned long lastDataSend;
+    unsigned long lastAckProgress;
     unsigned long lastBatchAnnounce;
     unsigned long resultWaitStart;
-    size_t storedCount;
     uint16_t currentSessionId;
     uint16_t nextSessionId;
-    size_t nextRecordIndex;
+    size_t nextRecordIndex;      // siguiente registro que nunca se envió
+    size_t ackedBase;            // todos los anteriores están confirmados
+    size_t retransmitIndex;      // retransmisión pendiente [retransmitIndex, retransmitEnd)
+    size_t retransmitEnd;
+    size_t recoveryEnd;          // no se reprograma un hueco hasta pasar este índice
+    uint8_t retransmitRounds;
+    uint32_t ackedBits[(MAX_BATCH_RECORDS + 31) / 32];
     size_t batchTotalBytes;
-    bool resendPending;
-    size_t resendIndex;
+    BatchCodec batchCodec;       // la que aceptó el gateway en el ACK
+    size_t dataFrames;           // DATA/DATA_BLOCK enviadas en la sesión
     uint8_t announceAttempts;
     TransferState transferState;
-    std::vector<String> batchRecords;
-    String serialBuffer;
+    FlashStorage flashStorage;
+    TieredStorage logStorage;
+    RecordLog recordLog;
+    RecordReader batchReader;
+    // Lote de una consulta QUERY_*: no borra registros al confirmarse
+    RecordQuery batchQuery;
+    bool batchIsQuery;
+    FrameDecoder gatewayDecoder;
+    // Velocidad del enlace: la base o la que negoció el gateway
+    uint32_t linkBaud;
+    uint32_t trialBaud;          // 0 = sin prueba en curso
+    unsigned long baudTrialStart;
+    unsigned long lastGatewayFrame;
+    uint16_t baudChanges;
+    uint16_t baudFallbacks;
 
     bool ensureInitialized();
     bool ensureSerialReady();
-    void loadExistingLog();
-    void createLogFile();
-    bool appendRecord(const String& line);
-    void pruneLogIfNeeded();
+    void migrateLegacyCsv();
     bool loadBatchFromLog();
+    bool loadQueryBatch(const RecordFilter& filter, uint32_t fromSequence);
+    size_t batchSize() const { return batchIsQuery ? batchQuery.size() : batchReader.size(); }
+    bool readBatchRecord(size_t index, StoredRecord& out);
     void startBatchTransfer();
     void resetTransfer(bool preserveData);
     void processGatewayInput();
-    void handleGatewayLine(const String& line);
+    void handleGatewayFrame(FrameReader frame);
     void handlePing();
-    void handleAck(uint16_t session);
+    void handleQuery(const RecordFilter& filter, uint32_t fromSequence);
+    void handleAck(uint16_t session, size_t held, BatchCodec codec);
+    void handleChunkOk(uint16_t session, size_t records);
     void handleTransferOk(uint16_t session);
-    void handleTransferFail(uint16_t session, const String& reason);
-    void handleResend(uint16_t session, size_t index);
+    void handleTransferFail(uint16_t session, StringView reason);
+    void handleSack(uint16_t session, size_t base, uint32_t bitmap);
     void handleCancel(uint16_t session);
-    void sendLine(const String& line);
+    void handleBaudPropose(uint32_t baud);
+    void handleBaudTest(uint32_t baud, FrameReader& frame);
+    void checkLinkBaud();
+    void switchBaud(uint32_t baud);
+    void fallbackBaud();
+    void sendFrame(FrameWriter& frame);
+    void sendSessionFrame(FrameType type, uint16_t session);
     void sendIdleResponse();
     void sendStartBatch();
-    void sendNextRecord();
+    void sendWindow();
+    size_t sendRecords(size_t index, size_t end);
+    void scheduleRetransmit(size_t from, size_t to);
+    bool isAcked(size_t index) const { return ackedBits[index / 32] & (1UL << (index % 32)); }
+    void markAcked(size_t index) { ackedBits[index / 32] |= 1UL << (index % 32); }
     void sendEndBatch();
+    void commitBatchPrefix(size_t records);
     void deleteRecordsFromLog(size_t recordsToDelete);
-    static String hexEncode(const String& input);
 };
 
 extern EndNodeRepeaterRole endNodeRepeaterRole;
@@ -6,6 +6,7 @@
 #include "../config/config_manager.h"
 #include "../gps/gps_manager.h"
 #include "../lora.h"
+#include "../log/token_log.h"
 #include "../display/display_manager.h"
 #include "user_logic.h"
 
@@ -41,7 +42,7 @@ void ReceiverRole::handleMode() {
     if (currentTime - lastStatusCheck >= 30000) {
         lastStatusCheck = currentTime;
         if (loraManager.getStatus() == LORA_STATUS_ERROR) {
-            Serial.println("[RECEIVER] ERROR: LoRa en estado de error. Reinicializando...");
+            TLOG("[RECEIVER] ERROR: LoRa en estado de error. Reinicializando...");
             // initializeLoRaForRole(); // Se manejará desde RoleManager
             return;
         }
@@ -54,9 +55,9 @@ void ReceiverRole::handleMode() {
     LoRaStats stats = loraManager.getStats();
     if (stats.packetsReceived > lastPacketCount) {
         if (configManager.isSimpleMode()) {
-            String packet;
+            SimplePacketText packet;
             if (loraManager.fetchSimplePacket(packet)) {
-                displayManager.showSimpleReceiverOutput(packet);
+                displayManager.showSimpleReceiverOutput(packet.c_str());
             }
         }
         lastPacketCount = stats.packetsReceived;
@@ -5,6 +5,7 @@
 #include "repeater_role.h"
 #include "../config/config_manager.h"
 #include "../lora.h"
+#include "../log/token_log.h"
 #include "../display/display_manager.h"
 #include "user_logic.h"
 
@@ -37,7 +38,7 @@ void RepeaterRole::handleMode() {
     if (currentTime - lastStatusCheck >= 30000) {
         lastStatusCheck = currentTime;
         if (loraManager.getStatus() == LORA_STATUS_ERROR) {
-            Serial.println("[REPEATER] ERROR: LoRa en estado de error. Reinicializando...");
+            TLOG("[REPEATER] ERROR: LoRa en estado de error. Reinicializando...");
             // initializeLoRaForRole(); // Se manejará desde RoleManager
             return;
         }
@@ -10,6 +10,7 @@
 #include "../config/config_manager.h"
 #include "../gps/gps_manager.h"
 #include "../lora.h"
+#include "../log/token_log.h"
 
 // Instancia global
 RoleManager roleManager;
@@ -47,7 +48,7 @@ void RoleManager::handleOperativeMode() {
     
     // Verificación adicional de que LoRa esté funcionando
     if (loraManager.getStatus() == LORA_STATUS_ERROR) {
-        Serial.println("[MAIN] ERROR: LoRa en estado de error. Reintentando inicialización...");
+        TLOG("[MAIN] ERROR: LoRa en estado de error. Reintentando inicialización...");
         initializeLoRaForRole();
         delay(2000);
         return;
@@ -72,7 +73,7 @@ void RoleManager::handleOperativeMode() {
         default:
             configManager.setState(STATE_CONFIG_MODE);
             loraInitialized = false;
-            Serial.println("[ERROR] Rol no válido. Entrando en modo configuración.");
+            TLOG("[ERROR] Rol no válido. Entrando en modo configuración.");
             break;
     }
 }
@@ -87,7 +88,7 @@ void RoleManager::initializeLoRaForRole() {
     
     // Inicializar LoRa con el device ID configurado
     if (!loraManager.begin(config.deviceID)) {
-        Serial.println("[MAIN] ERROR: Fallo en inicialización LoRa");
+        TLOG("[MAIN] ERROR: Fallo en inicialización LoRa");
         loraInitialized = false;
         return;
     }
@@ -156,11 +157,11 @@ void RoleManager::initializeGPSForRole() {
             break;
         case ROLE_END_NODE_REPEATER:
             // No inicializar GPS; los pines se reutilizan para UART con el gateway
-            Serial.println("[MAIN] Rol END_NODE_REPEATER: GPS deshabilitado (pines reservados para UART).");
+            TLOG("[MAIN] Rol END_NODE_REPEATER: GPS deshabilitado (pines reservados para UART).");
             break;
             
         default:
-            Serial.println("[MAIN] Rol no reconocido - GPS en modo fijo");
+            TLOG("[MAIN] Rol no reconocido - GPS en modo fijo");
             gpsManager.begin();
             break;
     }
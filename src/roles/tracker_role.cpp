@@ -6,6 +6,7 @@
 #include "../config/config_manager.h"
 #include "../gps/gps_manager.h"
 #include "../lora.h"
+#include "../log/token_log.h"
 #include "../display/display_manager.h"
 #include "../battery/battery_manager.h"
 #include "user_logic.h"
@@ -43,8 +44,8 @@ void TrackerRole::handleMode() {
         LoRaStatus loraStatus = loraManager.getStatus();
         
         if (loraStatus == LORA_STATUS_ERROR || loraStatus == LORA_STATUS_INIT) {
-            Serial.println("[TRACKER] WARNING: LoRa no está listo. Estado: " + loraManager.getStatusString());
-            Serial.println("[TRACKER] Reintentando inicialización...");
+            TLOG("[TRACKER] WARNING: LoRa no está listo. Estado: %s", loraManager.getStatusString().c_str());
+            TLOG("[TRACKER] Reintentando inicialización...");
             // initializeLoRaForRole(); // Se manejará desde RoleManager
             return;
         }
@@ -79,8 +80,8 @@ void TrackerRole::handleMode() {
 
         // Verificar estado de LoRa antes de transmitir
         if (loraManager.getStatus() != LORA_STATUS_READY) {
-            Serial.println("[TRACKER] WARNING: LoRa no está listo para transmitir");
-            Serial.println("[TRACKER] Estado actual: " + loraManager.getStatusString());
+            TLOG("[TRACKER] WARNING: LoRa no está listo para transmitir");
+            TLOG("[TRACKER] Estado actual: %s", loraManager.getStatusString().c_str());
             return;
         }
 
@@ -91,7 +92,7 @@ void TrackerRole::handleMode() {
         displayManager.showTrackerOutput(config.deviceID, lat, lon, battery, timestamp, sent);
 
         if (!gpsData.hasValidFix) {
-            Serial.println("[TRACKER] Aviso: enviando sin fix (coordenadas inválidas)");
+            TLOG("[TRACKER] Aviso: enviando sin fix (coordenadas inválidas)");
         }
     }
     
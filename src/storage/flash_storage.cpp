@@ -0,0 +1,181 @@
+/*
+ * FLASH_STORAGE.CPP - Backend sobre InternalFS (nRF52) / LittleFS (ESP32)
+ */
+
+#include "flash_storage.h"
+#include "../log/token_log.h"
+
+#if !defined(ARDUINO_ARCH_ESP32)
+using namespace Adafruit_LittleFS_Namespace;
+#endif
+
+namespace {
+#if defined(ARDUINO_ARCH_ESP32)
+// Sufijo del archivo temporal con el que se trunca (copia + rename)
+constexpr char TRUNCATE_SUFFIX[] = ".tmp";
+constexpr size_t COPY_CHUNK = 128;
+#endif
+}  // namespace
+
+FlashStorage::FlashStorage()
+    : mounted(false),
+#if defined(ARDUINO_ARCH_ESP32)
+      reader(),
+#else
+      reader(InternalFS),
+#endif
+      readerPath() {}
+
+const char* FlashStorage::name() const {
+#if defined(ARDUINO_ARCH_ESP32)
+    return "LittleFS";
+#else
+    return "InternalFS";
+#endif
+}
+
+bool FlashStorage::begin() {
+    if (mounted) {
+        return true;
+    }
+#if defined(ARDUINO_ARCH_ESP32)
+    // Primer arranque: la partición de datos todavía no tiene formato
+    mounted = LittleFS.begin(true);
+#else
+    mounted = InternalFS.begin();
+#endif
+    if (!mounted) {
+        TLOG("[STORAGE] ERROR: No se pudo montar %s.", name());
+    }
+    return mounted;
+}
+
+bool FlashStorage::openReader(const char* path) {
+    if (reader && readerPath == StringView(path)) {
+        return true;
+    }
+    reader.close();
+    readerPath.clear();
+#if defined(ARDUINO_ARCH_ESP32)
+    if (!LittleFS.exists(path)) {
+        return false;
+    }
+    reader = LittleFS.open(path, FILE_READ);
+    if (!reader) {
+        return false;
+    }
+#else
+    if (!reader.open(path, FILE_O_READ)) {
+        return false;
+    }
+#endif
+    readerPath.append(path);
+    return true;
+}
+
+void FlashStorage::releaseReader(const char* path) {
+    if (readerPath == StringView(path)) {
+        reader.close();
+        readerPath.clear();
+    }
+}
+
+bool FlashStorage::exists(const char* path) {
+#if defined(ARDUINO_ARCH_ESP32)
+    return LittleFS.exists(path);
+#else
+    return InternalFS.exists(path);
+#endif
+}
+
+bool FlashStorage::remove(const char* path) {
+    releaseReader(path);
+#if defined(ARDUINO_ARCH_ESP32)
+    return LittleFS.remove(path);
+#else
+    return InternalFS.remove(path);
+#endif
+}
+
+uint32_t FlashStorage::size(const char* path) {
+    if (!openReader(path)) {
+        return 0;
+    }
+    return reader.size();
+}
+
+bool FlashStorage::read(const char* path, uint32_t offset, void* data, size_t length) {
+    if (!openReader(path) || offset + length > reader.size() || !reader.seek(offset)) {
+        return false;
+    }
+#if defined(ARDUINO_ARCH_ESP32)
+    return reader.read(static_cast<uint8_t*>(data), length) == length;
+#else
+    return reader.read(data, length) == static_cast<int>(length);
+#endif
+}
+
+bool FlashStorage::write(const char* path, uint32_t offset, const void* data, size_t length) {
+    releaseReader(path);
+#if defined(ARDUINO_ARCH_ESP32)
+    // "r+" conserva el contenido; "w" sólo para crear el archivo
+    File file = LittleFS.open(path, LittleFS.exists(path) ? "r+" : FILE_WRITE);
+    if (!file) {
+        return false;
+    }
+#else
+    File file(InternalFS);
+    if (!file.open(path, FILE_O_WRITE)) {
+        return false;
+    }
+#endif
+    bool ok = file.seek(offset) &&
+              file.write(static_cast<const uint8_t*>(data), length) == length;
+    file.close();
+    return ok;
+}
+
+bool FlashStorage::truncate(const char* path, uint32_t length) {
+    releaseReader(path);
+#if defined(ARDUINO_ARCH_ESP32)
+    // El File de arduino-esp32 no expone truncate: se copia el prefijo válido
+    // a un temporal y se renombra encima del original
+    FixedString<STORAGE_PATH_MAX + sizeof(TRUNCATE_SUFFIX)> temp(path);
+    temp.append(TRUNCATE_SUFFIX);
+    File source = LittleFS.open(path, FILE_READ);
+    File target = LittleFS.open(temp.c_str(), FILE_WRITE);
+    bool ok = source && target;
+    uint8_t chunk[COPY_CHUNK];
+    uint32_t copied = 0;
+    while (ok && copied < length) {
+        size_t step = length - copied < COPY_CHUNK ? length - copied : COPY_CHUNK;
+        ok = source.read(chunk, step) == step && target.write(chunk, step) == step;
+        copied += step;
+    }
+    source.close();
+    target.close();
+    if (!ok) {
+        LittleFS.remove(temp.c_str());
+        return false;
+    }
+    return LittleFS.rename(temp.c_str(), path);
+#else
+    File file(InternalFS);
+    if (!file.open(path, FILE_O_WRITE)) {
+        return false;
+    }
+    bool ok = file.truncate(length);
+    file.close();
+    return ok;
+#endif
+}
+
+bool FlashStorage::rename(const char* from, const char* to) {
+    releaseReader(from);
+    releaseReader(to);
+#if defined(ARDUINO_ARCH_ESP32)
+    return LittleFS.rename(from, to);
+#else
+    return InternalFS.rename(from, to);
+#endif
+}
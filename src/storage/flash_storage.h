@@ -0,0 +1,52 @@
+/*
+ * FLASH_STORAGE.H - Backend sobre el sistema de archivos de la placa
+ *
+ * nRF52: InternalFS (Adafruit LittleFS). ESP32: LittleFS sobre la partición
+ * de datos, formateada en el primer arranque. Mantiene abierto el último
+ * archivo leído para que recorrer un segmento no reabra el archivo en cada
+ * header de bloque.
+ */
+
+#ifndef FLASH_STORAGE_H
+#define FLASH_STORAGE_H
+
+#include <Arduino.h>
+#include "storage_backend.h"
+#include "../common/fixed_string.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <LittleFS.h>
+#else
+#include <Adafruit_LittleFS.h>
+#include <InternalFileSystem.h>
+#endif
+
+class FlashStorage : public StorageBackend {
+public:
+    FlashStorage();
+
+    bool begin() override;
+    bool exists(const char* path) override;
+    bool remove(const char* path) override;
+    uint32_t size(const char* path) override;
+    bool read(const char* path, uint32_t offset, void* data, size_t length) override;
+    bool write(const char* path, uint32_t offset, const void* data, size_t length) override;
+    bool truncate(const char* path, uint32_t length) override;
+    bool rename(const char* from, const char* to) override;
+    const char* name() const override;
+
+private:
+    bool mounted;
+#if defined(ARDUINO_ARCH_ESP32)
+    fs::File reader;
+#else
+    Adafruit_LittleFS_Namespace::File reader;
+#endif
+    FixedString<STORAGE_PATH_MAX> readerPath;
+
+    bool openReader(const char* path);
+    // Cierra el lector cacheado si apunta a path (antes de modificarlo)
+    void releaseReader(const char* path);
+};
+
+#endif
@@ -0,0 +1,97 @@
+/*
+ * HOST_FILE_STORAGE.CPP - Backend sobre archivos del host
+ */
+
+#ifndef ARDUINO
+
+#include "host_file_storage.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+constexpr size_t HOST_PATH_MAX = HostFileStorage::ROOT_MAX + STORAGE_PATH_MAX;
+}  // namespace
+
+HostFileStorage::HostFileStorage(const char* rootDirectory) : root(), commits(0) {
+    snprintf(root, sizeof(root), "%s", rootDirectory);
+}
+
+void HostFileStorage::resolve(const char* path, char* out, size_t capacity) const {
+    snprintf(out, capacity, "%s%s", root, path);
+}
+
+bool HostFileStorage::begin() {
+    struct stat info;
+    return stat(root, &info) == 0 ? S_ISDIR(info.st_mode) : mkdir(root, 0755) == 0;
+}
+
+bool HostFileStorage::exists(const char* path) {
+    char full[HOST_PATH_MAX];
+    resolve(path, full, sizeof(full));
+    struct stat info;
+    return stat(full, &info) == 0;
+}
+
+bool HostFileStorage::remove(const char* path) {
+    char full[HOST_PATH_MAX];
+    resolve(path, full, sizeof(full));
+    commits++;
+    return ::remove(full) == 0;
+}
+
+uint32_t HostFileStorage::size(const char* path) {
+    char full[HOST_PATH_MAX];
+    resolve(path, full, sizeof(full));
+    struct stat info;
+    return stat(full, &info) == 0 ? static_cast<uint32_t>(info.st_size) : 0;
+}
+
+bool HostFileStorage::read(const char* path, uint32_t offset, void* data, size_t length) {
+    char full[HOST_PATH_MAX];
+    resolve(path, full, sizeof(full));
+    FILE* file = fopen(full, "rb");
+    if (!file) {
+        return false;
+    }
+    bool ok = fseek(file, offset, SEEK_SET) == 0 && fread(data, 1, length, file) == length;
+    fclose(file);
+    return ok;
+}
+
+bool HostFileStorage::write(const char* path, uint32_t offset, const void* data, size_t length) {
+    char full[HOST_PATH_MAX];
+    resolve(path, full, sizeof(full));
+    FILE* file = fopen(full, "r+b");
+    if (!file) {
+        file = fopen(full, "w+b");
+    }
+    if (!file) {
+        return false;
+    }
+    bool ok = fseek(file, offset, SEEK_SET) == 0 && fwrite(data, 1, length, file) == length;
+    ok = fclose(file) == 0 && ok;
+    commits++;
+    return ok;
+}
+
+bool HostFileStorage::truncate(const char* path, uint32_t length) {
+    char full[HOST_PATH_MAX];
+    resolve(path, full, sizeof(full));
+    commits++;
+    return ::truncate(full, length) == 0;
+}
+
+bool HostFileStorage::rename(const char* from, const char* to) {
+    char fullFrom[HOST_PATH_MAX];
+    char fullTo[HOST_PATH_MAX];
+    resolve(from, fullFrom, sizeof(fullFrom));
+    resolve(to, fullTo, sizeof(fullTo));
+    commits++;
+    return ::rename(fullFrom, fullTo) == 0;
+}
+
+#endif
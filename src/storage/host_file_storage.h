@@ -0,0 +1,44 @@
+/*
+ * HOST_FILE_STORAGE.H - Backend sobre archivos del host (fuera del equipo)
+ *
+ * Permite compilar RecordLog en el PC para benchmarks de append/drenado
+ * (test/host/bench_storage.cpp) y pruebas de recuperación. Las rutas del log
+ * se resuelven bajo root. Sólo se compila fuera de Arduino.
+ */
+
+#ifndef HOST_FILE_STORAGE_H
+#define HOST_FILE_STORAGE_H
+
+#ifndef ARDUINO
+
+#include "storage_backend.h"
+
+class HostFileStorage : public StorageBackend {
+public:
+    static constexpr size_t ROOT_MAX = 128;
+
+    explicit HostFileStorage(const char* rootDirectory);
+
+    bool begin() override;
+    bool exists(const char* path) override;
+    bool remove(const char* path) override;
+    uint32_t size(const char* path) override;
+    bool read(const char* path, uint32_t offset, void* data, size_t length) override;
+    bool write(const char* path, uint32_t offset, const void* data, size_t length) override;
+    bool truncate(const char* path, uint32_t length) override;
+    bool rename(const char* from, const char* to) override;
+    const char* name() const override { return "host"; }
+
+    // Commits (write/truncate/remove/rename) desde el arranque, para los benchmarks
+    uint32_t commitCount() const { return commits; }
+
+private:
+    char root[ROOT_MAX];
+    uint32_t commits;
+
+    void resolve(const char* path, char* out, size_t capacity) const;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,1140 @@
+/*
+ * RECORD_LOG.CPP - Log circular segmentado de bloques comprimidos
+ */
+
+#include "record_log.h"
+#include "../common/crc32.h"
+#include "../log/token_log.h"
+
+namespace {
+constexpr char CURSOR_PATH[] = "/lora_log.cur";
+constexpr char INDEX_PATH[] = "/lora_log.idx";
+constexpr char EPOCH_PATH[] = "/lora_log.epc";
+// Segmento compactado en construcción, antes de reemplazar a la cabeza
+constexpr char SCRATCH_PATH[] = "/lora_seg.new";
+
+constexpr uint32_t CURSOR_SIZE = sizeof(LogCursor);
+constexpr uint32_t SEGMENT_HEADER_SIZE = sizeof(SegmentHeader);
+constexpr uint32_t BLOCK_HEADER_SIZE = sizeof(BlockHeader);
+constexpr uint32_t SUMMARY_SIZE = sizeof(SegmentSummary);
+
+// Entropía para la época inicial. random() sin randomSeed() repite la misma
+// secuencia en cada arranque y micros() casi no varía tan temprano: un nodo
+// reflasheado volvería a la época de su log anterior. En nRF52 se usa el RNG
+// de hardware (el SoftDevice no está activo: no hay BLE) mezclado con el id
+// único del chip; en ESP32, esp_random().
+uint32_t epochEntropy() {
+#if defined(NRF52_SERIES)
+    uint32_t value = NRF_FICR->DEVICEID[0] ^ ((NRF_FICR->DEVICEID[1] << 16) | (NRF_FICR->DEVICEID[1] >> 16));
+    NRF_RNG->CONFIG = RNG_CONFIG_DERCEN_Enabled << RNG_CONFIG_DERCEN_Pos;
+    NRF_RNG->EVENTS_VALRDY = 0;
+    NRF_RNG->TASKS_START = 1;
+    for (int i = 0; i < 4; i++) {
+        while (NRF_RNG->EVENTS_VALRDY == 0) {
+        }
+        NRF_RNG->EVENTS_VALRDY = 0;
+        value = ((value << 8) | (value >> 24)) ^ NRF_RNG->VALUE;
+    }
+    NRF_RNG->TASKS_STOP = 1;
+    return value;
+#elif defined(ARDUINO_ARCH_ESP32)
+    return esp_random();
+#else
+    return static_cast<uint32_t>(micros());
+#endif
+}
+
+// Resumen que no descarta nada: segmentos sin entrada válida en el índice
+SegmentSummary unknownSummary(uint32_t segment) {
+    SegmentSummary summary;
+    summary.segmentId = segment;
+    summary.minTimestamp = 0;
+    summary.maxTimestamp = UINT32_MAX;
+    summary.sourceBits = UINT32_MAX;
+    summary.crc = 0;
+    return summary;
+}
+
+// Resumen de un segmento recién abierto, sin bloques
+SegmentSummary emptySummary(uint32_t segment) {
+    SegmentSummary summary;
+    summary.segmentId = segment;
+    summary.minTimestamp = UINT32_MAX;
+    summary.maxTimestamp = 0;
+    summary.sourceBits = 0;
+    summary.crc = 0;
+    return summary;
+}
+
+int32_t scaleToInt(float value, float scale) {
+    float scaled = value * scale;
+    return static_cast<int32_t>(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+}
+}  // namespace
+
+RecordLog::RecordLog(StorageBackend& backend, uint8_t segments)
+    // Al menos dos segmentos: la cabeza nunca comparte slot con la cola
+    : storage(backend),
+      segmentSlots(segments < 2 ? 2 : (segments > MAX_SEGMENT_SLOTS ? MAX_SEGMENT_SLOTS : segments)),
+      ready(false),
+      logEpoch(0),
+      headSequence(0),
+      tailSequence(0),
+      headSegment(0),
+      tailSegment(0),
+      tailOffset(0),
+      segmentFirst(),
+      summaries(),
+      openBlocks(),
+      retention(),
+      survivors(),
+      survivorCount(0),
+      counters() {}
+
+SeriesPoint RecordLog::makeRecord(uint16_t sourceId,
+                                  float latitude,
+                                  float longitude,
+                                  uint32_t timestamp,
+                                  uint16_t voltageMilli,
+                                  float rssi,
+                                  float snr) {
+    SeriesPoint point = {};
+    point.timestamp = timestamp;
+    point.latitudeE6 = scaleToInt(latitude, 1000000.0f);
+    point.longitudeE6 = scaleToInt(longitude, 1000000.0f);
+    point.sourceId = sourceId;
+    point.voltageMilli = voltageMilli;
+    point.rssiCenti = static_cast<int16_t>(scaleToInt(rssi, 100.0f));
+    point.snrCenti = static_cast<int16_t>(scaleToInt(snr, 100.0f));
+    return point;
+}
+
+void RecordLog::segmentPath(uint8_t slot, char* out, size_t capacity) {
+    snprintf(out, capacity, "/lora_seg%u.bin", static_cast<unsigned>(slot));
+}
+
+uint32_t RecordLog::blockCrc(const BlockHeader& header, const uint8_t* payload) {
+    return crc32Update(crc32(&header, offsetof(BlockHeader, crc)), payload, header.length);
+}
+
+size_t RecordLog::stagedCount() const {
+    size_t staged = 0;
+    for (const OpenBlock& block : openBlocks) {
+        staged += block.encoder.count();
+    }
+    return staged;
+}
+
+uint32_t RecordLog::writeAmplificationX100() const {
+    if (counters.payloadBytes == 0) {
+        return 0;
+    }
+    return static_cast<uint32_t>((static_cast<uint64_t>(counters.flashBytes) * 100) / counters.payloadBytes);
+}
+
+uint32_t RecordLog::commitsPerRecordX100() const {
+    if (counters.recordsAppended == 0) {
+        return 0;
+    }
+    uint32_t commits = counters.flushes + counters.cursorWrites;
+    return static_cast<uint32_t>((static_cast<uint64_t>(commits) * 100) / counters.recordsAppended);
+}
+
+uint32_t RecordLog::compressionRatioX100() const {
+    if (counters.payloadBytes == 0) {
+        return 0;
+    }
+    uint32_t sealed = counters.recordsAppended - stagedCount();
+    return static_cast<uint32_t>((static_cast<uint64_t>(sealed) * FIXED_RECORD_BYTES * 100) / counters.payloadBytes);
+}
+
+bool RecordLog::begin() {
+    if (ready) {
+        return true;
+    }
+    if (!storage.begin()) {
+        return false;
+    }
+
+    loadEpoch();
+    bool loaded = storage.exists(CURSOR_PATH) && loadCursor() && recoverSegments();
+    if (!loaded && !resetLog()) {
+        return false;
+    }
+
+    ready = true;
+    if (count() > 0) {
+        TLOG("[LOG] Log recuperado: %lu registros pendientes.", static_cast<unsigned long>(count()));
+    }
+    return ready;
+}
+
+bool RecordLog::loadCursor() {
+    LogCursor stored;
+    bool ok = storage.read(CURSOR_PATH, 0, &stored, CURSOR_SIZE) &&
+         stored.magic == MAGIC &&
+         stored.version == VERSION &&
+         stored.segmentSlots == segmentSlots &&
+         stored.segmentBytes == SEGMENT_BYTES &&
+         stored.tailSegment >= stored.headSegment &&
+         stored.tailSegment - stored.headSegment < segmentSlots &&
+         stored.crc == crc32(&stored, offsetof(LogCursor, crc));
+    if (!ok) {
+        TLOG("[LOG] WARN: Cursor de log inválido, se reinicia el log.");
+        return false;
+    }
+
+    headSequence = stored.headSequence;
+    headSegment = stored.headSegment;
+    tailSegment = stored.tailSegment;
+    return true;
+}
+
+// LittleFS confirma el archivo de forma atómica al cerrarlo: un corte deja
+// el cursor anterior o el nuevo, nunca uno a medias.
+bool RecordLog::writeCursor() {
+    LogCursor cursor = {};
+    cursor.magic = MAGIC;
+    cursor.version = VERSION;
+    cursor.segmentSlots = segmentSlots;
+    cursor.segmentBytes = SEGMENT_BYTES;
+    cursor.headSequence = headSequence;
+    cursor.headSegment = headSegment;
+    cursor.tailSegment = tailSegment;
+    cursor.crc = crc32(&cursor, offsetof(LogCursor, crc));
+
+    if (!storage.write(CURSOR_PATH, 0, &cursor, CURSOR_SIZE)) {
+        TLOG("[LOG] ERROR: No se pudo escribir el cursor del log.");
+        return false;
+    }
+
+    counters.cursorWrites++;
+    counters.flashBytes += CURSOR_SIZE;
+    return true;
+}
+
+bool RecordLog::resetLog() {
+    char path[STORAGE_PATH_MAX];
+    for (uint8_t slot = 0; slot < segmentSlots; slot++) {
+        segmentPath(slot, path, sizeof(path));
+        storage.remove(path);
+    }
+    headSegment = 0;
+    tailSegment = 0;
+    headSequence = tailSequence;
+    return advanceEpoch() && startSegment(0, tailSequence) && writeCursor();
+}
+
+// El archivo de época sobrevive a resetLog, que la avanza. Sin archivo
+// (primer arranque, flash formateada o firmware anterior) se parte de un
+// valor al azar (epochEntropy) y se guarda.
+void RecordLog::loadEpoch() {
+    LogEpoch stored;
+    bool ok = storage.read(EPOCH_PATH, 0, &stored, sizeof(stored)) &&
+              stored.magic == EPOCH_MAGIC &&
+              stored.crc == crc32(&stored, offsetof(LogEpoch, crc));
+    if (ok && stored.epoch != 0) {
+        logEpoch = stored.epoch;
+        return;
+    }
+    logEpoch = static_cast<uint32_t>(random(1, INT32_MAX)) ^ epochEntropy();
+    advanceEpoch();
+}
+
+bool RecordLog::advanceEpoch() {
+    logEpoch = logEpoch + 1 != 0 ? logEpoch + 1 : 1;
+    LogEpoch stored;
+    stored.magic = EPOCH_MAGIC;
+    stored.epoch = logEpoch;
+    stored.crc = crc32(&stored, offsetof(LogEpoch, crc));
+    if (!storage.write(EPOCH_PATH, 0, &stored, sizeof(stored))) {
+        TLOG("[LOG] ERROR: No se pudo escribir la época del log.");
+        return false;
+    }
+    counters.flashBytes += sizeof(stored);
+    return true;
+}
+
+bool RecordLog::readSegmentHeader(uint32_t segment, SegmentHeader& out) {
+    char path[STORAGE_PATH_MAX];
+    segmentPath(slotFor(segment), path, sizeof(path));
+
+    // El id detecta slots reutilizados por una vuelta posterior del anillo
+    bool ok = storage.read(path, 0, &out, SEGMENT_HEADER_SIZE) &&
+         out.magic == SEGMENT_MAGIC &&
+         out.segmentId == segment &&
+         out.crc == crc32(&out, offsetof(SegmentHeader, crc));
+    if (ok) {
+        segmentFirst[slotFor(segment)] = out.firstSequence;
+    }
+    return ok;
+}
+
+// Lee los headers de los segmentos vivos (primera secuencia de cada uno) y
+// recupera la cola. Cubre los cortes entre abrir un segmento y actualizar el
+// cursor: cabeza ya desalojada o cola ya abierta.
+bool RecordLog::recoverSegments() {
+    uint32_t loadedHead = headSegment;
+    uint32_t loadedTail = tailSegment;
+    SegmentHeader header;
+
+    while (headSegment <= tailSegment && !readSegmentHeader(headSegment, header)) {
+        headSegment++;
+    }
+    if (headSegment > tailSegment) {
+        TLOG("[LOG] WARN: Segmentos del log ilegibles, se reinicia el log.");
+        return false;
+    }
+    for (uint32_t segment = headSegment + 1; segment <= tailSegment; segment++) {
+        if (!readSegmentHeader(segment, header)) {
+            TLOG("[LOG] WARN: Segmento %lu ilegible, se reinicia el log.", static_cast<unsigned long>(segment));
+            return false;
+        }
+    }
+    if (tailSegment + 1 - headSegment < segmentSlots && readSegmentHeader(tailSegment + 1, header)) {
+        tailSegment++;
+    }
+
+    uint32_t headFirst = segmentFirst[slotFor(headSegment)];
+    if (headSequence < headFirst) {
+        headSequence = headFirst;
+    }
+
+    loadSummaries();
+    recoverTail();
+    if (headSequence > tailSequence) {
+        headSequence = tailSequence;
+    }
+    if (headSegment != loadedHead || tailSegment != loadedTail) {
+        writeCursor();
+    }
+    return true;
+}
+
+// Recorre los bloques del segmento en escritura mientras tengan la secuencia
+// esperada y CRC válido; lo que sigue es una escritura incompleta.
+void RecordLog::recoverTail() {
+    tailSequence = segmentFirst[slotFor(tailSegment)];
+    tailOffset = SEGMENT_HEADER_SIZE;
+    summaries[slotFor(tailSegment)] = emptySummary(tailSegment);
+
+    char path[STORAGE_PATH_MAX];
+    segmentPath(slotFor(tailSegment), path, sizeof(path));
+    uint32_t fileSize = storage.size(path);
+    BlockHeader header;
+    uint8_t payload[BLOCK_PAYLOAD_MAX];
+    while (tailOffset + BLOCK_HEADER_SIZE <= fileSize) {
+        if (!storage.read(path, tailOffset, &header, BLOCK_HEADER_SIZE) ||
+            header.firstSequence != tailSequence ||
+            header.count == 0 ||
+            header.length > BLOCK_PAYLOAD_MAX ||
+            !storage.read(path, tailOffset + BLOCK_HEADER_SIZE, payload, header.length) ||
+            header.crc != blockCrc(header, payload)) {
+            break;
+        }
+
+        // El resumen del segmento abierto no está en el índice: se rehace
+        SeriesDecoder decoder;
+        decoder.begin(payload, header.length, header.sourceId);
+        SeriesPoint point;
+        while (decoder.next(point)) {
+            noteBlock(summaries[slotFor(tailSegment)], header.sourceId, point.timestamp, point.timestamp);
+        }
+        tailSequence += header.count;
+        tailOffset += BLOCK_HEADER_SIZE + header.length;
+    }
+
+    if (fileSize > tailOffset) {
+        storage.truncate(path, tailOffset);
+    }
+}
+
+bool RecordLog::startSegment(uint32_t segment, uint32_t firstSequence) {
+    char path[STORAGE_PATH_MAX];
+    segmentPath(slotFor(segment), path, sizeof(path));
+    // Slot reutilizado: se descartan los bloques de la vuelta anterior
+    storage.remove(path);
+
+    SegmentHeader header;
+    header.magic = SEGMENT_MAGIC;
+    header.segmentId = segment;
+    header.firstSequence = firstSequence;
+    header.crc = crc32(&header, offsetof(SegmentHeader, crc));
+
+    if (!storage.write(path, 0, &header, SEGMENT_HEADER_SIZE)) {
+        TLOG("[LOG] ERROR: No se pudo crear segmento del log.");
+        return false;
+    }
+
+    segmentFirst[slotFor(segment)] = firstSequence;
+    summaries[slotFor(segment)] = emptySummary(segment);
+    tailOffset = SEGMENT_HEADER_SIZE;
+    counters.flashBytes += SEGMENT_HEADER_SIZE;
+    return true;
+}
+
+// Las entradas del índice que no corresponden al segmento vivo del slot
+// (índice perdido o de otra vuelta) no descartan nada en las consultas.
+void RecordLog::loadSummaries() {
+    for (uint32_t segment = headSegment; segment < tailSegment; segment++) {
+        SegmentSummary& summary = summaries[slotFor(segment)];
+        bool ok = storage.read(INDEX_PATH, slotFor(segment) * SUMMARY_SIZE, &summary, SUMMARY_SIZE) &&
+                  summary.segmentId == segment &&
+                  summary.crc == crc32(&summary, offsetof(SegmentSummary, crc));
+        if (!ok) {
+            summary = unknownSummary(segment);
+        }
+    }
+}
+
+bool RecordLog::writeSummary(uint32_t segment) {
+    SegmentSummary& summary = summaries[slotFor(segment)];
+    summary.crc = crc32(&summary, offsetof(SegmentSummary, crc));
+    if (!storage.write(INDEX_PATH, slotFor(segment) * SUMMARY_SIZE, &summary, SUMMARY_SIZE)) {
+        TLOG("[LOG] WARN: No se pudo escribir el índice del segmento %lu.", static_cast<unsigned long>(segment));
+        return false;
+    }
+    counters.flashBytes += SUMMARY_SIZE;
+    return true;
+}
+
+void RecordLog::noteBlock(SegmentSummary& summary, uint16_t sourceId, uint32_t minTimestamp, uint32_t maxTimestamp) {
+    if (minTimestamp < summary.minTimestamp) {
+        summary.minTimestamp = minTimestamp;
+    }
+    if (maxTimestamp > summary.maxTimestamp) {
+        summary.maxTimestamp = maxTimestamp;
+    }
+    summary.sourceBits |= 1UL << (sourceId % 32);
+}
+
+bool RecordLog::segmentMayMatch(uint32_t segment, const RecordFilter& filter) const {
+    const SegmentSummary& summary = summaries[slotFor(segment)];
+    if (summary.segmentId != segment) {
+        return true;
+    }
+    if (summary.maxTimestamp < filter.since) {
+        return false;
+    }
+    return !filter.bySource || (summary.sourceBits & (1UL << (filter.sourceId % 32))) != 0;
+}
+
+bool RecordLog::appendPoint(OpenBlock& block, const SeriesPoint& point) {
+    if (!block.encoder.append(point)) {
+        return false;
+    }
+    if (block.encoder.count() == 1 || point.timestamp < block.minTimestamp) {
+        block.minTimestamp = point.timestamp;
+    }
+    if (block.encoder.count() == 1 || point.timestamp > block.maxTimestamp) {
+        block.maxTimestamp = point.timestamp;
+    }
+    return true;
+}
+
+void RecordLog::removeSegment(uint32_t segment) {
+    char path[STORAGE_PATH_MAX];
+    segmentPath(slotFor(segment), path, sizeof(path));
+    if (storage.remove(path)) {
+        counters.segmentsRemoved++;
+    }
+}
+
+// Anillo lleno con registros sin confirmar en la cabeza: el segmento nuevo
+// (`next`, mismo slot que la cabeza) se arma aparte con los sobrevivientes
+// según la política de retención y reemplaza a la cabeza con un rename
+// atómico. Hasta entonces la cabeza sigue intacta en flash y en RAM: un
+// corte o un error dejan el log como estaba. Un corte después del rename y
+// antes del cursor lo resuelve recoverSegments (cabeza con otro id, cola+1
+// legible).
+bool RecordLog::compactHeadSegment(uint32_t next) {
+    struct SourceShare {
+        uint16_t sourceId;
+        uint16_t total;
+        uint16_t candidates;
+        uint16_t quota;
+        uint16_t seen;
+        uint16_t candidatesSeen;
+        uint32_t lastKept;
+        bool lastWasKept;
+    };
+    SourceShare shares[RETENTION_MAX_SOURCES];
+    uint8_t sourceCount = 0;
+    bool overflow = false;
+
+    uint32_t from = headSequence > segmentFirst[slotFor(headSegment)] ? headSequence : segmentFirst[slotFor(headSegment)];
+    uint32_t to = segmentFirst[slotFor(headSegment + 1)];
+    if (to < from) {
+        to = from;
+    }
+    survivorCount = 0;
+
+    RecordReader reader(*this);
+    reader.open(from, to - from);
+    StoredRecord record;
+
+    // Pasada 1: registros por fuente y cuántos pasan el filtro de resolución
+    for (size_t i = 0; i < reader.size(); i++) {
+        if (!reader.read(i, record)) {
+            continue;
+        }
+        SourceShare* share = nullptr;
+        for (uint8_t s = 0; s < sourceCount; s++) {
+            if (shares[s].sourceId == record.sourceId) {
+                share = &shares[s];
+                break;
+            }
+        }
+        if (!share) {
+            if (sourceCount >= RETENTION_MAX_SOURCES) {
+                overflow = true;  // sólo su último punto, ver keepNewestPoints
+                continue;
+            }
+            share = &shares[sourceCount++];
+            *share = SourceShare();
+            share->sourceId = record.sourceId;
+        }
+        bool keep = share->total == 0 || (record.timestamp - share->lastKept) >= retention.resolutionSeconds;
+        share->total++;
+        share->lastWasKept = keep;
+        if (keep) {
+            share->candidates++;
+            share->lastKept = record.timestamp;
+        }
+    }
+
+    // Reparto justo de la cuota: cada ronda divide lo que queda entre las
+    // fuentes que todavía tienen candidatos. Con hasta RETENTION_MAX_SOURCES
+    // fuentes la primera ronda asegura al menos un punto por fuente.
+    uint8_t remaining = COMPACT_MAX_SURVIVORS;
+    for (uint8_t s = 0; s < sourceCount; s++) {
+        if (!shares[s].lastWasKept) {
+            shares[s].candidates++;  // el último punto siempre se conserva
+        }
+        shares[s].lastKept = 0;
+    }
+    while (remaining > 0) {
+        uint8_t needy = 0;
+        for (uint8_t s = 0; s < sourceCount; s++) {
+            if (shares[s].quota < shares[s].candidates) {
+                needy++;
+            }
+        }
+        if (needy == 0) {
+            break;
+        }
+        uint8_t portion = remaining / needy > 0 ? remaining / needy : 1;
+        for (uint8_t s = 0; s < sourceCount && remaining > 0; s++) {
+            uint16_t missing = shares[s].candidates - shares[s].quota;
+            uint16_t give = missing < portion ? missing : portion;
+            shares[s].quota += give;
+            remaining -= give;
+        }
+    }
+
+    // Pasada 2: mismos candidatos; de cada fuente se toman `quota` puntos
+    // repartidos de forma pareja, incluido el último
+    for (size_t i = 0; i < reader.size(); i++) {
+        if (!reader.read(i, record)) {
+            continue;
+        }
+        SourceShare* share = nullptr;
+        for (uint8_t s = 0; s < sourceCount; s++) {
+            if (shares[s].sourceId == record.sourceId) {
+                share = &shares[s];
+                break;
+            }
+        }
+        if (!share) {
+            continue;
+        }
+        bool keep = share->seen == 0 || (record.timestamp - share->lastKept) >= retention.resolutionSeconds;
+        if (keep) {
+            share->lastKept = record.timestamp;
+        }
+        share->seen++;
+        if (!keep && share->seen < share->total) {
+            continue;
+        }
+
+        uint32_t j = share->candidatesSeen++;
+        bool selected = (j * share->quota) / share->candidates != ((j + 1) * share->quota) / share->candidates;
+        if (selected && survivorCount < COMPACT_MAX_SURVIVORS) {
+            survivors[survivorCount++] = record;
+        }
+    }
+
+    SegmentBuild build;
+    build.offset = 0;
+    build.sequence = tailSequence;
+    build.summary = emptySummary(next);
+    uint32_t kept = survivorCount;
+
+    SegmentHeader header;
+    header.magic = SEGMENT_MAGIC;
+    header.segmentId = next;
+    header.firstSequence = tailSequence;
+    header.crc = crc32(&header, offsetof(SegmentHeader, crc));
+
+    storage.remove(SCRATCH_PATH);  // resto de un corte anterior
+    bool ok = storage.write(SCRATCH_PATH, 0, &header, SEGMENT_HEADER_SIZE);
+    if (ok) {
+        build.offset = SEGMENT_HEADER_SIZE;
+        counters.flashBytes += SEGMENT_HEADER_SIZE;
+        ok = writeSurvivors(build);
+    }
+    if (ok && overflow) {
+        uint16_t tracked[RETENTION_MAX_SOURCES];
+        for (uint8_t s = 0; s < sourceCount; s++) {
+            tracked[s] = shares[s].sourceId;
+        }
+        ok = keepNewestPoints(reader, from, to, tracked, sourceCount, build, kept);
+    }
+    reader.close();
+
+    char path[STORAGE_PATH_MAX];
+    segmentPath(slotFor(next), path, sizeof(path));
+    if (!ok || !storage.rename(SCRATCH_PATH, path)) {
+        storage.remove(SCRATCH_PATH);
+        TLOG("[LOG] ERROR: No se pudo compactar el segmento %lu.", static_cast<unsigned long>(headSegment));
+        return false;
+    }
+
+    uint32_t dropped = (to - from) - kept;
+    counters.compactions++;
+    counters.recordsCompacted += dropped;
+    counters.segmentsRemoved++;
+    TLOG("[LOG] Log lleno: segmento %lu compactado, %lu de %lu registros conservados.",
+         static_cast<unsigned long>(headSegment),
+         static_cast<unsigned long>(kept),
+         static_cast<unsigned long>(to - from));
+
+    if (to > headSequence) {
+        headSequence = to;
+    }
+    headSegment++;
+    segmentFirst[slotFor(next)] = tailSequence;
+    summaries[slotFor(next)] = build.summary;
+    tailSegment = next;
+    tailSequence = build.sequence;
+    tailOffset = build.offset;
+    return true;
+}
+
+// Escribe los sobrevivientes agrupados por fuente. Caben siempre en un
+// segmento recién abierto: COMPACT_MAX_SURVIVORS * MAX_POINT_BYTES más un
+// header por fuente es menor que SEGMENT_BYTES.
+bool RecordLog::writeSurvivors(SegmentBuild& build) {
+    bool written[COMPACT_MAX_SURVIVORS] = {};
+    OpenBlock block;
+    for (uint8_t i = 0; i < survivorCount; i++) {
+        if (written[i]) {
+            continue;
+        }
+        block.sourceId = survivors[i].sourceId;
+        block.encoder.begin(block.payload, BLOCK_PAYLOAD_MAX);
+        for (uint8_t j = i; j < survivorCount; j++) {
+            if (written[j] || survivors[j].sourceId != block.sourceId) {
+                continue;
+            }
+            if (!appendPoint(block, survivors[j])) {
+                if (!buildBlock(build, block)) {
+                    return false;
+                }
+                block.encoder.begin(block.payload, BLOCK_PAYLOAD_MAX);
+                appendPoint(block, survivors[j]);
+            }
+            written[j] = true;
+        }
+        if (!buildBlock(build, block)) {
+            return false;
+        }
+    }
+    survivorCount = 0;
+    return true;
+}
+
+// Fuentes que no entraron en la tabla de cuotas: conservan su último punto
+// en [from, to). Se recorren los headers de bloque de la cabeza por rondas,
+// de a RETENTION_MAX_SOURCES ids en orden creciente, para no necesitar una
+// tabla por fuente. Cada punto va en un bloque propio mientras quede lugar
+// para el bloque que disparó el cambio de segmento.
+bool RecordLog::keepNewestPoints(RecordReader& reader, uint32_t from, uint32_t to,
+                                 const uint16_t* tracked, uint8_t trackedCount,
+                                 SegmentBuild& build, uint32_t& kept) {
+    struct Newest {
+        uint16_t sourceId;
+        uint32_t sequence;
+    };
+    Newest round[RETENTION_MAX_SOURCES];
+    int32_t handled = -1;  // ids ya atendidos: <= handled
+    uint32_t lost = 0;
+
+    char path[STORAGE_PATH_MAX];
+    segmentPath(slotFor(headSegment), path, sizeof(path));
+    uint32_t fileSize = storage.size(path);
+
+    while (true) {
+        uint8_t pending = 0;
+        BlockHeader header;
+        for (uint32_t offset = SEGMENT_HEADER_SIZE;
+             offset + BLOCK_HEADER_SIZE <= fileSize && storage.read(path, offset, &header, BLOCK_HEADER_SIZE);
+             offset += BLOCK_HEADER_SIZE + header.length) {
+            uint32_t last = header.firstSequence + header.count - 1;
+            if (header.count == 0 || last < from || last >= to || header.sourceId <= handled) {
+                continue;
+            }
+            bool isTracked = false;
+            for (uint8_t s = 0; s < trackedCount && !isTracked; s++) {
+                isTracked = tracked[s] == header.sourceId;
+            }
+            if (isTracked) {
+                continue;
+            }
+
+            // Ronda ordenada por id; un bloque posterior de la misma fuente
+            // trae su punto más nuevo
+            uint8_t at = 0;
+            while (at < pending && round[at].sourceId < header.sourceId) {
+                at++;
+            }
+            if (at < pending && round[at].sourceId == header.sourceId) {
+                round[at].sequence = last;
+                continue;
+            }
+            if (at == RETENTION_MAX_SOURCES) {
+                continue;  // queda para la ronda siguiente
+            }
+            if (pending == RETENTION_MAX_SOURCES) {
+                pending--;
+            }
+            memmove(&round[at + 1], &round[at], (pending - at) * sizeof(Newest));
+            round[at].sourceId = header.sourceId;
+            round[at].sequence = last;
+            pending++;
+        }
+        if (pending == 0) {
+            break;
+        }
+
+        OpenBlock block;
+        StoredRecord record;
+        for (uint8_t i = 0; i < pending; i++) {
+            block.sourceId = round[i].sourceId;
+            block.encoder.begin(block.payload, BLOCK_PAYLOAD_MAX);
+            if (!reader.read(round[i].sequence - from, record) || !appendPoint(block, record) ||
+                build.offset + 2 * BLOCK_HEADER_SIZE + block.encoder.size() + BLOCK_PAYLOAD_MAX > SEGMENT_BYTES) {
+                lost++;
+                continue;
+            }
+            if (!buildBlock(build, block)) {
+                return false;
+            }
+            kept++;
+        }
+        handled = round[pending - 1].sourceId;
+    }
+
+    if (lost > 0) {
+        TLOG("[LOG] WARN: %lu fuentes sin lugar al compactar el segmento %lu.",
+             static_cast<unsigned long>(lost), static_cast<unsigned long>(headSegment));
+    }
+    return true;
+}
+
+bool RecordLog::rollSegment() {
+    // El segmento que se cierra ya no cambia: su resumen pasa al índice
+    writeSummary(tailSegment);
+
+    uint32_t next = tailSegment + 1;
+    if (next - headSegment >= segmentSlots) {
+        if (headSequence < segmentFirst[slotFor(headSegment + 1)]) {
+            if (!compactHeadSegment(next)) {
+                return false;
+            }
+            writeCursor();
+            return true;
+        }
+        // Todo confirmado: se libera sin compactar
+        removeSegment(headSegment);
+        headSegment++;
+    }
+    if (!startSegment(next, tailSequence)) {
+        ready = false;
+        return false;
+    }
+    tailSegment = next;
+    writeCursor();
+    return true;
+}
+
+// Mueve la cabeza. Los segmentos consumidos se conservan para consultas
+// hasta que rollSegment necesite el slot. No persiste el cursor: lo decide
+// el llamador.
+void RecordLog::advanceHead(uint32_t newHead) {
+    if (newHead > tailSequence) {
+        newHead = tailSequence;
+    }
+    headSequence = newHead;
+}
+
+bool RecordLog::append(const SeriesPoint& point) {
+    if (!ready) {
+        return false;
+    }
+
+    unsigned long now = millis();
+    OpenBlock* target = nullptr;
+    OpenBlock* freeBlock = nullptr;
+    OpenBlock* oldest = nullptr;
+    for (OpenBlock& block : openBlocks) {
+        if (block.encoder.count() == 0) {
+            if (!freeBlock) {
+                freeBlock = &block;
+            }
+        } else if (block.sourceId == point.sourceId) {
+            target = &block;
+        } else if (!oldest || (now - block.since) > (now - oldest->since)) {
+            oldest = &block;
+        }
+    }
+
+    bool ok = true;
+    if (!target) {
+        if (!freeBlock) {
+            // Más fuentes que bloques abiertos: se cierra el más antiguo
+            ok = sealBlock(*oldest);
+            freeBlock = oldest;
+        }
+        target = freeBlock;
+        target->sourceId = point.sourceId;
+        target->since = now;
+        target->encoder.begin(target->payload, BLOCK_PAYLOAD_MAX);
+    }
+
+    if (!appendPoint(*target, point)) {
+        ok = sealBlock(*target) && ok;
+        target->sourceId = point.sourceId;
+        target->since = now;
+        target->encoder.begin(target->payload, BLOCK_PAYLOAD_MAX);
+        appendPoint(*target, point);
+    }
+
+    counters.recordsAppended++;
+    return ok;
+}
+
+void RecordLog::poll() {
+    unsigned long now = millis();
+    for (OpenBlock& block : openBlocks) {
+        if (block.encoder.count() > 0 && (now - block.since) >= STAGE_MAX_AGE_MS) {
+            sealBlock(block);
+        }
+    }
+    storage.poll();
+}
+
+// Cierra los bloques del más antiguo al más nuevo para mantener el orden
+// aproximado de llegada entre fuentes.
+bool RecordLog::flush() {
+    bool ok = true;
+    while (true) {
+        unsigned long now = millis();
+        OpenBlock* oldest = nullptr;
+        for (OpenBlock& block : openBlocks) {
+            if (block.encoder.count() > 0 && (!oldest || (now - block.since) > (now - oldest->since))) {
+                oldest = &block;
+            }
+        }
+        if (!oldest) {
+            // Lo retenido por una capa en RAM del backend también llega a flash
+            return storage.sync() && ok;
+        }
+        ok = sealBlock(*oldest) && ok;
+    }
+}
+
+bool RecordLog::sealBlock(OpenBlock& block) {
+    if (block.encoder.count() == 0) {
+        return true;
+    }
+    bool ok = ready && writeBlock(block);
+    // Libera el bloque aunque falle la escritura: no se reintenta en bucle
+    block.encoder.begin(block.payload, BLOCK_PAYLOAD_MAX);
+    return ok;
+}
+
+// Un commit por bloque. Las secuencias se asignan aquí, al cerrar el bloque.
+bool RecordLog::writeBlock(const OpenBlock& block) {
+    uint32_t blockBytes = BLOCK_HEADER_SIZE + block.encoder.size();
+    if (tailOffset + blockBytes > SEGMENT_BYTES && !rollSegment()) {
+        return false;
+    }
+
+    char path[STORAGE_PATH_MAX];
+    segmentPath(slotFor(tailSegment), path, sizeof(path));
+    if (!storeBlock(path, tailOffset, tailSequence, block)) {
+        return false;
+    }
+    tailOffset += blockBytes;
+    tailSequence += block.encoder.count();
+    noteBlock(summaries[slotFor(tailSegment)], block.sourceId, block.minTimestamp, block.maxTimestamp);
+    return true;
+}
+
+bool RecordLog::buildBlock(SegmentBuild& build, const OpenBlock& block) {
+    if (!storeBlock(SCRATCH_PATH, build.offset, build.sequence, block)) {
+        return false;
+    }
+    build.offset += BLOCK_HEADER_SIZE + block.encoder.size();
+    build.sequence += block.encoder.count();
+    noteBlock(build.summary, block.sourceId, block.minTimestamp, block.maxTimestamp);
+    return true;
+}
+
+bool RecordLog::storeBlock(const char* path, uint32_t offset, uint32_t firstSequence, const OpenBlock& block) {
+    uint32_t blockBytes = BLOCK_HEADER_SIZE + block.encoder.size();
+    BlockHeader header;
+    header.firstSequence = firstSequence;
+    header.sourceId = block.sourceId;
+    header.count = block.encoder.count();
+    header.length = static_cast<uint8_t>(block.encoder.size());
+    header.crc = blockCrc(header, block.payload);
+
+    // Header y payload juntos: un solo write() es un solo commit
+    uint8_t encoded[BLOCK_HEADER_SIZE + BLOCK_PAYLOAD_MAX];
+    memcpy(encoded, &header, BLOCK_HEADER_SIZE);
+    memcpy(encoded + BLOCK_HEADER_SIZE, block.payload, header.length);
+
+    if (!storage.write(path, offset, encoded, blockBytes)) {
+        TLOG("[LOG] ERROR: Fallo al escribir bloque en log.");
+        return false;
+    }
+
+    counters.flushes++;
+    counters.payloadBytes += blockBytes;
+    counters.flashBytes += blockBytes;
+    return true;
+}
+
+bool RecordLog::dropOldest(size_t records) {
+    if (!ready) {
+        return false;
+    }
+    if (records == 0) {
+        return true;
+    }
+    if (records > count()) {
+        records = count();
+    }
+    advanceHead(headSequence + records);
+    return writeCursor();
+}
+
+bool RecordLog::clear() {
+    if (!ready) {
+        return false;
+    }
+    // Lo acumulado en RAM se descarta sin llegar a flash
+    for (OpenBlock& block : openBlocks) {
+        block.encoder.begin(block.payload, BLOCK_PAYLOAD_MAX);
+    }
+    advanceHead(tailSequence);
+    return writeCursor();
+}
+
+RecordReader::RecordReader(RecordLog& source)
+    : log(source),
+      first(0),
+      total(0),
+      blockLoaded(false),
+      blockSegment(0),
+      blockOffset(0),
+      block(),
+      payload(),
+      decoder(),
+      decodedNext(0),
+      current() {}
+
+// Sólo lee flash: quien necesite lo acumulado en RAM llama antes a flush()
+void RecordReader::open(uint32_t firstSequence, size_t count) {
+    first = firstSequence;
+    total = count;
+    blockLoaded = false;
+}
+
+void RecordReader::close() {
+    first = 0;
+    total = 0;
+    blockLoaded = false;
+}
+
+bool RecordReader::read(size_t index, StoredRecord& out) {
+    if (index >= total) {
+        return false;
+    }
+    uint32_t sequence = first + index;
+    if (sequence < log.retainedSequence()) {
+        // Segmento liberado por el log mientras se transfería
+        return false;
+    }
+
+    if (!blockLoaded ||
+        sequence < block.firstSequence ||
+        sequence >= block.firstSequence + block.count) {
+        if (!loadBlock(sequence)) {
+            return false;
+        }
+    }
+
+    // Hacia atrás dentro del bloque (RESEND): se decodifica desde el inicio
+    if (decodedNext > block.firstSequence && sequence + 1 < decodedNext) {
+        decoder.begin(payload, block.length, block.sourceId);
+        decodedNext = block.firstSequence;
+    }
+    while (decodedNext <= sequence) {
+        if (!decoder.next(current)) {
+            blockLoaded = false;
+            return false;
+        }
+        decodedNext++;
+    }
+
+    static_cast<SeriesPoint&>(out) = current;
+    out.sequence = sequence;
+    return true;
+}
+
+// Busca el bloque que contiene sequence. En lectura secuencial continúa desde
+// el bloque anterior en lugar de recorrer el segmento desde el inicio.
+bool RecordReader::loadBlock(uint32_t sequence) {
+    uint32_t segment = log.tailSegment;
+    while (segment > log.headSegment && log.segmentFirst[log.slotFor(segment)] > sequence) {
+        segment--;
+    }
+    if (log.segmentFirst[log.slotFor(segment)] > sequence) {
+        return false;
+    }
+
+    uint32_t offset = SEGMENT_HEADER_SIZE;
+    if (blockLoaded && blockSegment == segment && sequence >= block.firstSequence + block.count) {
+        offset = blockOffset + BLOCK_HEADER_SIZE + block.length;
+    }
+    blockLoaded = false;
+
+    // El backend mantiene abierto el segmento entre lecturas sucesivas
+    char path[STORAGE_PATH_MAX];
+    RecordLog::segmentPath(log.slotFor(segment), path, sizeof(path));
+    SegmentHeader segmentHeader;
+    if (!log.storage.read(path, 0, &segmentHeader, SEGMENT_HEADER_SIZE) ||
+        segmentHeader.segmentId != segment) {
+        return false;
+    }
+
+    BlockHeader header;
+    bool found = false;
+    while (log.storage.read(path, offset, &header, BLOCK_HEADER_SIZE) &&
+           header.count > 0 &&
+           header.length <= RecordLog::BLOCK_PAYLOAD_MAX &&
+           sequence >= header.firstSequence) {
+        if (sequence < header.firstSequence + header.count) {
+            found = log.storage.read(path, offset + BLOCK_HEADER_SIZE, payload, header.length) &&
+                    header.crc == RecordLog::blockCrc(header, payload);
+            if (found) {
+                block = header;
+                blockSegment = segment;
+                blockOffset = offset;
+            }
+            break;
+        }
+        offset += BLOCK_HEADER_SIZE + header.length;
+    }
+
+    if (!found) {
+        return false;
+    }
+    blockLoaded = true;
+    decoder.begin(payload, block.length, block.sourceId);
+    decodedNext = block.firstSequence;
+    return true;
+}
+
+RecordQuery::RecordQuery(RecordLog& source)
+    : log(source),
+      reader(source),
+      ranges(),
+      rangeCount(0),
+      total(0),
+      resume(0) {}
+
+void RecordQuery::close() {
+    reader.close();
+    rangeCount = 0;
+    total = 0;
+    resume = 0;
+}
+
+bool RecordQuery::addMatch(uint32_t sequence) {
+    if (rangeCount > 0) {
+        Range& last = ranges[rangeCount - 1];
+        if (last.firstSequence + last.count == sequence) {
+            last.count++;
+            return true;
+        }
+    }
+    if (rangeCount >= MAX_RANGES) {
+        return false;
+    }
+    ranges[rangeCount].firstSequence = sequence;
+    ranges[rangeCount].count = 1;
+    rangeCount++;
+    return true;
+}
+
+// Sólo lee flash, como RecordReader: quien quiera incluir lo acumulado en RAM
+// llama antes a RecordLog::flush().
+size_t RecordQuery::run(const RecordFilter& filter, uint32_t fromSequence, size_t limit) {
+    close();
+    uint32_t windowFirst = log.retainedSequence();
+    reader.open(windowFirst, log.nextSequence() - windowFirst);
+    if (fromSequence < windowFirst) {
+        fromSequence = windowFirst;
+    }
+
+    StoredRecord record;
+    for (uint32_t segment = log.headSegment; segment <= log.tailSegment; segment++) {
+        uint32_t segmentEnd = segment < log.tailSegment ? log.segmentFirst[log.slotFor(segment + 1)] : log.nextSequence();
+        if (segmentEnd <= fromSequence || !log.segmentMayMatch(segment, filter)) {
+            continue;
+        }
+        uint32_t sequence = log.segmentFirst[log.slotFor(segment)];
+        if (sequence < fromSequence) {
+            sequence = fromSequence;
+        }
+        for (; sequence < segmentEnd; sequence++) {
+            if (!reader.read(sequence - windowFirst, record) || !filter.matches(record)) {
+                continue;
+            }
+            if (total >= limit || !addMatch(sequence)) {
+                resume = sequence;
+                return total;
+            }
+            total++;
+        }
+    }
+    return total;
+}
+
+bool RecordQuery::read(size_t index, StoredRecord& out) {
+    if (index >= total) {
+        return false;
+    }
+    uint32_t windowFirst = reader.firstSequence();
+    for (uint8_t i = 0; i < rangeCount; i++) {
+        if (index < ranges[i].count) {
+            return reader.read(ranges[i].firstSequence + index - windowFirst, out);
+        }
+        index -= ranges[i].count;
+    }
+    return false;
+}
@@ -0,0 +1,342 @@
+/*
+ * RECORD_LOG.H - Log circular segmentado de bloques comprimidos
+ *                (END_NODE_REPEATER)
+ *
+ * Los registros se agrupan por fuente en bloques comprimidos
+ * (common/series_codec.h) y los bloques se escriben en segmentos de
+ * SEGMENT_BYTES (/lora_seg<N>.bin) que se reutilizan en anillo:
+ *
+ *   [SegmentHeader][BlockHeader][payload][BlockHeader][payload]...
+ *
+ * Un archivo de cursor (/lora_log.cur) persiste la cabeza (registro más
+ * antiguo sin confirmar) y los segmentos de cabeza y cola:
+ *
+ *   - append: acumula el registro en el bloque abierto de su fuente (RAM).
+ *     El bloque se escribe con un solo commit al llenarse, tras
+ *     STAGE_MAX_AGE_MS o antes de una transferencia. Las secuencias se
+ *     asignan al cerrar el bloque, así que cada bloque cubre un rango
+ *     contiguo.
+ *   - dropOldest / TRANSFER_OK: avanza la cabeza y reescribe el cursor
+ *     (24 bytes). Los registros confirmados siguen en flash, disponibles para
+ *     consultas (RecordQuery), hasta que el anillo necesita el segmento.
+ *   - anillo lleno: al abrir un segmento nuevo se libera el más antiguo; si
+ *     aún tiene registros sin confirmar se compactan según RetentionPolicy.
+ *     El segmento compactado se escribe aparte (/lora_seg.new) y reemplaza
+ *     a la cabeza con un rename, así que un corte nunca pierde la cabeza
+ *     antes de que sus sobrevivientes estén en flash.
+ *
+ * La época (/lora_log.epc) cambia cada vez que el log se reinicia y las
+ * secuencias vuelven a empezar; viaja en START_BATCH para que el gateway no
+ * reanude un lote guardado de un log anterior.
+ *
+ * Un índice disperso (/lora_log.idx) guarda por segmento el rango de
+ * timestamps y un bitmap de fuentes, escrito al cerrar el segmento; las
+ * consultas sólo leen los segmentos que pueden contener resultados.
+ *
+ * Cada bloque lleva su secuencia inicial y CRC-32; al arrancar sólo se
+ * recorre el segmento en escritura para recuperar la cola. Los archivos se
+ * acceden a través de un StorageBackend (storage_backend.h).
+ */
+
+#ifndef RECORD_LOG_H
+#define RECORD_LOG_H
+
+#include <Arduino.h>
+#include "../common/series_codec.h"
+#include "storage_backend.h"
+
+// Registro decodificado del log
+struct StoredRecord : SeriesPoint {
+    uint32_t sequence;
+};
+
+struct __attribute__((packed)) LogCursor {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t segmentSlots;
+    uint16_t segmentBytes;
+    uint32_t headSequence;   // registro más antiguo pendiente
+    uint32_t headSegment;
+    uint32_t tailSegment;    // segmento en escritura
+    uint32_t crc;            // CRC-32 de los campos anteriores
+};
+
+struct __attribute__((packed)) SegmentHeader {
+    uint32_t magic;
+    uint32_t segmentId;
+    uint32_t firstSequence;
+    uint32_t crc;            // CRC-32 de los campos anteriores
+};
+
+struct __attribute__((packed)) LogEpoch {
+    uint32_t magic;
+    uint32_t epoch;
+    uint32_t crc;            // CRC-32 de los campos anteriores
+};
+
+// Entrada del índice por slot: se escribe al cerrar el segmento
+struct __attribute__((packed)) SegmentSummary {
+    uint32_t segmentId;
+    uint32_t minTimestamp;
+    uint32_t maxTimestamp;
+    uint32_t sourceBits;     // bit (sourceId % 32) por cada fuente presente
+    uint32_t crc;            // CRC-32 de los campos anteriores
+};
+
+struct __attribute__((packed)) BlockHeader {
+    uint32_t firstSequence;
+    uint16_t sourceId;
+    uint8_t count;
+    uint8_t length;          // bytes de payload comprimido
+    uint32_t crc;            // CRC-32 de los campos anteriores + payload
+};
+
+/*
+ * POLÍTICA DE RETENCIÓN
+ *
+ * Al compactar el segmento más antiguo, cada fuente conserva como mucho un
+ * punto cada resolutionSeconds y una cuota justa de COMPACT_MAX_SURVIVORS.
+ * El último punto de cada fuente en el segmento se conserva siempre, así
+ * que ninguna fuente desaparece del historial; las fuentes que exceden
+ * RETENTION_MAX_SOURCES no reciben cuota y conservan sólo ese punto. Los
+ * sobrevivientes vuelven a escribirse en la cola; en la siguiente vuelta se
+ * compactan otra vez, por lo que la historia antigua queda cada vez más
+ * espaciada.
+ */
+struct RetentionPolicy {
+    uint32_t resolutionSeconds;
+};
+
+// Filtro de consulta: timestamp mínimo y, opcionalmente, una fuente
+struct RecordFilter {
+    uint32_t since;
+    uint16_t sourceId;
+    bool bySource;
+
+    bool matches(const SeriesPoint& point) const {
+        return point.timestamp >= since && (!bySource || point.sourceId == sourceId);
+    }
+};
+
+// Contadores desde el arranque para medir la amplificación de escritura
+struct LogStats {
+    uint32_t recordsAppended;
+    uint32_t payloadBytes;   // bytes de bloque (header + payload comprimido)
+    uint32_t flashBytes;     // bytes escritos realmente (bloques + segmentos + cursor)
+    uint32_t flushes;        // commits de bloque (abrir, escribir, cerrar)
+    uint16_t cursorWrites;
+    uint16_t segmentsRemoved;
+    uint16_t compactions;
+    uint32_t recordsCompacted;   // registros descartados al compactar
+};
+
+class RecordReader;
+
+class RecordLog {
+public:
+    static constexpr uint32_t MAGIC = 0x33474C43;          // "CLG3"
+    static constexpr uint32_t SEGMENT_MAGIC = 0x47455343;  // "CSEG"
+    static constexpr uint32_t EPOCH_MAGIC = 0x48435045;    // "EPCH"
+    static constexpr uint8_t VERSION = 3;
+    static constexpr uint16_t SEGMENT_BYTES = 2048;
+    static constexpr uint8_t MAX_SEGMENT_SLOTS = 16;
+    static constexpr uint8_t BLOCK_PAYLOAD_MAX = 192;
+    static constexpr uint8_t MAX_OPEN_BLOCKS = 4;
+    static constexpr unsigned long STAGE_MAX_AGE_MS = 60000;
+    // Registro de tamaño fijo equivalente (secuencia + campos + CRC), para
+    // informar la tasa de compresión
+    static constexpr uint32_t FIXED_RECORD_BYTES = 28;
+    // Sobrevivientes por compactación (en RAM hasta reescribirse) y fuentes
+    // distintas que se reparten la cuota
+    static constexpr uint8_t COMPACT_MAX_SURVIVORS = 32;
+    static constexpr uint8_t RETENTION_MAX_SOURCES = 16;
+
+    RecordLog(StorageBackend& storage, uint8_t segments);
+
+    bool begin();
+    bool isReady() const { return ready; }
+    void setRetention(const RetentionPolicy& policy) { retention = policy; }
+
+    // Construye un punto a partir de los datos recibidos por LoRa
+    static SeriesPoint makeRecord(uint16_t sourceId,
+                                  float latitude,
+                                  float longitude,
+                                  uint32_t timestamp,
+                                  uint16_t voltageMilli,
+                                  float rssi,
+                                  float snr);
+
+    bool append(const SeriesPoint& point);
+    // Cierra los bloques abiertos que superaron STAGE_MAX_AGE_MS
+    void poll();
+    // Cierra y escribe todos los bloques abiertos (y vacía el backend)
+    bool flush();
+    bool dropOldest(size_t records);
+    bool clear();
+
+    // Registros ya escritos en flash / todavía en bloques abiertos
+    size_t count() const { return tailSequence - headSequence; }
+    size_t stagedCount() const;
+    uint32_t firstSequence() const { return headSequence; }
+    // Registro más antiguo todavía en flash (incluye los ya confirmados)
+    uint32_t retainedSequence() const { return segmentFirst[slotFor(headSegment)]; }
+    uint32_t nextSequence() const { return tailSequence; }
+    // Distinta de cero; cambia cuando el log se reinicia
+    uint32_t epoch() const { return logEpoch; }
+    uint8_t segmentsInUse() const { return static_cast<uint8_t>(tailSegment - headSegment + 1); }
+    uint8_t segmentCount() const { return segmentSlots; }
+
+    const LogStats& stats() const { return counters; }
+    // Bytes escritos en flash por cada byte útil, en centésimas (100 = 1.00)
+    uint32_t writeAmplificationX100() const;
+    // Commits de archivo (bloque + cursor) por registro, en centésimas
+    uint32_t commitsPerRecordX100() const;
+    // Tamaño fijo equivalente / bytes de bloque escritos, en centésimas
+    uint32_t compressionRatioX100() const;
+
+    // false sólo si el índice asegura que el segmento no tiene coincidencias
+    bool segmentMayMatch(uint32_t segment, const RecordFilter& filter) const;
+
+private:
+    friend class RecordReader;
+    friend class RecordQuery;
+
+    // Segmento compactado en construcción (SCRATCH_PATH)
+    struct SegmentBuild {
+        uint32_t offset;
+        uint32_t sequence;     // secuencia del próximo bloque
+        SegmentSummary summary;
+    };
+
+    struct OpenBlock {
+        unsigned long since;
+        uint16_t sourceId;
+        uint32_t minTimestamp;
+        uint32_t maxTimestamp;
+        SeriesEncoder encoder;
+        uint8_t payload[BLOCK_PAYLOAD_MAX];
+    };
+
+    StorageBackend& storage;
+    uint8_t segmentSlots;
+    bool ready;
+    uint32_t logEpoch;
+    uint32_t headSequence;
+    uint32_t tailSequence;
+    uint32_t headSegment;
+    uint32_t tailSegment;
+    uint32_t tailOffset;                         // bytes usados del segmento en escritura
+    uint32_t segmentFirst[MAX_SEGMENT_SLOTS];    // primera secuencia de cada slot
+    SegmentSummary summaries[MAX_SEGMENT_SLOTS]; // índice en RAM de cada slot
+    OpenBlock openBlocks[MAX_OPEN_BLOCKS];
+    RetentionPolicy retention;
+    SeriesPoint survivors[COMPACT_MAX_SURVIVORS];
+    uint8_t survivorCount;
+    LogStats counters;
+
+    bool loadCursor();
+    bool writeCursor();
+    bool resetLog();
+    void loadEpoch();
+    bool advanceEpoch();
+    bool recoverSegments();
+    void recoverTail();
+    bool startSegment(uint32_t segment, uint32_t firstSequence);
+    bool readSegmentHeader(uint32_t segment, SegmentHeader& out);
+    void loadSummaries();
+    bool writeSummary(uint32_t segment);
+    static void noteBlock(SegmentSummary& summary, uint16_t sourceId, uint32_t minTimestamp, uint32_t maxTimestamp);
+    static bool appendPoint(OpenBlock& block, const SeriesPoint& point);
+    bool sealBlock(OpenBlock& block);
+    bool writeBlock(const OpenBlock& block);
+    bool buildBlock(SegmentBuild& build, const OpenBlock& block);
+    bool storeBlock(const char* path, uint32_t offset, uint32_t firstSequence, const OpenBlock& block);
+    bool rollSegment();
+    bool compactHeadSegment(uint32_t next);
+    bool writeSurvivors(SegmentBuild& build);
+    bool keepNewestPoints(RecordReader& reader, uint32_t from, uint32_t to,
+                          const uint16_t* tracked, uint8_t trackedCount,
+                          SegmentBuild& build, uint32_t& kept);
+    void advanceHead(uint32_t newHead);
+    void removeSegment(uint32_t segment);
+    uint8_t slotFor(uint32_t segment) const { return segment % segmentSlots; }
+    static void segmentPath(uint8_t slot, char* out, size_t capacity);
+    static uint32_t blockCrc(const BlockHeader& header, const uint8_t* payload);
+};
+
+/*
+ * LECTOR DE LOTES EN STREAMING
+ *
+ * Recorre una ventana fija de secuencias del log sin copiarla a RAM: sólo
+ * guarda el bloque comprimido en curso y el estado del decoder. El acceso
+ * por índice permite atender RESEND; dentro del bloque se vuelve a
+ * decodificar desde el inicio.
+ */
+class RecordReader {
+public:
+    explicit RecordReader(RecordLog& source);
+
+    void open(uint32_t firstSequence, size_t count);
+    void close();
+    // false si el registro no existe, tiene CRC inválido o ya fue descartado
+    bool read(size_t index, StoredRecord& out);
+
+    size_t size() const { return total; }
+    uint32_t firstSequence() const { return first; }
+
+private:
+    RecordLog& log;
+    uint32_t first;
+    size_t total;
+    bool blockLoaded;
+    uint32_t blockSegment;
+    uint32_t blockOffset;      // posición del BlockHeader dentro del segmento
+    BlockHeader block;
+    uint8_t payload[RecordLog::BLOCK_PAYLOAD_MAX];
+    SeriesDecoder decoder;
+    uint32_t decodedNext;      // secuencia que entrega la próxima llamada a next()
+    SeriesPoint current;
+
+    bool loadBlock(uint32_t sequence);
+};
+
+/*
+ * CONSULTA POR RANGO DE TIEMPO / FUENTE
+ *
+ * Recorre los segmentos retenidos que el índice no descarta y guarda las
+ * coincidencias como rangos de secuencias contiguas (hasta MAX_RANGES), de
+ * modo que read(index) sirve igual que RecordReader para DATA y RESEND.
+ * Si el resultado no entra en el límite, resumeSequence() indica desde
+ * dónde continuar.
+ */
+class RecordQuery {
+public:
+    static constexpr uint8_t MAX_RANGES = 64;
+
+    explicit RecordQuery(RecordLog& source);
+
+    size_t run(const RecordFilter& filter, uint32_t fromSequence, size_t limit);
+    void close();
+    bool read(size_t index, StoredRecord& out);
+
+    size_t size() const { return total; }
+    // 0 si la consulta quedó completa
+    uint32_t resumeSequence() const { return resume; }
+
+private:
+    struct Range {
+        uint32_t firstSequence;
+        uint32_t count;
+    };
+
+    RecordLog& log;
+    RecordReader reader;
+    Range ranges[MAX_RANGES];
+    uint8_t rangeCount;
+    size_t total;
+    uint32_t resume;
+
+    bool addMatch(uint32_t sequence);
+};
+
+#endif
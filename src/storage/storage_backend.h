@@ -0,0 +1,54 @@
+/*
+ * STORAGE_BACKEND.H - Almacenamiento de archivos para el log de registros
+ *
+ * RecordLog sólo necesita archivos pequeños direccionados por offset
+ * (segmentos y cursor), así que la interfaz se limita a eso:
+ *
+ *   - FlashStorage:    InternalFS (nRF52) o LittleFS (ESP32)
+ *   - TieredStorage:   capa en RAM/PSRAM que agrupa escrituras sobre otro
+ *                      backend y las vuelca en orden
+ *   - HostFileStorage: archivos del host, para benchmarks fuera del equipo
+ *
+ * Cada write() es un commit (abrir, escribir, cerrar): quien escribe arma el
+ * bloque completo antes de llamarlo.
+ */
+
+#ifndef STORAGE_BACKEND_H
+#define STORAGE_BACKEND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+constexpr size_t STORAGE_PATH_MAX = 24;
+
+class StorageBackend {
+public:
+    virtual ~StorageBackend() {}
+
+    // Monta el sistema de archivos; se puede llamar de nuevo tras un fallo
+    virtual bool begin() = 0;
+    virtual bool exists(const char* path) = 0;
+    virtual bool remove(const char* path) = 0;
+    // Tamaño en bytes, 0 si el archivo no existe
+    virtual uint32_t size(const char* path) = 0;
+    // false si el archivo no existe o es más corto que offset + length
+    virtual bool read(const char* path, uint32_t offset, void* data, size_t length) = 0;
+    // Crea el archivo si no existe; offset puede ser el final actual
+    virtual bool write(const char* path, uint32_t offset, const void* data, size_t length) = 0;
+    virtual bool truncate(const char* path, uint32_t length) = 0;
+    // Reemplaza to (si existe) por from de forma atómica: tras un corte está
+    // el archivo anterior o el nuevo completo
+    virtual bool rename(const char* from, const char* to) = 0;
+
+    // Lleva al medio persistente lo retenido en capas volátiles
+    virtual bool sync() { return true; }
+    // Mantenimiento periódico desde el loop (vaciado por antigüedad)
+    virtual void poll() {}
+    virtual const char* name() const = 0;
+};
+
+// Memoria para buffers grandes de almacenamiento: PSRAM si la placa la tiene,
+// si no heap interno. nullptr si no hay memoria.
+void* allocateStorageBuffer(size_t bytes);
+
+#endif
@@ -0,0 +1,173 @@
+/*
+ * TIERED_STORAGE.CPP - Escritura diferida en RAM/PSRAM sobre otro backend
+ */
+
+#include "tiered_storage.h"
+#include "../log/token_log.h"
+
+namespace {
+constexpr size_t ENTRY_HEADER_SIZE = 30;  // sizeof(PendingWrite)
+constexpr size_t ENTRY_MAX_LENGTH = 0xFFFF;
+}  // namespace
+
+void* allocateStorageBuffer(size_t bytes) {
+#if defined(ARDUINO_ARCH_ESP32) && defined(BOARD_HAS_PSRAM)
+    if (psramFound()) {
+        return ps_malloc(bytes);
+    }
+#endif
+    return malloc(bytes);
+}
+
+TieredStorage::TieredStorage(StorageBackend& backingStore, size_t bufferBytes, unsigned long maxAgeMs)
+    : backing(backingStore),
+      capacity(bufferBytes),
+      maxAge(maxAgeMs),
+      buffer(nullptr),
+      used(0),
+      lastEntry(0),
+      oldest(0),
+      spills(0) {
+    static_assert(sizeof(PendingWrite) == ENTRY_HEADER_SIZE, "PendingWrite cambió de tamaño");
+}
+
+// Lo pendiente se pierde igual que en un corte: el log lo recupera por CRC
+TieredStorage::~TieredStorage() {
+    free(buffer);
+}
+
+bool TieredStorage::begin() {
+    if (!backing.begin()) {
+        return false;
+    }
+    // Se reserva una sola vez; sin memoria la capa queda deshabilitada
+    if (!buffer && capacity > ENTRY_HEADER_SIZE) {
+        buffer = static_cast<uint8_t*>(allocateStorageBuffer(capacity));
+        if (!buffer) {
+            TLOG("[STORAGE] WARN: Sin memoria para buffer de %u B, escritura directa.",
+                 static_cast<unsigned>(capacity));
+        }
+    }
+    return true;
+}
+
+bool TieredStorage::hasPending(const char* path) const {
+    size_t position = 0;
+    PendingWrite entry;
+    while (position < used) {
+        memcpy(&entry, buffer + position, ENTRY_HEADER_SIZE);
+        if (strncmp(entry.path, path, STORAGE_PATH_MAX) == 0) {
+            return true;
+        }
+        position += ENTRY_HEADER_SIZE + entry.length;
+    }
+    return false;
+}
+
+// Reproduce las escrituras en orden. Si una falla se descarta el resto: lo
+// que sigue depende de ella y el log recupera la cola por CRC.
+bool TieredStorage::sync() {
+    if (used == 0) {
+        return true;
+    }
+    size_t position = 0;
+    bool ok = true;
+    PendingWrite entry;
+    while (ok && position < used) {
+        memcpy(&entry, buffer + position, ENTRY_HEADER_SIZE);
+        ok = backing.write(entry.path, entry.offset, buffer + position + ENTRY_HEADER_SIZE, entry.length);
+        position += ENTRY_HEADER_SIZE + entry.length;
+    }
+    if (!ok) {
+        TLOG("[STORAGE] ERROR: Fallo al volcar %u B pendientes.", static_cast<unsigned>(used - position));
+    }
+    used = 0;
+    spills++;
+    return ok;
+}
+
+void TieredStorage::poll() {
+    if (used > 0 && millis() - oldest >= maxAge) {
+        sync();
+    }
+}
+
+bool TieredStorage::exists(const char* path) {
+    if (buffer && hasPending(path)) {
+        sync();
+    }
+    return backing.exists(path);
+}
+
+bool TieredStorage::remove(const char* path) {
+    if (buffer && hasPending(path)) {
+        sync();
+    }
+    return backing.remove(path);
+}
+
+uint32_t TieredStorage::size(const char* path) {
+    if (buffer && hasPending(path)) {
+        sync();
+    }
+    return backing.size(path);
+}
+
+bool TieredStorage::read(const char* path, uint32_t offset, void* data, size_t length) {
+    if (buffer && hasPending(path)) {
+        sync();
+    }
+    return backing.read(path, offset, data, length);
+}
+
+bool TieredStorage::truncate(const char* path, uint32_t length) {
+    if (buffer && hasPending(path)) {
+        sync();
+    }
+    return backing.truncate(path, length);
+}
+
+// Todo lo pendiente va antes: quien renombra cuenta con que lo escrito hasta
+// ahora (el archivo nuevo y lo anterior) ya esté en el medio
+bool TieredStorage::rename(const char* from, const char* to) {
+    return sync() && backing.rename(from, to);
+}
+
+bool TieredStorage::write(const char* path, uint32_t offset, const void* data, size_t length) {
+    if (!buffer || ENTRY_HEADER_SIZE + length > capacity || strlen(path) >= STORAGE_PATH_MAX) {
+        return sync() && backing.write(path, offset, data, length);
+    }
+
+    // Continuación de la última escritura: se agrega a la misma entrada
+    if (used > 0) {
+        PendingWrite last;
+        memcpy(&last, buffer + lastEntry, ENTRY_HEADER_SIZE);
+        if (strncmp(last.path, path, STORAGE_PATH_MAX) == 0 &&
+            offset == last.offset + last.length &&
+            last.length + length <= ENTRY_MAX_LENGTH &&
+            used + length <= capacity) {
+            memcpy(buffer + used, data, length);
+            used += length;
+            last.length = static_cast<uint16_t>(last.length + length);
+            memcpy(buffer + lastEntry, &last, ENTRY_HEADER_SIZE);
+            return true;
+        }
+    }
+
+    if (used + ENTRY_HEADER_SIZE + length > capacity && !sync()) {
+        return false;
+    }
+    if (used == 0) {
+        oldest = millis();
+    }
+
+    PendingWrite entry = {};
+    strncpy(entry.path, path, STORAGE_PATH_MAX - 1);
+    entry.offset = offset;
+    entry.length = static_cast<uint16_t>(length);
+    lastEntry = used;
+    memcpy(buffer + used, &entry, ENTRY_HEADER_SIZE);
+    memcpy(buffer + used + ENTRY_HEADER_SIZE, data, length);
+    used += ENTRY_HEADER_SIZE + length;
+    return true;
+}
@@ -0,0 +1,66 @@
+/*
+ * TIERED_STORAGE.H - Capa de escritura diferida en RAM/PSRAM
+ *
+ * Absorbe ráfagas de escrituras pequeñas (bloques del log, cursor) en un
+ * buffer y las vuelca al backend persistente en el mismo orden:
+ *
+ *   [PendingWrite][datos][PendingWrite][datos]...
+ *
+ * Una escritura contigua a la anterior sobre el mismo archivo se agrega a esa
+ * entrada, así que varios bloques seguidos del mismo segmento llegan a flash
+ * como un solo commit. El buffer se vacía al llenarse, tras maxAgeMs (poll),
+ * en sync() y antes de cualquier lectura de un archivo con escrituras
+ * pendientes.
+ *
+ * Un corte de energía pierde como mucho lo pendiente; como el orden se
+ * conserva, lo que queda en flash es un prefijo consistente (el log recupera
+ * la cola por CRC). Con capacity 0 o sin memoria se comporta como el backend.
+ */
+
+#ifndef TIERED_STORAGE_H
+#define TIERED_STORAGE_H
+
+#include <Arduino.h>
+#include "storage_backend.h"
+
+class TieredStorage : public StorageBackend {
+public:
+    TieredStorage(StorageBackend& backing, size_t capacity, unsigned long maxAgeMs);
+    ~TieredStorage() override;
+
+    bool begin() override;
+    bool exists(const char* path) override;
+    bool remove(const char* path) override;
+    uint32_t size(const char* path) override;
+    bool read(const char* path, uint32_t offset, void* data, size_t length) override;
+    bool write(const char* path, uint32_t offset, const void* data, size_t length) override;
+    bool truncate(const char* path, uint32_t length) override;
+    bool rename(const char* from, const char* to) override;
+    bool sync() override;
+    void poll() override;
+    const char* name() const override { return backing.name(); }
+
+    size_t bufferCapacity() const { return buffer ? capacity : 0; }
+    size_t pendingBytes() const { return used; }
+    uint32_t spillCount() const { return spills; }
+
+private:
+    struct __attribute__((packed)) PendingWrite {
+        char path[STORAGE_PATH_MAX];
+        uint32_t offset;
+        uint16_t length;
+    };
+
+    StorageBackend& backing;
+    size_t capacity;
+    unsigned long maxAge;
+    uint8_t* buffer;
+    size_t used;
+    size_t lastEntry;          // posición del último PendingWrite
+    unsigned long oldest;      // millis() de la escritura pendiente más antigua
+    uint32_t spills;
+
+    bool hasPending(const char* path) const;
+};
+
+#endif
@@ -0,0 +1,132 @@
+/*
+ * BENCH_STORAGE - Costo de escritura del log de registros por backend
+ *
+ * Agrega registros de varias fuentes a un RecordLog sobre cada backend
+ * (LittleFS simulado, con y sin capa en RAM, y archivos del host con
+ * HostFileStorage), los lee de vuelta y reporta registros por segundo y
+ * commits que llegan al medio por registro. Los tiempos son del host: sirven
+ * para comparar backends, no para predecir la placa.
+ */
+
+#include <chrono>
+#include <string>
+#include "host_env.h"
+#include "storage/flash_storage.h"
+#include "storage/host_file_storage.h"
+#include "storage/record_log.h"
+#include "storage/tiered_storage.h"
+
+namespace {
+
+constexpr int RECORDS = 1500;
+constexpr uint8_t SEGMENTS = 10;
+// Tantas fuentes como bloques abiertos: con más, cada registro cierra un bloque
+constexpr int SOURCES = RecordLog::MAX_OPEN_BLOCKS;
+constexpr unsigned long RECORD_INTERVAL_MS = 2000;
+
+// Cuenta lo que llega al medio, debajo de cualquier capa
+class CountingStorage : public StorageBackend {
+public:
+    explicit CountingStorage(StorageBackend& backing) : backing(backing), commits(0) {}
+
+    bool begin() override { return backing.begin(); }
+    bool exists(const char* path) override { return backing.exists(path); }
+    bool remove(const char* path) override {
+        commits++;
+        return backing.remove(path);
+    }
+    uint32_t size(const char* path) override { return backing.size(path); }
+    bool read(const char* path, uint32_t offset, void* data, size_t length) override {
+        return backing.read(path, offset, data, length);
+    }
+    bool write(const char* path, uint32_t offset, const void* data, size_t length) override {
+        commits++;
+        return backing.write(path, offset, data, length);
+    }
+    bool truncate(const char* path, uint32_t length) override {
+        commits++;
+        return backing.truncate(path, length);
+    }
+    bool rename(const char* from, const char* to) override {
+        commits++;
+        return backing.rename(from, to);
+    }
+    const char* name() const override { return backing.name(); }
+
+    unsigned long commits;
+
+private:
+    StorageBackend& backing;
+};
+
+void run(const char* label, StorageBackend& storage, CountingStorage& medium) {
+    RecordLog log(storage, SEGMENTS);
+    CHECK(log.begin());
+    unsigned long commitsBefore = medium.commits;
+
+    auto started = std::chrono::steady_clock::now();
+    for (int i = 0; i < RECORDS; i++) {
+        host::advance(RECORD_INTERVAL_MS);
+        log.append(RecordLog::makeRecord(static_cast<uint16_t>(10 + i % SOURCES), -33.4f + i * 1e-4f, -70.6f,
+                                         1700000000 + i * 6, 3700, -90.0f, 7.0f));
+        log.poll();
+    }
+    log.flush();
+    double appendUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - started).count();
+
+    RecordReader reader(log);
+    reader.open(log.firstSequence(), log.count());
+    StoredRecord record;
+    size_t unreadable = 0;
+    for (size_t i = 0; i < reader.size(); i++) {
+        unreadable += reader.read(i, record) ? 0 : 1;
+    }
+    CHECK(unreadable == 0);
+    CHECK(log.count() > 0);
+
+    printf("%-16s %9.0f reg/s  commits/reg %.3f  log commits/reg %.2f  escritura x%.2f  retenidos %u\n", label,
+           RECORDS * 1e6 / appendUs, static_cast<double>(medium.commits - commitsBefore) / RECORDS,
+           log.commitsPerRecordX100() / 100.0, log.writeAmplificationX100() / 100.0,
+           static_cast<unsigned>(log.count()));
+}
+
+}  // namespace
+
+int main() {
+    host::setQuiet(true);
+    printf("%d registros de %d fuentes, %u segmentos\n", RECORDS, SOURCES, static_cast<unsigned>(SEGMENTS));
+    {
+        host::resetFileSystem();
+        FlashStorage flash;
+        CountingStorage medium(flash);
+        run("flash", medium, medium);
+    }
+    {
+        host::resetFileSystem();
+        FlashStorage flash;
+        CountingStorage medium(flash);
+        TieredStorage tier(medium, 1024, 30000);
+        run("flash+ram 1K", tier, medium);
+    }
+    {
+        host::resetFileSystem();
+        FlashStorage flash;
+        CountingStorage medium(flash);
+        TieredStorage tier(medium, 16384, 30000);
+        run("flash+ram 16K", tier, medium);
+    }
+    {
+        std::string root = std::string(host::resetFileSystem()) + "/host";
+        HostFileStorage files(root.c_str());
+        CountingStorage medium(files);
+        run("host", medium, medium);
+    }
+    {
+        std::string root = std::string(host::resetFileSystem()) + "/host";
+        HostFileStorage files(root.c_str());
+        CountingStorage medium(files);
+        TieredStorage tier(medium, 16384, 30000);
+        run("host+ram 16K", tier, medium);
+    }
+    return host::finish("bench_storage");
+}
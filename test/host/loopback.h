@@ -0,0 +1,97 @@
+/*
+ * LOOPBACK.H - Solar Node y gateway en el mismo proceso
+ *
+ * Incluye gateway/main.cpp para llegar a su estado interno. El rol
+ * END_NODE_REPEATER escribe en Serial1 y el gateway en solarLink; pump()
+ * pasa los bytes de uno a otro como el cable UART.
+ */
+
+#ifndef HOST_LOOPBACK_H
+#define HOST_LOOPBACK_H
+
+#include <new>
+#include "gateway/main.cpp"
+#include "lora.h"
+#include "roles/end_node_repeater_role.h"
+
+namespace loopback {
+
+inline size_t pump() {
+    size_t moved = Serial1.tx.size() + solarLink.tx.size();
+    if (!Serial1.tx.empty()) {
+        solarLink.deliver(Serial1.tx.data(), Serial1.tx.size());
+        Serial1.tx.clear();
+        Serial1.txBaud.clear();
+    }
+    if (!solarLink.tx.empty()) {
+        Serial1.deliver(solarLink.tx.data(), solarLink.tx.size());
+        solarLink.tx.clear();
+        solarLink.txBaud.clear();
+    }
+    return moved;
+}
+
+// Una vuelta de cada lado
+inline size_t step() {
+    loop();
+    size_t moved = pump();
+    endNodeRepeaterRole.handleMode();
+    return moved + pump();
+}
+
+// Reinicio del gateway: el estado en RAM vuelve al de arranque y setup()
+// recarga sesión y cola de flash
+inline void rebootGateway() {
+    currentBatch.reset();
+    currentState = GatewayState::Idle;
+    baudLink = BaudLink();
+    backfill = BackfillQuery();
+    lastPing = 0;
+    uploadHolding = false;
+    uploadRetryAt = 0;
+    cellularRecords = 0;
+    wifiConnecting = false;
+    solarDecoder.reset();
+    solarLink.rx.clear();
+    solarLink.rxPos = 0;
+    solarLink.tx.clear();
+    solarLink.txBaud.clear();
+    new (&solarFrames) FrameQueue<SOLAR_FRAME_SLOTS>();
+    flashStorage.~FlashStorage();
+    new (&flashStorage) FlashStorage();
+    new (&sessionStore) SessionStore(gatewayStorage);
+    new (&uploadQueue) UploadQueue(gatewayStorage);
+    new (&cellularHealth) PathHealth("celular", CELL_HEALTH);
+    new (&wifiHealth) PathHealth("Wi-Fi", WIFI_HEALTH);
+    setup();
+}
+
+// Reinicio del Solar Node: lo que no llegó a flash se pierde
+inline void rebootNode() {
+    endNodeRepeaterRole.~EndNodeRepeaterRole();
+    new (&endNodeRepeaterRole) EndNodeRepeaterRole();
+    Serial1.rx.clear();
+    Serial1.rxPos = 0;
+    Serial1.tx.clear();
+    Serial1.txBaud.clear();
+}
+
+inline bool settled() {
+    return endNodeRepeaterRole.getStoredCount() == 0 && currentState == GatewayState::Idle &&
+           uploadQueue.empty() && cellularRecords == 0;
+}
+
+// Hasta que el nodo no tiene nada y el gateway subió todo
+inline bool drain(size_t maxSteps) {
+    for (size_t i = 0; i < maxSteps; i++) {
+        step();
+        if (settled()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace loopback
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * ADAFRUIT_LITTLEFS.H (host) - LittleFS del nRF52 sobre archivos reales
+ *
+ * Las rutas se resuelven bajo host::fileSystemRoot(). Cada apertura,
+ * escritura, lectura y cierre cuenta en host::fileOperations().
+ */
+
+#ifndef HOST_ADAFRUIT_LITTLEFS_H
+#define HOST_ADAFRUIT_LITTLEFS_H
+
+#include <Arduino.h>
+
+#define FILE_O_READ 0
+#define FILE_O_WRITE 1
+
+namespace Adafruit_LittleFS_Namespace {
+
+class Adafruit_LittleFS;
+
+class File : public Stream {
+public:
+    File() : fp(nullptr) {}
+    explicit File(Adafruit_LittleFS&) : fp(nullptr) {}
+    File(const char* path, uint8_t mode, Adafruit_LittleFS&) : fp(nullptr) { open(path, mode); }
+    File(File&& other) : fp(other.fp) { other.fp = nullptr; }
+    File& operator=(File&& other) {
+        if (this != &other) {
+            close();
+            fp = other.fp;
+            other.fp = nullptr;
+        }
+        return *this;
+    }
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+    ~File() override { close(); }
+
+    bool open(const char* path, uint8_t mode);
+    void close();
+    bool isOpen() const { return fp != nullptr; }
+    explicit operator bool() const { return fp != nullptr; }
+
+    using Print::write;
+    size_t write(const uint8_t* data, size_t length) override;
+    int read() override;
+    int read(void* data, uint16_t length);
+    int available() override { return static_cast<int>(size() - position()); }
+    bool seek(uint32_t position);
+    uint32_t position();
+    uint32_t size();
+    bool truncate(uint32_t length);
+    void flush() override;
+
+private:
+    FILE* fp;
+};
+
+class Adafruit_LittleFS {
+public:
+    bool begin();
+    bool exists(const char* path);
+    bool remove(const char* path);
+    bool rename(const char* from, const char* to);
+    bool mkdir(const char* path);
+    bool rmdir(const char* path);
+    bool rmdir_r(const char* path);
+    bool format();
+    File open(const char* path, uint8_t mode = FILE_O_READ) {
+        File file;
+        file.open(path, mode);
+        return file;
+    }
+};
+
+}  // namespace Adafruit_LittleFS_Namespace
+
+#endif
@@ -0,0 +1,316 @@
+/*
+ * ARDUINO.H (host) - Núcleo de Arduino mínimo para las pruebas en el host
+ *
+ * Lo justo para compilar el firmware del nodo y del gateway con g++: String
+ * sobre std::string, Print/Stream, seriales en memoria, reloj simulado y
+ * las llamadas de FreeRTOS que usa el gateway. Los tests controlan el
+ * entorno con las funciones de host_env.h.
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+#include "host_env.h"
+
+#define HEX 16
+#define DEC 10
+#define HIGH 1
+#define LOW 0
+#define OUTPUT 1
+#define INPUT 0
+#define INPUT_PULLUP 2
+#define INPUT_PULLDOWN 3
+#define LED_BUILTIN 13
+#define F(x) x
+#define SERIAL_8N1 0
+#define PI 3.14159265358979323846
+#define DEG_TO_RAD 0.017453292519943295
+#define RAD_TO_DEG 57.29577951308232
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+class String {
+public:
+    String() {}
+    String(const char* text) : s(text ? text : "") {}
+    String(const std::string& text) : s(text) {}
+    String(char c) : s(1, c) {}
+    String(int v, int base = 10) { format(base == 16 ? "%x" : "%d", v); }
+    String(unsigned v, int base = 10) { format(base == 16 ? "%x" : "%u", v); }
+    String(long v, int base = 10) { format(base == 16 ? "%lx" : "%ld", v); }
+    String(unsigned long v, int base = 10) { format(base == 16 ? "%lx" : "%lu", v); }
+    String(float v, int decimals = 2) { format("%.*f", decimals, static_cast<double>(v)); }
+    String(double v, int decimals = 2) { format("%.*f", decimals, v); }
+
+    const char* c_str() const { return s.c_str(); }
+    unsigned length() const { return static_cast<unsigned>(s.size()); }
+    bool isEmpty() const { return s.empty(); }
+    char charAt(unsigned i) const { return i < s.size() ? s[i] : 0; }
+    char operator[](unsigned i) const { return charAt(i); }
+    int toInt() const { return atoi(s.c_str()); }
+    float toFloat() const { return static_cast<float>(atof(s.c_str())); }
+    void toUpperCase() { for (auto& c : s) c = static_cast<char>(toupper(c)); }
+    void toLowerCase() { for (auto& c : s) c = static_cast<char>(tolower(c)); }
+    void trim() {
+        while (!s.empty() && isspace(static_cast<unsigned char>(s.back()))) s.pop_back();
+        size_t start = 0;
+        while (start < s.size() && isspace(static_cast<unsigned char>(s[start]))) start++;
+        s.erase(0, start);
+    }
+    int indexOf(char c, unsigned from = 0) const { return position(s.find(c, from)); }
+    int indexOf(const String& text, unsigned from = 0) const { return position(s.find(text.s, from)); }
+    int lastIndexOf(char c) const { return position(s.rfind(c)); }
+    String substring(unsigned from) const { return from >= s.size() ? String() : String(s.substr(from)); }
+    String substring(unsigned from, unsigned to) const {
+        return from >= s.size() || to <= from ? String() : String(s.substr(from, to - from));
+    }
+    bool startsWith(const String& p) const { return s.compare(0, p.s.size(), p.s) == 0; }
+    bool endsWith(const String& p) const {
+        return s.size() >= p.s.size() && s.compare(s.size() - p.s.size(), p.s.size(), p.s) == 0;
+    }
+    bool equals(const String& o) const { return s == o.s; }
+    bool equalsIgnoreCase(const String& o) const { return strcasecmp(s.c_str(), o.c_str()) == 0; }
+    void reserve(unsigned size) { s.reserve(size); }
+    void remove(unsigned i) { if (i < s.size()) s.erase(i); }
+    void remove(unsigned i, unsigned n) { if (i < s.size()) s.erase(i, n); }
+    void replace(const String& from, const String& to) {
+        for (size_t p = 0; !from.s.empty() && (p = s.find(from.s, p)) != std::string::npos; p += to.s.size()) {
+            s.replace(p, from.s.size(), to.s);
+        }
+    }
+    String& operator+=(const String& o) { s += o.s; return *this; }
+    String& operator+=(const char* o) { s += o; return *this; }
+    String& operator+=(char o) { s += o; return *this; }
+    bool operator==(const String& o) const { return s == o.s; }
+    bool operator==(const char* o) const { return s == o; }
+    bool operator!=(const String& o) const { return s != o.s; }
+    bool operator!=(const char* o) const { return s != o; }
+    bool operator<(const String& o) const { return s < o.s; }
+
+    std::string s;
+
+private:
+    template <typename... Args>
+    void format(const char* fmt, Args... args) {
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), fmt, args...);
+        s = buffer;
+    }
+    static int position(size_t p) { return p == std::string::npos ? -1 : static_cast<int>(p); }
+};
+
+inline String operator+(const String& a, const String& b) { return String(a.s + b.s); }
+inline String operator+(const String& a, const char* b) { return String(a.s + b); }
+inline String operator+(const char* a, const String& b) { return String(std::string(a) + b.s); }
+inline String operator+(const String& a, char b) { return String(a.s + b); }
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) { return write(&c, 1); }
+    virtual size_t write(const uint8_t* data, size_t length) = 0;
+    size_t write(const char* data, size_t length) { return write(reinterpret_cast<const uint8_t*>(data), length); }
+    size_t write(const char* text) { return write(text, strlen(text)); }
+    size_t print(const char* text) { return write(text); }
+    size_t print(const String& text) { return print(text.c_str()); }
+    size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+    size_t print(int v, int base = 10) { return print(String(v, base)); }
+    size_t print(unsigned v, int base = 10) { return print(String(v, base)); }
+    size_t print(long v, int base = 10) { return print(String(v, base)); }
+    size_t print(unsigned long v, int base = 10) { return print(String(v, base)); }
+    size_t print(double v, int decimals = 2) { return print(String(v, decimals)); }
+    size_t println() { return print("\r\n"); }
+    template <typename T>
+    size_t println(const T& value) { return print(value) + println(); }
+    template <typename T>
+    size_t println(const T& value, int arg) { return print(value, arg) + println(); }
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        char buffer[512];
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(buffer, sizeof(buffer), fmt, args);
+        va_end(args);
+        return n < 0 ? 0 : write(reinterpret_cast<const uint8_t*>(buffer), std::min<size_t>(n, sizeof(buffer) - 1));
+    }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() { return -1; }
+    virtual void flush() {}
+    void setTimeout(unsigned long) {}
+    size_t readBytes(uint8_t* out, size_t length) {
+        size_t n = 0;
+        while (n < length && available() > 0) out[n++] = static_cast<uint8_t>(read());
+        return n;
+    }
+    size_t readBytes(char* out, size_t length) { return readBytes(reinterpret_cast<uint8_t*>(out), length); }
+    String readStringUntil(char terminator) {
+        String line;
+        while (available() > 0) {
+            int c = read();
+            if (c == terminator) break;
+            line += static_cast<char>(c);
+        }
+        return line;
+    }
+};
+
+enum hardwareSerial_error_t {
+    UART_NO_ERROR,
+    UART_BREAK_ERROR,
+    UART_BUFFER_FULL_ERROR,
+    UART_FIFO_OVF_ERROR,
+    UART_FRAME_ERROR,
+    UART_PARITY_ERROR
+};
+
+// Serial en memoria: lo escrito queda en tx, lo que el test pone en rx se lee.
+// deliver() agrega a rx y llama al callback de onReceive como el driver.
+class HardwareSerial : public Stream {
+public:
+    explicit HardwareSerial(int = 0) {}
+
+    void begin(unsigned long rate, ...) { baud = rate; }
+    void end() {}
+    void updateBaudRate(unsigned long rate) { baud = rate; }
+    size_t setRxBufferSize(size_t size) { return size; }
+    void onReceive(std::function<void(void)> callback, bool = false) { receiveCallback = callback; }
+    void onReceiveError(std::function<void(hardwareSerial_error_t)>) {}
+    bool setRxFIFOFull(uint8_t) { return true; }
+    bool setRxTimeout(uint8_t) { return true; }
+    int availableForWrite() { return 128; }
+    explicit operator bool() const { return true; }
+
+    int available() override { return static_cast<int>(rx.size() - rxPos); }
+    int read() override { return rxPos < rx.size() ? rx[rxPos++] : -1; }
+    int peek() override { return rxPos < rx.size() ? rx[rxPos] : -1; }
+    using Print::write;
+    size_t write(const uint8_t* data, size_t length) override {
+        host::ShimScope scope;
+        tx.insert(tx.end(), data, data + length);
+        txBaud.insert(txBaud.end(), length, baud);
+        return length;
+    }
+
+    void deliver(const uint8_t* data, size_t length) {
+        {
+            host::ShimScope scope;
+            if (rxPos == rx.size()) {
+                rx.clear();
+                rxPos = 0;
+            }
+            rx.insert(rx.end(), data, data + length);
+        }
+        if (receiveCallback) receiveCallback();
+    }
+
+    std::vector<uint8_t> rx;
+    std::vector<uint8_t> tx;
+    std::vector<unsigned long> txBaud;  // velocidad con que salió cada byte de tx
+    size_t rxPos = 0;
+    unsigned long baud = 0;
+
+private:
+    std::function<void(void)> receiveCallback;
+};
+
+// Consola: a stdout salvo que el test la silencie (host::quiet)
+class ConsoleSerial : public HardwareSerial {
+public:
+    using Print::write;
+    size_t write(const uint8_t* data, size_t length) override;
+};
+
+extern ConsoleSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+typedef HardwareSerial Uart;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+inline void delayMicroseconds(unsigned) {}
+inline void yield() {}
+inline void pinMode(int, int) {}
+// Los pines guardan el último nivel escrito (un test lee el de PWRKEY)
+void digitalWrite(int pin, int level);
+int digitalRead(int pin);
+inline int analogRead(int) { return 0; }
+inline void analogReadResolution(int) {}
+inline long random(long upper) { return upper > 0 ? rand() % upper : 0; }
+inline long random(long lower, long upper) { return upper > lower ? lower + rand() % (upper - lower) : lower; }
+inline void randomSeed(unsigned long seed) { srand(static_cast<unsigned>(seed)); }
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+inline bool isAlphaNumeric(int c) { return isalnum(c) != 0; }
+inline bool isDigit(int c) { return isdigit(c) != 0; }
+inline bool isAlpha(int c) { return isalpha(c) != 0; }
+inline bool isSpace(int c) { return isspace(c) != 0; }
+inline bool isPrintable(int c) { return isprint(c) != 0; }
+inline bool isHexadecimalDigit(int c) { return isxdigit(c) != 0; }
+
+// Pines de la variante del Solar Node
+#define D0 0
+#define D1 1
+#define D2 2
+#define D3 3
+#define D4 4
+#define D5 5
+#define D6 6
+#define D7 7
+#define D8 8
+#define D9 9
+#define D10 10
+#define D14 14
+#define D15 15
+#define D17 17
+#define D18 18
+#define D19 19
+#define LED_CONN 12
+#define PIN_VBAT 20
+#define TX 21
+#define RX 22
+
+// FreeRTOS: sin tareas; xTaskCreatePinnedToCore falla y el gateway sube
+// desde loop(), como cuando no hay memoria para la tarea
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+#define pdPASS 1
+#define pdFAIL 0
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdMS_TO_TICKS(ms) (static_cast<TickType_t>(ms))
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char*, uint32_t, void*, UBaseType_t, TaskHandle_t*,
+                                          BaseType_t) {
+    return pdFAIL;
+}
+inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t ticks) {
+    delay(ticks);
+    return 0;
+}
+inline void xTaskNotifyGive(TaskHandle_t) {}
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 0; }
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ * HTTPCLIENT.H (host) - Cliente HTTP del ESP32 contra un servidor simulado
+ *
+ * sendRequest() lee del Stream exactamente los bytes anunciados y se los
+ * pasa a host::httpServer, que devuelve el código HTTP (o < 0 como error
+ * de conexión). Sin servidor responde 200. Un cuerpo más corto o más largo
+ * que lo anunciado cuenta en host::httpLengthMismatches.
+ */
+
+#ifndef HOST_HTTPCLIENT_H
+#define HOST_HTTPCLIENT_H
+
+#include <string>
+#include "WiFi.h"
+
+namespace host {
+extern int (*httpServer)(const std::string& body);
+extern unsigned long httpLengthMismatches;
+// Próximo pedido sobre una conexión reutilizada falla como si el servidor la
+// hubiera cerrado
+extern bool httpDropReused;
+}  // namespace host
+
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+
+class HTTPClient {
+public:
+    bool begin(const char*) { return true; }
+    bool begin(WiFiClient& client, const char*, uint16_t, const char*, bool) {
+        connection = &client;
+        return true;
+    }
+    void addHeader(const char*, const char*) {}
+    void setReuse(bool) {}
+    void setTimeout(uint16_t) {}
+    int sendRequest(const char* method, Stream* stream, size_t size);
+    String getString() { return String(); }
+    void end() {}
+    static String errorToString(int code) { return String("error ") + String(code); }
+
+private:
+    WiFiClient* connection = nullptr;
+};
+
+#endif
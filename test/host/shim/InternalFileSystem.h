@@ -0,0 +1,12 @@
+/*
+ * INTERNALFILESYSTEM.H (host) - InternalFS del nRF52
+ */
+
+#ifndef HOST_INTERNAL_FILE_SYSTEM_H
+#define HOST_INTERNAL_FILE_SYSTEM_H
+
+#include "Adafruit_LittleFS.h"
+
+extern Adafruit_LittleFS_Namespace::Adafruit_LittleFS InternalFS;
+
+#endif
@@ -0,0 +1,21 @@
+/*
+ * PREFERENCES.H (host) - NVS del ESP32 en memoria
+ */
+
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+#include <Arduino.h>
+
+class Preferences {
+public:
+    bool begin(const char*, bool = false) { return true; }
+    void end() {}
+    bool clear() { return true; }
+    size_t putBytes(const char*, const void*, size_t length) { return length; }
+    size_t getBytes(const char*, void*, size_t) { return 0; }
+    size_t getBytesLength(const char*) { return 0; }
+    bool isKey(const char*) { return false; }
+};
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * RADIOLIB.H (host) - SX1262 simulado
+ *
+ * transmit() guarda el paquete en host::radioSent; readData() entrega el
+ * paquete que el test dejó con host::radioInject() y marca RX_DONE.
+ */
+
+#ifndef HOST_RADIOLIB_H
+#define HOST_RADIOLIB_H
+
+#include <Arduino.h>
+#include <SPI.h>
+
+#define RADIOLIB_ERR_NONE 0
+#define RADIOLIB_ERR_RX_TIMEOUT (-6)
+#define RADIOLIB_NC (-1)
+#define RADIOLIB_SX126X_IRQ_RX_DONE 0x0002
+
+namespace host {
+// Paquete para el próximo readData(); reemplaza al anterior
+void radioInject(const void* data, size_t length);
+bool radioPending();
+extern std::vector<uint8_t> radioSent;
+extern unsigned long radioTransmits;
+}  // namespace host
+
+class Module {
+public:
+    Module(uint32_t, uint32_t, uint32_t, uint32_t) {}
+};
+
+class SX1262 {
+public:
+    explicit SX1262(Module*) {}
+
+    bool XTAL = true;
+
+    int begin(...) { return RADIOLIB_ERR_NONE; }
+    int transmit(uint8_t* data, size_t length);
+    int startReceive() { return RADIOLIB_ERR_NONE; }
+    int readData(uint8_t* data, size_t length);
+    uint16_t getIrqStatus() { return host::radioPending() ? RADIOLIB_SX126X_IRQ_RX_DONE : 0; }
+    size_t getPacketLength(bool = true);
+    float getRSSI() { return -90.0f; }
+    float getSNR() { return 8.0f; }
+    int setFrequency(float) { return RADIOLIB_ERR_NONE; }
+    int setOutputPower(int) { return RADIOLIB_ERR_NONE; }
+    int setBandwidth(float) { return RADIOLIB_ERR_NONE; }
+    int setSpreadingFactor(int) { return RADIOLIB_ERR_NONE; }
+    int setCodingRate(int) { return RADIOLIB_ERR_NONE; }
+    int setSyncWord(int) { return RADIOLIB_ERR_NONE; }
+    int setPreambleLength(int) { return RADIOLIB_ERR_NONE; }
+    int setCRC(int) { return RADIOLIB_ERR_NONE; }
+    int setDio2AsRfSwitch(bool = true) { return RADIOLIB_ERR_NONE; }
+    int setRfSwitchPins(int, int) { return RADIOLIB_ERR_NONE; }
+    int setTCXO(float) { return RADIOLIB_ERR_NONE; }
+    int setCurrentLimit(float) { return RADIOLIB_ERR_NONE; }
+    int sleep() { return RADIOLIB_ERR_NONE; }
+    int standby() { return RADIOLIB_ERR_NONE; }
+};
+
+#endif
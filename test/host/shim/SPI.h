@@ -0,0 +1,17 @@
+/*
+ * SPI.H (host) - Bus SPI sin efecto
+ */
+
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+class SPIClass {
+public:
+    void begin() {}
+    void begin(int, int, int, int) {}
+    void setPins(int, int, int) {}
+};
+
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,16 @@
+/*
+ * SOFTWARESERIAL.H (host) - Puerto serie por software, en memoria
+ */
+
+#ifndef HOST_SOFTWARESERIAL_H
+#define HOST_SOFTWARESERIAL_H
+
+#include <Arduino.h>
+
+class SoftwareSerial : public HardwareSerial {
+public:
+    SoftwareSerial(int, int) {}
+    bool listen() { return true; }
+};
+
+#endif
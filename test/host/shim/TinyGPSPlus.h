@@ -0,0 +1,53 @@
+/*
+ * TINYGPSPLUS.H (host) - Parser NMEA sin fix
+ */
+
+#ifndef HOST_TINYGPSPLUS_H
+#define HOST_TINYGPSPLUS_H
+
+#include <Arduino.h>
+
+struct TinyGPSLocation {
+    bool isValid() const { return false; }
+    bool isUpdated() const { return false; }
+    uint32_t age() const { return 0xFFFFFFFF; }
+    double lat() const { return 0.0; }
+    double lng() const { return 0.0; }
+};
+
+struct TinyGPSValue {
+    bool isValid() const { return false; }
+    bool isUpdated() const { return false; }
+    uint32_t age() const { return 0xFFFFFFFF; }
+    uint32_t value() const { return 0; }
+    double hdop() const { return 0.0; }
+    double meters() const { return 0.0; }
+    double kmph() const { return 0.0; }
+    double deg() const { return 0.0; }
+    uint16_t year() const { return 2000; }
+    uint8_t month() const { return 1; }
+    uint8_t day() const { return 1; }
+    uint8_t hour() const { return 0; }
+    uint8_t minute() const { return 0; }
+    uint8_t second() const { return 0; }
+};
+
+class TinyGPSPlus {
+public:
+    bool encode(char) { return false; }
+    uint32_t charsProcessed() const { return 0; }
+    uint32_t sentencesWithFix() const { return 0; }
+    uint32_t failedChecksum() const { return 0; }
+    uint32_t passedChecksum() const { return 0; }
+
+    TinyGPSLocation location;
+    TinyGPSValue date;
+    TinyGPSValue time;
+    TinyGPSValue satellites;
+    TinyGPSValue hdop;
+    TinyGPSValue altitude;
+    TinyGPSValue speed;
+    TinyGPSValue course;
+};
+
+#endif
@@ -0,0 +1,61 @@
+/*
+ * WIFI.H (host) - Wi-Fi del ESP32 simulado
+ *
+ * host::wifiStatus fija lo que devuelve WiFi.status(); por defecto
+ * conectado.
+ */
+
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include <Arduino.h>
+
+#define WL_IDLE_STATUS 0
+#define WL_NO_SSID_AVAIL 1
+#define WL_CONNECT_FAILED 4
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+#define WIFI_STA 1
+
+namespace host {
+extern int wifiStatus;
+}
+
+struct IPAddress {
+    String toString() const { return String("10.0.0.3"); }
+};
+
+class WiFiClass {
+public:
+    int status() { return host::wifiStatus; }
+    void begin(const char*, const char*) {}
+    void mode(int) {}
+    void setAutoReconnect(bool) {}
+    bool reconnect() { return true; }
+    void disconnect(bool = false) {}
+    IPAddress localIP() { return IPAddress(); }
+    int RSSI() { return -60; }
+};
+
+extern WiFiClass WiFi;
+
+class WiFiClient : public Stream {
+public:
+    int connect(const char*, uint16_t) {
+        open = true;
+        connects++;
+        return 1;
+    }
+    bool connected() { return open; }
+    void stop() { open = false; }
+    void setTimeout(int) {}
+    int available() override { return 0; }
+    int read() override { return -1; }
+    using Print::write;
+    size_t write(const uint8_t*, size_t length) override { return length; }
+
+    bool open = false;
+    static unsigned long connects;
+};
+
+#endif
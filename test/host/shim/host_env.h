@@ -0,0 +1,51 @@
+/*
+ * HOST_ENV.H - Control del entorno simulado desde los tests del host
+ */
+
+#ifndef HOST_ENV_H
+#define HOST_ENV_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+namespace host {
+
+// Reloj simulado: millis() sólo avanza con delay() o advance()
+void advance(unsigned long ms);
+void setMillis(unsigned long ms);
+
+// Raíz de los sistemas de archivos simulados (InternalFS, LittleFS); un
+// directorio temporal nuevo y vacío por llamada
+const char* resetFileSystem();
+const std::string& fileSystemRoot();
+// Operaciones de archivo (abrir, escribir, leer, cerrar) desde el arranque
+unsigned long fileOperations();
+
+// Silencia la consola (Serial) del firmware
+void setQuiet(bool quiet);
+
+// Las asignaciones del propio simulador (archivos, seriales, HTTP) no se
+// cuentan en los tests de asignación: en el equipo las hace otra capa
+struct ShimScope {
+    ShimScope();
+    ~ShimScope();
+};
+bool inShim();
+
+// Verificaciones de los tests: registran el fallo y siguen
+extern int failures;
+int finish(const char* name);
+
+}  // namespace host
+
+#define CHECK(cond)                                                                  \
+    do {                                                                             \
+        if (!(cond)) {                                                               \
+            fprintf(stderr, "%s:%d: falló CHECK(%s)\n", __FILE__, __LINE__, #cond);  \
+            host::failures++;                                                        \
+        }                                                                            \
+    } while (0)
+
+#endif
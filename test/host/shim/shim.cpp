@@ -0,0 +1,292 @@
+/*
+ * SHIM.CPP (host) - Estado global del entorno simulado
+ */
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <InternalFileSystem.h>
+#include <RadioLib.h>
+#include <SPI.h>
+#include <Wire.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ConsoleSerial Serial;
+HardwareSerial Serial1(1);
+HardwareSerial Serial2(2);
+SPIClass SPI;
+TwoWire Wire;
+WiFiClass WiFi;
+Adafruit_LittleFS_Namespace::Adafruit_LittleFS InternalFS;
+unsigned long WiFiClient::connects = 0;
+
+namespace host {
+
+int failures = 0;
+int wifiStatus = WL_CONNECTED;
+int (*httpServer)(const std::string& body) = nullptr;
+unsigned long httpLengthMismatches = 0;
+bool httpDropReused = false;
+std::vector<uint8_t> radioSent;
+unsigned long radioTransmits = 0;
+
+namespace {
+unsigned long clockMs = 0;
+unsigned long fileOps = 0;
+bool quietConsole = false;
+std::string fsRoot;
+thread_local int shimDepth = 0;
+uint8_t radioPacket[256];
+size_t radioLength = 0;
+bool radioReady = false;
+int pinLevels[64];
+
+std::string resolve(const char* path) {
+    return fsRoot + path;
+}
+}  // namespace
+
+ShimScope::ShimScope() { shimDepth++; }
+ShimScope::~ShimScope() { shimDepth--; }
+bool inShim() { return shimDepth > 0; }
+
+void advance(unsigned long ms) { clockMs += ms; }
+void setMillis(unsigned long ms) { clockMs = ms; }
+void setQuiet(bool quiet) { quietConsole = quiet; }
+unsigned long fileOperations() { return fileOps; }
+const std::string& fileSystemRoot() { return fsRoot; }
+
+const char* resetFileSystem() {
+    ShimScope scope;
+    char pattern[] = "/tmp/custodia-host-XXXXXX";
+    const char* made = mkdtemp(pattern);
+    fsRoot = made != nullptr ? made : "/tmp";
+    return fsRoot.c_str();
+}
+
+void radioInject(const void* data, size_t length) {
+    radioLength = length < sizeof(radioPacket) ? length : sizeof(radioPacket);
+    memcpy(radioPacket, data, radioLength);
+    radioReady = true;
+}
+
+bool radioPending() { return radioReady; }
+
+int finish(const char* name) {
+    if (failures == 0) {
+        printf("%s: OK\n", name);
+        return 0;
+    }
+    printf("%s: %d verificaciones fallidas\n", name, failures);
+    return 1;
+}
+
+}  // namespace host
+
+// El firmware reserva objetos globales para toda la vida del programa (p.ej.
+// el Module del radio) sin liberarlos: no son fugas en la placa
+extern "C" const char* __asan_default_options() {
+    return "detect_leaks=0";
+}
+
+unsigned long millis() { return host::clockMs; }
+unsigned long micros() { return host::clockMs * 1000; }
+void delay(unsigned long ms) { host::clockMs += ms; }
+
+void digitalWrite(int pin, int level) {
+    if (pin >= 0 && pin < 64) {
+        host::pinLevels[pin] = level;
+    }
+}
+
+int digitalRead(int pin) { return pin >= 0 && pin < 64 ? host::pinLevels[pin] : 0; }
+
+size_t ConsoleSerial::write(const uint8_t* data, size_t length) {
+    if (!host::quietConsole) {
+        host::ShimScope scope;
+        fwrite(data, 1, length, stdout);
+    }
+    return length;
+}
+
+int SX1262::transmit(uint8_t* data, size_t length) {
+    host::ShimScope scope;
+    host::radioSent.assign(data, data + length);
+    host::radioTransmits++;
+    return RADIOLIB_ERR_NONE;
+}
+
+int SX1262::readData(uint8_t* data, size_t length) {
+    if (!host::radioReady) {
+        return RADIOLIB_ERR_RX_TIMEOUT;
+    }
+    host::radioReady = false;
+    memset(data, 0, length);
+    memcpy(data, host::radioPacket, length < host::radioLength ? length : host::radioLength);
+    return RADIOLIB_ERR_NONE;
+}
+
+size_t SX1262::getPacketLength(bool) { return host::radioLength; }
+
+int HTTPClient::sendRequest(const char*, Stream* stream, size_t size) {
+    host::ShimScope scope;
+    if (host::httpDropReused && connection != nullptr) {
+        host::httpDropReused = false;
+        return HTTPC_ERROR_CONNECTION_LOST;
+    }
+    std::string body;
+    int c;
+    while (body.size() < size && (c = stream->read()) >= 0) {
+        body += static_cast<char>(c);
+    }
+    if (body.size() != size || stream->read() >= 0) {
+        host::httpLengthMismatches++;
+    }
+    return host::httpServer != nullptr ? host::httpServer(body) : 200;
+}
+
+namespace Adafruit_LittleFS_Namespace {
+
+bool File::open(const char* path, uint8_t mode) {
+    host::ShimScope scope;
+    close();
+    std::string full = host::resolve(path);
+    host::fileOps++;
+    if (mode == FILE_O_READ) {
+        fp = fopen(full.c_str(), "rb");
+    } else {
+        // FILE_O_WRITE de Adafruit abre para agregar al final sin truncar
+        fp = fopen(full.c_str(), "r+b");
+        if (fp == nullptr) {
+            fp = fopen(full.c_str(), "w+b");
+        }
+        if (fp != nullptr) {
+            fseek(fp, 0, SEEK_END);
+        }
+    }
+    return fp != nullptr;
+}
+
+void File::close() {
+    if (fp != nullptr) {
+        host::ShimScope scope;
+        fclose(fp);
+        host::fileOps++;
+        fp = nullptr;
+    }
+}
+
+size_t File::write(const uint8_t* data, size_t length) {
+    if (fp == nullptr) {
+        return 0;
+    }
+    host::ShimScope scope;
+    host::fileOps++;
+    return fwrite(data, 1, length, fp);
+}
+
+int File::read() {
+    if (fp == nullptr) {
+        return -1;
+    }
+    host::ShimScope scope;
+    int c = fgetc(fp);
+    return c == EOF ? -1 : c;
+}
+
+int File::read(void* data, uint16_t length) {
+    if (fp == nullptr) {
+        return -1;
+    }
+    host::ShimScope scope;
+    host::fileOps++;
+    return static_cast<int>(fread(data, 1, length, fp));
+}
+
+bool File::seek(uint32_t position) {
+    host::ShimScope scope;
+    return fp != nullptr && fseek(fp, position, SEEK_SET) == 0;
+}
+
+uint32_t File::position() {
+    return fp != nullptr ? static_cast<uint32_t>(ftell(fp)) : 0;
+}
+
+uint32_t File::size() {
+    if (fp == nullptr) {
+        return 0;
+    }
+    host::ShimScope scope;
+    long current = ftell(fp);
+    fseek(fp, 0, SEEK_END);
+    long end = ftell(fp);
+    fseek(fp, current, SEEK_SET);
+    return static_cast<uint32_t>(end);
+}
+
+bool File::truncate(uint32_t length) {
+    if (fp == nullptr) {
+        return false;
+    }
+    host::ShimScope scope;
+    fflush(fp);
+    return ftruncate(fileno(fp), length) == 0;
+}
+
+void File::flush() {
+    if (fp != nullptr) {
+        host::ShimScope scope;
+        host::fileOps++;
+        fflush(fp);
+    }
+}
+
+bool Adafruit_LittleFS::begin() {
+    host::ShimScope scope;
+    if (host::fsRoot.empty()) {
+        host::resetFileSystem();
+    }
+    return true;
+}
+
+bool Adafruit_LittleFS::exists(const char* path) {
+    host::ShimScope scope;
+    struct stat info;
+    return stat(host::resolve(path).c_str(), &info) == 0;
+}
+
+bool Adafruit_LittleFS::remove(const char* path) {
+    host::ShimScope scope;
+    host::fileOps++;
+    return ::remove(host::resolve(path).c_str()) == 0;
+}
+
+bool Adafruit_LittleFS::rename(const char* from, const char* to) {
+    host::ShimScope scope;
+    host::fileOps++;
+    return ::rename(host::resolve(from).c_str(), host::resolve(to).c_str()) == 0;
+}
+
+bool Adafruit_LittleFS::mkdir(const char* path) {
+    host::ShimScope scope;
+    return ::mkdir(host::resolve(path).c_str(), 0755) == 0 || exists(path);
+}
+
+bool Adafruit_LittleFS::rmdir(const char* path) {
+    host::ShimScope scope;
+    return ::rmdir(host::resolve(path).c_str()) == 0;
+}
+
+bool Adafruit_LittleFS::rmdir_r(const char* path) {
+    host::ShimScope scope;
+    std::string command = "rm -rf '" + host::resolve(path) + "'";
+    return system(command.c_str()) == 0;
+}
+
+bool Adafruit_LittleFS::format() {
+    host::ShimScope scope;
+    std::string command = "rm -rf '" + host::fsRoot + "'/*";
+    return system(command.c_str()) == 0;
+}
+
+}  // namespace Adafruit_LittleFS_Namespace
@@ -0,0 +1,352 @@
+/*
+ * TEST_BATCH_JSON - Cuerpo JSON de una subida
+ *
+ * Con 0, 1, 2 y 512 puntos (y subidas que juntan varios lotes), el cuerpo
+ * que entrega BatchJsonStream es JSON válido con la forma de batch_json.h,
+ * cada registro CSV devuelve el punto original y los bytes leídos son
+ * exactamente length() (el Content-Length del pedido).
+ */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "host_env.h"
+#include "gateway/batch_json.h"
+
+namespace {
+
+// Valor JSON mínimo: lo justo para revisar la forma del cuerpo
+struct Json {
+    enum class Kind : uint8_t { Null, Bool, Number, String, Array, Object };
+
+    Kind kind = Kind::Null;
+    double number = 0;
+    std::string text;
+    std::vector<Json> items;
+    std::vector<std::string> keys;  // paralelo a items en un objeto
+
+    const Json* member(const char* key) const {
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (keys[i] == key) {
+                return &items[i];
+            }
+        }
+        return nullptr;
+    }
+};
+
+// Parser estricto (RFC 8259, sin escapes \u): false ante cualquier error
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& input) : input(input), at(0) {}
+
+    bool parse(Json& out) {
+        return value(out) && (skipSpace(), at == input.size());
+    }
+
+private:
+    const std::string& input;
+    size_t at;
+
+    void skipSpace() {
+        while (at < input.size() && strchr(" \t\r\n", input[at]) != nullptr) {
+            at++;
+        }
+    }
+
+    bool literal(const char* word) {
+        size_t length = strlen(word);
+        if (input.compare(at, length, word) != 0) {
+            return false;
+        }
+        at += length;
+        return true;
+    }
+
+    bool value(Json& out) {
+        skipSpace();
+        if (at >= input.size()) {
+            return false;
+        }
+        char c = input[at];
+        if (c == '{') {
+            return object(out);
+        }
+        if (c == '[') {
+            return array(out);
+        }
+        if (c == '"') {
+            out.kind = Json::Kind::String;
+            return string(out.text);
+        }
+        if (c == 't' || c == 'f') {
+            out.kind = Json::Kind::Bool;
+            return literal(c == 't' ? "true" : "false");
+        }
+        if (c == 'n') {
+            return literal("null");
+        }
+        out.kind = Json::Kind::Number;
+        return number(out.number);
+    }
+
+    bool object(Json& out) {
+        out.kind = Json::Kind::Object;
+        at++;
+        skipSpace();
+        if (at < input.size() && input[at] == '}') {
+            at++;
+            return true;
+        }
+        while (true) {
+            skipSpace();
+            std::string key;
+            if (at >= input.size() || input[at] != '"' || !string(key)) {
+                return false;
+            }
+            skipSpace();
+            if (at >= input.size() || input[at++] != ':') {
+                return false;
+            }
+            Json item;
+            if (!value(item)) {
+                return false;
+            }
+            out.keys.push_back(key);
+            out.items.push_back(item);
+            skipSpace();
+            if (at >= input.size()) {
+                return false;
+            }
+            char c = input[at++];
+            if (c == '}') {
+                return true;
+            }
+            if (c != ',') {
+                return false;
+            }
+        }
+    }
+
+    bool array(Json& out) {
+        out.kind = Json::Kind::Array;
+        at++;
+        skipSpace();
+        if (at < input.size() && input[at] == ']') {
+            at++;
+            return true;
+        }
+        while (true) {
+            Json item;
+            if (!value(item)) {
+                return false;
+            }
+            out.items.push_back(item);
+            skipSpace();
+            if (at >= input.size()) {
+                return false;
+            }
+            char c = input[at++];
+            if (c == ']') {
+                return true;
+            }
+            if (c != ',') {
+                return false;
+            }
+        }
+    }
+
+    bool string(std::string& out) {
+        at++;
+        while (at < input.size()) {
+            char c = input[at++];
+            if (c == '"') {
+                return true;
+            }
+            if (static_cast<uint8_t>(c) < 0x20) {
+                return false;
+            }
+            if (c == '\\') {
+                if (at >= input.size() || strchr("\"\\/bfnrt", input[at]) == nullptr) {
+                    return false;
+                }
+                c = input[at++];
+            }
+            out += c;
+        }
+        return false;
+    }
+
+    bool number(double& out) {
+        size_t start = at;
+        if (at < input.size() && input[at] == '-') {
+            at++;
+        }
+        if (at >= input.size() || !isdigit(static_cast<uint8_t>(input[at]))) {
+            return false;
+        }
+        if (input[at] == '0') {
+            at++;
+        } else {
+            while (at < input.size() && isdigit(static_cast<uint8_t>(input[at]))) {
+                at++;
+            }
+        }
+        if (at < input.size() && input[at] == '.') {
+            at++;
+            if (at >= input.size() || !isdigit(static_cast<uint8_t>(input[at]))) {
+                return false;
+            }
+            while (at < input.size() && isdigit(static_cast<uint8_t>(input[at]))) {
+                at++;
+            }
+        }
+        out = strtod(input.c_str() + start, nullptr);
+        return true;
+    }
+};
+
+// Puntos al azar, con timestamps que a veces retroceden y valores extremos
+std::vector<SeriesPoint> randomPoints(size_t count) {
+    std::vector<SeriesPoint> points(count);
+    uint32_t timestamp = 1700000000;
+    for (SeriesPoint& p : points) {
+        timestamp += rand() % 3 == 0 ? static_cast<uint32_t>(-(rand() % 50)) : static_cast<uint32_t>(rand() % 120);
+        p.timestamp = timestamp;
+        p.latitudeE6 = rand() % 180000001 - 90000000;
+        p.longitudeE6 = rand() % 360000001 - 180000000;
+        p.sourceId = static_cast<uint16_t>(rand());
+        p.voltageMilli = static_cast<uint16_t>(rand());
+        p.rssiCenti = static_cast<int16_t>(rand() % 65536 - 32768);
+        p.snrCenti = static_cast<int16_t>(rand() % 3000 - 1500);
+    }
+    if (count > 0) {
+        points[0].rssiCenti = INT16_MIN;
+        points[0].latitudeE6 = -1;  // "-0.000001"
+    }
+    return points;
+}
+
+// Un campo en punto fijo, p.ej. "-3.312345" → -3312345
+bool parseFixed(const std::string& field, int decimals, int32_t& out) {
+    size_t dot = field.find('.');
+    if (dot == std::string::npos || field.size() - dot - 1 != static_cast<size_t>(decimals)) {
+        return false;
+    }
+    bool negative = field[0] == '-';
+    long whole = strtol(field.c_str() + (negative ? 1 : 0), nullptr, 10);
+    long fraction = strtol(field.c_str() + dot + 1, nullptr, 10);
+    long scale = 1;
+    for (int i = 0; i < decimals; i++) {
+        scale *= 10;
+    }
+    long value = whole * scale + fraction;
+    out = static_cast<int32_t>(negative ? -value : value);
+    return true;
+}
+
+// timestamp,source_id,latitude,longitude,voltage_mV,rssi_dBm,snr_dB
+bool sameAsCsv(const SeriesPoint& p, const std::string& csv) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    for (size_t comma = csv.find(','); ; comma = csv.find(',', start)) {
+        fields.push_back(csv.substr(start, comma - start));
+        if (comma == std::string::npos) {
+            break;
+        }
+        start = comma + 1;
+    }
+    int32_t latitude, longitude, rssi, snr;
+    return fields.size() == 7 && strtoul(fields[0].c_str(), nullptr, 10) == p.timestamp &&
+           strtoul(fields[1].c_str(), nullptr, 10) == p.sourceId && parseFixed(fields[2], 6, latitude) &&
+           latitude == p.latitudeE6 && parseFixed(fields[3], 6, longitude) && longitude == p.longitudeE6 &&
+           strtoul(fields[4].c_str(), nullptr, 10) == p.voltageMilli && parseFixed(fields[5], 2, rssi) &&
+           rssi == p.rssiCenti && parseFixed(fields[6], 2, snr) && snr == p.snrCenti;
+}
+
+std::string readBody(UploadBody& body) {
+    std::string out;
+    int c;
+    while ((c = body.read()) >= 0) {
+        out += static_cast<char>(c);
+    }
+    return out;
+}
+
+// {"session":N,"records":[...]} con los puntos del tramo
+bool matchesSegment(const Json& object, const UploadSegment& segment) {
+    const Json* session = object.member("session");
+    const Json* records = object.member("records");
+    if (object.kind != Json::Kind::Object || object.keys.size() != 2 || session == nullptr ||
+        session->kind != Json::Kind::Number || session->number != segment.sessionId || records == nullptr ||
+        records->kind != Json::Kind::Array || records->items.size() != segment.count) {
+        return false;
+    }
+    for (size_t i = 0; i < segment.count; i++) {
+        const Json& record = records->items[i];
+        if (record.kind != Json::Kind::String || !sameAsCsv(segment.points[i], record.text)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void checkUpload(const char* name, const std::vector<UploadSegment>& segments) {
+    BatchJsonStream body(segments.data(), segments.size());
+    std::string text = readBody(body);
+    if (text.size() != body.length()) {
+        fprintf(stderr, "%s: %u bytes leídos, length() = %u\n", name, static_cast<unsigned>(text.size()),
+                static_cast<unsigned>(body.length()));
+    }
+    CHECK(text.size() == body.length());
+    CHECK(body.read() == -1);
+
+    Json json;
+    JsonParser parser(text);
+    bool valid = parser.parse(json);
+    if (!valid) {
+        fprintf(stderr, "%s: JSON inválido: %.200s\n", name, text.c_str());
+    }
+    CHECK(valid);
+
+    // Un tramo: el objeto solo; cualquier otra cantidad, un arreglo
+    if (segments.size() == 1) {
+        CHECK(matchesSegment(json, segments[0]));
+    } else {
+        CHECK(json.kind == Json::Kind::Array && json.items.size() == segments.size());
+        for (size_t i = 0; i < segments.size() && i < json.items.size(); i++) {
+            CHECK(matchesSegment(json.items[i], segments[i]));
+        }
+    }
+
+    size_t records = 0;
+    for (const UploadSegment& segment : segments) {
+        records += segment.count;
+    }
+    CHECK(body.records() == records);
+
+    // Repetir el pedido da los mismos bytes
+    body.rewind();
+    CHECK(readBody(body) == text);
+}
+
+}  // namespace
+
+int main() {
+    srand(3);
+    for (size_t count : {0, 1, 2, 512}) {
+        std::vector<SeriesPoint> points = randomPoints(count);
+        char name[32];
+        snprintf(name, sizeof(name), "%u puntos", static_cast<unsigned>(count));
+        checkUpload(name, {{0xBEEF, points.data(), count}});
+    }
+
+    // Subidas que juntan lotes, con un tramo vacío en medio
+    std::vector<SeriesPoint> points = randomPoints(512);
+    checkUpload("3 tramos", {{1, points.data(), 100}, {2, points.data() + 100, 0}, {3, points.data() + 100, 412}});
+    checkUpload("2 tramos de 1", {{7, points.data(), 1}, {8, points.data() + 1, 1}});
+    checkUpload("sin tramos", {});
+    return host::finish("test_batch_json");
+}
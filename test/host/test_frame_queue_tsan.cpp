@@ -0,0 +1,84 @@
+/*
+ * TEST_FRAME_QUEUE_TSAN - Recepción UART entre dos hilos
+ *
+ * Un hilo hace de tarea de eventos del driver: decodifica bytes con
+ * FrameDecoder (algunas tramas corruptas) y las deja en FrameQueue. El hilo
+ * principal hace de loop(): saca tramas y lee los contadores (errors(),
+ * drops(), highWater()) mientras el otro escribe. Corre con ThreadSanitizer.
+ */
+
+#include <atomic>
+#include <thread>
+#include "host_env.h"
+#include "common/uart_frame.h"
+#include "gateway/frame_queue.h"
+
+namespace {
+
+constexpr uint32_t FRAMES = 20000;
+constexpr uint32_t CORRUPT_EVERY = 7;
+constexpr size_t SLOTS = 8;
+
+}  // namespace
+
+int main() {
+    FrameDecoder decoder;
+    FrameQueue<SLOTS> queue;
+    std::atomic<bool> done(false);
+    uint32_t valid = 0;
+
+    std::thread producer([&] {
+        uint8_t encoded[FRAME_ENCODED_MAX];
+        for (uint32_t i = 0; i < FRAMES; i++) {
+            FrameWriter writer(FrameType::Data);
+            size_t length = writer.put(i).encode(encoded);
+            if (i % CORRUPT_EVERY == 0) {
+                // CRC inválido sin tocar la estructura COBS (nunca 0x00)
+                encoded[1] = encoded[1] == 0xFF ? 0xFE : encoded[1] + 1;
+            } else {
+                valid++;
+            }
+            for (size_t j = 0; j < length; j++) {
+                if (decoder.push(encoded[j])) {
+                    queue.push(decoder.frame());
+                }
+            }
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    uint8_t frame[FRAME_PAYLOAD_MAX];
+    size_t length;
+    uint32_t received = 0;
+    uint32_t last = 0;
+    bool ordered = true;
+    uint32_t observedErrors = 0;
+    while (true) {
+        bool finished = done.load(std::memory_order_acquire);
+        // Contadores leídos mientras el productor los escribe
+        uint32_t errors = decoder.errors();
+        ordered = ordered && errors >= observedErrors && queue.highWater() <= SLOTS;
+        observedErrors = errors;
+        (void)queue.drops();
+
+        if (queue.pop(frame, length)) {
+            FrameReader reader(frame, length);
+            uint32_t value = 0;
+            ordered = ordered && reader.get(value) && (received == 0 || value > last);
+            last = value;
+            received++;
+        } else if (finished) {
+            break;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+
+    uint32_t corrupted = (FRAMES + CORRUPT_EVERY - 1) / CORRUPT_EVERY;
+    CHECK(ordered);
+    CHECK(decoder.errors() == corrupted);
+    CHECK(received + queue.drops() == valid);
+    CHECK(queue.highWater() >= 1 && queue.highWater() <= SLOTS);
+    return host::finish("test_frame_queue_tsan");
+}
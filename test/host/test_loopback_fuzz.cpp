@@ -0,0 +1,409 @@
+/*
+ * TEST_LOOPBACK_FUZZ - Sesiones al azar entre Solar Node y gateway
+ *
+ * Las dos máquinas de estado corren en el mismo proceso (loopback.h) sobre
+ * un cable simulado con latencia y jitter, bits invertidos, bytes perdidos
+ * y basura mientras las dos puntas no están a la misma velocidad. Durante
+ * la sesión se reinician el gateway y el Solar Node. Cada sesión termina
+ * cuando el nodo no tiene nada y el gateway subió todo, y se verifica que
+ * cada registro llegó al servidor una sola vez y sin cambios.
+ *
+ * El reporte mide cada lote por la UART, desde el primer START_BATCH del
+ * nodo hasta el TRANSFER_OK del gateway, sin los temporizadores de subida
+ * (PING_INTERVAL_MS, UPLOAD_COALESCE_MS) que dominan el tiempo de la sesión:
+ * registros por segundo de los lotes sin reinicios y duración del lote que
+ * retoma un tramo cortado por un reinicio (recuperación). Los registros de
+ * un lote son los anunciados menos los que el gateway ya tenía (ACK).
+ *
+ *   test_loopback_fuzz [sesiones] [semilla]
+ *
+ * Los reinicios del nodo ocurren después del START_BATCH de una sesión nueva
+ * (el nodo vacía sus bloques al armar el lote; los reintentos del anuncio
+ * no): lo que aún está en RAM se pierde en un corte real, y eso no lo mide
+ * esta prueba.
+ */
+
+#include <deque>
+#include <map>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+#include "loopback.h"
+
+namespace {
+
+constexpr unsigned DEFAULT_SESSIONS = 40;
+constexpr unsigned long SESSION_LIMIT_MS = 6UL * 60 * 60 * 1000;
+constexpr int BURSTS = 3;
+
+struct Faults {
+    unsigned long latencyMs;
+    unsigned long jitterMs;
+    double bitErrorRate;       // por byte
+    double dropRate;           // por byte
+    double gatewayResetsPerMinute;
+    double nodeResetsPerMinute;
+};
+
+struct SessionReport {
+    size_t records;
+    unsigned long elapsedMs;
+    unsigned gatewayResets;
+    unsigned nodeResets;
+    unsigned cleanBatches;
+    size_t cleanRecords;
+    unsigned long cleanMs;
+    unsigned recoveries;
+    unsigned long totalRecoveryMs;
+    unsigned long worstRecoveryMs;
+    size_t duplicates;
+    size_t missing;
+    size_t unexpected;
+    uint32_t frameErrors;
+};
+
+std::mt19937 rng;
+
+double uniform() { return std::uniform_real_distribution<double>(0.0, 1.0)(rng); }
+unsigned long between(unsigned long low, unsigned long high) {
+    return std::uniform_int_distribution<unsigned long>(low, high)(rng);
+}
+
+// Un sentido del cable: cada byte llega a su hora, en orden, y sale como
+// basura si la punta que lo recibe ya no está a la velocidad con que se envió
+class Wire {
+public:
+    Wire(HardwareSerial& from, HardwareSerial& to) : from(from), to(to), lastArrival(0) {}
+
+    void carry(const Faults& faults) {
+        unsigned long now = millis();
+        for (size_t i = 0; i < from.tx.size(); i++) {
+            if (uniform() < faults.dropRate) {
+                continue;
+            }
+            Byte byte;
+            byte.value = from.tx[i];
+            byte.baud = i < from.txBaud.size() ? from.txBaud[i] : from.baud;
+            if (uniform() < faults.bitErrorRate) {
+                byte.value ^= static_cast<uint8_t>(1u << between(0, 7));
+            }
+            unsigned long arrival = now + faults.latencyMs + between(0, faults.jitterMs);
+            lastArrival = static_cast<long>(arrival - lastArrival) > 0 ? arrival : lastArrival;
+            byte.arrival = lastArrival;
+            inFlight.push_back(byte);
+        }
+        from.tx.clear();
+        from.txBaud.clear();
+
+        std::vector<uint8_t> ready;
+        while (!inFlight.empty() && static_cast<long>(now - inFlight.front().arrival) >= 0) {
+            const Byte& byte = inFlight.front();
+            ready.push_back(byte.baud == to.baud ? byte.value : static_cast<uint8_t>(between(0, 255)));
+            inFlight.pop_front();
+        }
+        if (!ready.empty()) {
+            to.deliver(ready.data(), ready.size());
+        }
+    }
+
+    // Un reinicio corta lo que estaba en el cable hacia esa punta
+    void clear() { inFlight.clear(); }
+
+private:
+    struct Byte {
+        unsigned long arrival;
+        unsigned long baud;
+        uint8_t value;
+    };
+
+    HardwareSerial& from;
+    HardwareSerial& to;
+    std::deque<Byte> inFlight;
+    unsigned long lastArrival;
+};
+
+// Registros esperados (timestamp → fuente) y los que llegan al servidor
+std::map<uint32_t, uint16_t> expected;
+std::map<uint32_t, unsigned> received;
+size_t unexpectedRecords = 0;
+
+// Cuerpo JSON: "records":["<timestamp>,<fuente>,...", ...]
+int acceptUpload(const std::string& body) {
+    for (size_t at = body.find("\"records\":["); at != std::string::npos; at = body.find("\"records\":[", at + 1)) {
+        size_t end = body.find(']', at);
+        for (size_t quote = body.find('"', at + 11); quote != std::string::npos && quote < end;
+             quote = body.find('"', body.find('"', quote + 1) + 1)) {
+            char* rest = nullptr;
+            uint32_t timestamp = static_cast<uint32_t>(strtoul(body.c_str() + quote + 1, &rest, 10));
+            uint16_t source = static_cast<uint16_t>(strtoul(rest + 1, nullptr, 10));
+            auto it = expected.find(timestamp);
+            if (it == expected.end() || it->second != source) {
+                unexpectedRecords++;
+                continue;
+            }
+            received[timestamp]++;
+        }
+    }
+    return 200;
+}
+
+// Lotes por la UART: un tramo del log (secuencia inicial) desde su primer
+// START_BATCH hasta su TRANSFER_OK. Si el tramo pasa por varias sesiones del
+// nodo (sin ACK, cancelada) se suma sólo el tiempo con sesión activa, del
+// START_BATCH a su última trama; la espera del próximo PING no cuenta. Un
+// reinicio con el tramo en curso lo vuelve recuperación y su reloj arranca
+// de cero. Un tramo ya confirmado que se vuelve a anunciar (p.ej. tras
+// perderse su TRANSFER_OK) no cuenta.
+class BatchClock {
+public:
+    void nodeFrame(FrameReader frame) {
+        uint32_t session = 0;
+        if (!frame.get(session)) {
+            return;
+        }
+        if (open && session == current) {
+            lastFrameAt = millis();
+        }
+        uint32_t count = 0, bytes = 0, isQuery = 0, resume = 0, firstSequence = 0;
+        if (frame.type() != FrameType::StartBatch || !frame.get(count) || !frame.get(bytes) ||
+            !frame.get(isQuery) || !frame.get(resume) || !frame.get(firstSequence) ||
+            delivered.count(std::make_pair(firstSequence, count)) > 0 || (open && session == current)) {
+            return;
+        }
+        closeSession();
+        if (!pending || firstSequence != first) {
+            pending = true;
+            first = firstSequence;
+            acked = false;
+            interrupted = false;
+            activeMs = 0;
+        }
+        open = true;
+        current = session;
+        records = count;
+        startedAt = lastFrameAt = millis();
+    }
+
+    void gatewayFrame(FrameReader frame, SessionReport& report) {
+        uint32_t session = 0;
+        if (!open || !frame.get(session) || session != current) {
+            return;
+        }
+        lastFrameAt = millis();
+        if (frame.type() == FrameType::Ack) {
+            uint32_t held = 0;
+            if (!acked && frame.get(held)) {
+                acked = true;
+                needed = held < records ? records - held : 0;
+            }
+            return;
+        }
+        if (frame.type() != FrameType::TransferOk) {
+            return;
+        }
+        closeSession();
+        if (interrupted) {
+            report.recoveries++;
+            report.totalRecoveryMs += activeMs;
+            report.worstRecoveryMs = activeMs > report.worstRecoveryMs ? activeMs : report.worstRecoveryMs;
+        } else {
+            report.cleanBatches++;
+            report.cleanRecords += needed;
+            report.cleanMs += activeMs;
+        }
+        delivered.insert(std::make_pair(first, records));
+        pending = false;
+    }
+
+    // Un reinicio de cualquiera de las dos puntas corta la sesión en curso
+    void reset() {
+        open = false;
+        if (pending) {
+            interrupted = true;
+            activeMs = 0;
+        }
+    }
+
+private:
+    bool pending = false;   // tramo anunciado sin TRANSFER_OK
+    bool open = false;      // sesión del tramo en curso
+    bool acked = false;
+    bool interrupted = false;
+    uint32_t first = 0;
+    uint32_t current = 0;
+    uint32_t records = 0;
+    uint32_t needed = 0;    // registros que el gateway no tenía al primer ACK
+    unsigned long startedAt = 0;
+    unsigned long lastFrameAt = 0;
+    unsigned long activeMs = 0;
+    std::set<std::pair<uint32_t, uint32_t>> delivered;
+
+    void closeSession() {
+        if (open) {
+            activeMs += lastFrameAt - startedAt;
+            open = false;
+        }
+    }
+};
+
+Faults randomFaults() {
+    Faults faults;
+    faults.latencyMs = between(0, 40);
+    faults.jitterMs = between(0, 20);
+    faults.bitErrorRate = uniform() < 0.3 ? 0.0 : uniform() * 2e-3;
+    faults.dropRate = uniform() < 0.3 ? 0.0 : uniform() * 5e-3;
+    faults.gatewayResetsPerMinute = uniform() < 0.25 ? 0.0 : uniform() * 1.5;
+    faults.nodeResetsPerMinute = uniform() < 0.25 ? 0.0 : uniform() * 1.5;
+    return faults;
+}
+
+SessionReport runSession(const Faults& faults) {
+    SessionReport report = {};
+    expected.clear();
+    received.clear();
+    unexpectedRecords = 0;
+
+    host::resetFileSystem();
+    loopback::rebootNode();
+    loopback::rebootGateway();
+    Wire toGateway(Serial1, solarLink);
+    Wire toNode(solarLink, Serial1);
+
+    unsigned long start = millis();
+    unsigned long nextBurst = start;
+    int bursts = 0;
+    uint32_t timestamp = 1700000000 + static_cast<uint32_t>(between(0, 1000000));
+    bool durable = true;       // todo lo grabado ya está en flash
+    FrameDecoder nodeSpy;      // tramas del nodo y del gateway, antes del cable
+    FrameDecoder gatewaySpy;
+    uint32_t announced = 0;    // última sesión anunciada por el nodo
+    BatchClock batches;
+    uint32_t frameErrors = solarDecoder.errors();
+
+    unsigned long lastCheck = start;
+    while (millis() - start < SESSION_LIMIT_MS) {
+        unsigned long now = millis();
+        if (bursts < BURSTS && static_cast<long>(now - nextBurst) >= 0) {
+            size_t count = between(60, 250);
+            for (size_t i = 0; i < count; i++) {
+                uint16_t source = static_cast<uint16_t>(between(1, 6));
+                timestamp += static_cast<uint32_t>(between(1, 40));
+                expected[timestamp] = source;
+                endNodeRepeaterRole.recordLoRaPacket(source, -33.45f + uniform() * 0.01f, -70.66f - uniform() * 0.01f,
+                                                    timestamp, static_cast<uint16_t>(between(3300, 4200)),
+                                                    -60.0f - between(0, 600) / 10.0f, between(0, 200) / 10.0f - 10.0f);
+            }
+            report.records += count;
+            durable = false;
+            bursts++;
+            nextBurst = now + between(5000, 90000);
+        }
+
+        // Reinicios: probabilidad por minuto aplicada a lo que avanzó el reloj
+        double minutes = (now - lastCheck) / 60000.0;
+        lastCheck = now;
+        if (uniform() < faults.gatewayResetsPerMinute * minutes) {
+            loopback::rebootGateway();
+            toGateway.clear();
+            report.gatewayResets++;
+            batches.reset();
+        }
+        if (durable && uniform() < faults.nodeResetsPerMinute * minutes) {
+            loopback::rebootNode();
+            toNode.clear();
+            report.nodeResets++;
+            batches.reset();
+            announced = 0;
+        }
+
+        loop();
+        for (uint8_t byte : solarLink.tx) {
+            if (gatewaySpy.push(byte)) {
+                batches.gatewayFrame(gatewaySpy.frame(), report);
+            }
+        }
+        toGateway.carry(faults);
+        toNode.carry(faults);
+        endNodeRepeaterRole.handleMode();
+        for (uint8_t byte : Serial1.tx) {
+            if (nodeSpy.push(byte)) {
+                batches.nodeFrame(nodeSpy.frame());
+                FrameReader frame = nodeSpy.frame();
+                uint32_t session = 0;
+                if (frame.type() == FrameType::StartBatch && frame.get(session) && session != announced) {
+                    announced = session;
+                    durable = true;
+                }
+            }
+        }
+        toGateway.carry(faults);
+        toNode.carry(faults);
+
+        if (bursts == BURSTS && loopback::settled() && received.size() == expected.size()) {
+            break;
+        }
+    }
+
+    report.elapsedMs = millis() - start;
+    for (const auto& entry : expected) {
+        auto it = received.find(entry.first);
+        if (it == received.end()) {
+            report.missing++;
+        } else {
+            report.duplicates += it->second - 1;
+        }
+    }
+    report.unexpected = unexpectedRecords;
+    report.frameErrors = solarDecoder.errors() - frameErrors;
+    return report;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    unsigned sessions = argc > 1 ? static_cast<unsigned>(strtoul(argv[1], nullptr, 10)) : DEFAULT_SESSIONS;
+    unsigned long seed = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1;
+    host::setQuiet(true);
+    host::httpServer = acceptUpload;
+
+    size_t cleanRecords = 0;
+    unsigned long cleanMs = 0;
+    unsigned long worstRecovery = 0;
+    for (unsigned session = 0; session < sessions; session++) {
+        rng.seed(static_cast<unsigned>(seed + session));
+        randomSeed(seed + session);
+        Faults faults = randomFaults();
+        SessionReport report = runSession(faults);
+
+        printf("sesión %2u: lat %3lu±%2lu ms  BER %.1e  pérdida %.1e  reinicios gw %2u nodo %2u | "
+               "%4u reg en %6.1f s  lotes %2u a %6.1f reg/s  recuperación %2u lotes prom %5.2f s máx %5.2f s  "
+               "tramas malas %2u  duplicados %u\n",
+               session, faults.latencyMs, faults.jitterMs, faults.bitErrorRate, faults.dropRate,
+               report.gatewayResets, report.nodeResets, static_cast<unsigned>(report.records),
+               report.elapsedMs / 1000.0, report.cleanBatches,
+               report.cleanMs > 0 ? report.cleanRecords * 1000.0 / report.cleanMs : 0.0, report.recoveries,
+               report.recoveries > 0 ? report.totalRecoveryMs / 1000.0 / report.recoveries : 0.0,
+               report.worstRecoveryMs / 1000.0, static_cast<unsigned>(report.frameErrors),
+               static_cast<unsigned>(report.duplicates));
+        if (report.missing > 0 || report.unexpected > 0 || report.duplicates > 0) {
+            fprintf(stderr, "sesión %u (semilla %lu): %u registros sin subir, %u distintos de los grabados, "
+                    "%u duplicados\n",
+                    session, seed + session, static_cast<unsigned>(report.missing),
+                    static_cast<unsigned>(report.unexpected), static_cast<unsigned>(report.duplicates));
+        }
+        // Ni los reinicios del nodo duplican: el gateway reconoce por época y
+        // secuencia un lote que ya tiene, aun confirmado
+        CHECK(report.missing == 0);
+        CHECK(report.unexpected == 0);
+        CHECK(report.duplicates == 0);
+        CHECK(report.elapsedMs < SESSION_LIMIT_MS);
+
+        cleanRecords += report.cleanRecords;
+        cleanMs += report.cleanMs;
+        worstRecovery = report.worstRecoveryMs > worstRecovery ? report.worstRecoveryMs : worstRecovery;
+    }
+    printf("total: lotes sin reinicios a %.1f reg/s por la UART, peor lote con reinicio %.2f s\n",
+           cleanMs > 0 ? cleanRecords * 1000.0 / cleanMs : 0.0, worstRecovery / 1000.0);
+    return host::finish("test_loopback_fuzz");
+}
@@ -0,0 +1,95 @@
+/*
+ * TEST_LOST_TRANSFER_OK - Un TRANSFER_OK perdido no duplica el lote
+ *
+ * El gateway encola el lote y responde TRANSFER_OK; esa trama se pierde en
+ * el cable. El Solar Node, sin resultado, vuelve a anunciar el mismo lote
+ * (misma época y secuencia) y el gateway lo reconoce como ya encolado por la
+ * sesión guardada: cada registro llega una sola vez al servidor.
+ */
+
+#include <map>
+#include <vector>
+#include "loopback.h"
+
+namespace {
+
+constexpr uint32_t RECORDS = 50;
+constexpr uint32_t FIRST_TIMESTAMP = 1700000000;
+constexpr size_t MAX_STEPS = 200000;
+
+std::map<uint32_t, unsigned> received;
+
+// Cuerpo JSON: "records":["<timestamp>,...", ...]
+int acceptUpload(const std::string& body) {
+    for (size_t at = body.find("\"records\":["); at != std::string::npos; at = body.find("\"records\":[", at + 1)) {
+        size_t end = body.find(']', at);
+        for (size_t quote = body.find('"', at + 11); quote != std::string::npos && quote < end;
+             quote = body.find('"', body.find('"', quote + 1) + 1)) {
+            received[static_cast<uint32_t>(strtoul(body.c_str() + quote + 1, nullptr, 10))]++;
+        }
+    }
+    return 200;
+}
+
+// Pasa los bytes del gateway al Solar Node trama por trama, salvo los del
+// primer TRANSFER_OK
+FrameDecoder gatewayFrames;
+std::vector<uint8_t> partial;
+unsigned transferOkDropped = 0;
+
+void pumpDroppingTransferOk() {
+    for (uint8_t byte : solarLink.tx) {
+        partial.push_back(byte);
+        bool complete = gatewayFrames.push(byte);
+        if (byte != 0) {
+            continue;
+        }
+        if (complete && gatewayFrames.frame().type() == FrameType::TransferOk && transferOkDropped == 0) {
+            transferOkDropped++;
+        } else {
+            Serial1.deliver(partial.data(), partial.size());
+        }
+        partial.clear();
+    }
+    solarLink.tx.clear();
+    solarLink.txBaud.clear();
+
+    solarLink.deliver(Serial1.tx.data(), Serial1.tx.size());
+    Serial1.tx.clear();
+    Serial1.txBaud.clear();
+}
+
+}  // namespace
+
+int main() {
+    host::resetFileSystem();
+    host::setQuiet(true);
+    host::httpServer = acceptUpload;
+    setup();
+
+    for (uint32_t i = 0; i < RECORDS; i++) {
+        endNodeRepeaterRole.recordLoRaPacket(3, -33.45f, -70.66f, FIRST_TIMESTAMP + i * 30, 3900, -90.0f, 7.5f);
+    }
+
+    bool settled = false;
+    for (size_t i = 0; i < MAX_STEPS && !settled; i++) {
+        loop();
+        pumpDroppingTransferOk();
+        endNodeRepeaterRole.handleMode();
+        pumpDroppingTransferOk();
+        settled = transferOkDropped > 0 && loopback::settled() && received.size() == RECORDS;
+    }
+
+    unsigned duplicates = 0;
+    for (const auto& entry : received) {
+        duplicates += entry.second - 1;
+    }
+    if (duplicates > 0) {
+        fprintf(stderr, "%u registros subidos dos veces\n", duplicates);
+    }
+    CHECK(settled);
+    CHECK(transferOkDropped == 1);
+    CHECK(received.size() == RECORDS);
+    CHECK(duplicates == 0);
+    return host::finish("test_lost_transfer_ok");
+}
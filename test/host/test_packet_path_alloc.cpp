@@ -0,0 +1,144 @@
+/*
+ * TEST_PACKET_PATH_ALLOC - Sin asignaciones dinámicas en el camino de un punto
+ *
+ * Un paquete GPS entra por el radio simulado, LoRaManager lo valida y lo
+ * pasa al rol, el rol lo guarda y lo manda al gateway en tramas, y el
+ * gateway las decodifica, las encola y las sube. Tras una vuelta de
+ * calentamiento (buffers que se reservan una vez), las vueltas siguientes
+ * no pueden llamar a operator new ni a malloc.
+ *
+ * El sistema de archivos, los seriales y el cliente HTTP del simulador no
+ * cuentan: en la placa son LittleFS y los drivers, fuera de este código.
+ */
+
+#include <new>
+#include "loopback.h"
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* pointer, size_t size);
+extern "C" void __libc_free(void* pointer);
+
+namespace {
+bool counting = false;
+unsigned long allocations = 0;
+
+void note() {
+    if (counting && !host::inShim()) {
+        allocations++;
+    }
+}
+
+void* allocate(size_t size) {
+    note();
+    void* pointer = __libc_malloc(size == 0 ? 1 : size);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+}  // namespace
+
+extern "C" void* malloc(size_t size) {
+    note();
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    note();
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size) {
+    note();
+    return __libc_realloc(pointer, size);
+}
+
+extern "C" void free(void* pointer) { __libc_free(pointer); }
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    note();
+    return __libc_malloc(size == 0 ? 1 : size);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    note();
+    return __libc_malloc(size == 0 ? 1 : size);
+}
+void operator delete(void* pointer) noexcept { __libc_free(pointer); }
+void operator delete[](void* pointer) noexcept { __libc_free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { __libc_free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { __libc_free(pointer); }
+
+namespace {
+
+constexpr int PACKETS_PER_ROUND = 40;
+constexpr int ROUNDS = 4;
+
+uint16_t packetId = 0;
+unsigned long uploads = 0;
+
+int acceptUpload(const std::string&) {
+    uploads++;
+    return 200;
+}
+
+void receiveGpsPacket(uint16_t source, uint32_t timestamp) {
+    LoRaPacket packet = {};
+    packet.messageType = MSG_GPS_DATA;
+    packet.sourceID = source;
+    packet.destinationID = LORA_BROADCAST_ADDR;
+    packet.maxHops = 3;
+    packet.packetID = ++packetId;
+    packet.networkHash = configManager.getActiveNetworkHash();
+    GPSPayload payload = {-33.45f + timestamp % 97 * 1e-5f, -70.66f, timestamp, 3900, 7, 0};
+    packet.payloadLength = sizeof(payload);
+    memcpy(packet.payload, &payload, sizeof(payload));
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&packet);
+    for (size_t i = 0; i + 2 < sizeof(packet); i++) {
+        packet.checksum ^= bytes[i];
+    }
+    host::radioInject(&packet, sizeof(packet));
+    loraManager.update();
+}
+
+// Una vuelta: llegan los paquetes y se espera a que el gateway los suba
+bool round(uint32_t& timestamp) {
+    for (int i = 0; i < PACKETS_PER_ROUND; i++) {
+        receiveGpsPacket(static_cast<uint16_t>(3 + i % 4), timestamp);
+        timestamp += 30;
+    }
+    host::advance(PING_INTERVAL_MS + 1);
+    return loopback::drain(20000);
+}
+
+}  // namespace
+
+int main() {
+    host::resetFileSystem();
+    host::setQuiet(true);
+    host::httpServer = acceptUpload;
+    loraManager.setRole(ROLE_END_NODE_REPEATER);
+    loraManager.begin(1);
+    setup();
+
+    uint32_t timestamp = 1700000000;
+    CHECK(round(timestamp));  // calentamiento
+
+    counting = true;
+    bool drained = true;
+    for (int i = 0; i < ROUNDS; i++) {
+        drained = round(timestamp) && drained;
+    }
+    counting = false;
+
+    CHECK(drained);
+    CHECK(loraManager.getStats().packetsReceived == static_cast<uint32_t>(PACKETS_PER_ROUND * (ROUNDS + 1)));
+    CHECK(uploads >= static_cast<unsigned long>(ROUNDS + 1));
+    CHECK(allocations == 0);
+    if (allocations != 0) {
+        fprintf(stderr, "%lu asignaciones tras el calentamiento\n", allocations);
+    }
+    return host::finish("test_packet_path_alloc");
+}
@@ -0,0 +1,235 @@
+/*
+ * TEST_RETENTION - Compactación del log con el anillo lleno
+ *
+ * Con más fuentes que RETENTION_MAX_SOURCES y COMPACT_MAX_SURVIVORS, cada
+ * fuente conserva al menos su último punto. Un fallo al armar el segmento
+ * compactado deja la cabeza intacta, y un corte entre el rename y el cursor
+ * se recupera al arrancar sin perder registros.
+ */
+
+#include <string.h>
+#include <vector>
+#include "host_env.h"
+#include "storage/flash_storage.h"
+#include "storage/record_log.h"
+
+namespace {
+
+constexpr uint8_t SEGMENTS = 4;
+constexpr uint16_t SOURCES = 40;
+
+// Backend que falla a pedido las operaciones sobre una ruta
+class FaultyStorage : public StorageBackend {
+public:
+    enum class Fault : uint8_t { None, Write, Rename };
+
+    explicit FaultyStorage(StorageBackend& backing) : backing(backing), fault(Fault::None), faultPath(nullptr) {}
+
+    void fail(Fault kind, const char* path) {
+        fault = kind;
+        faultPath = path;
+    }
+
+    bool begin() override { return backing.begin(); }
+    bool exists(const char* path) override { return backing.exists(path); }
+    bool remove(const char* path) override { return backing.remove(path); }
+    uint32_t size(const char* path) override { return backing.size(path); }
+    bool read(const char* path, uint32_t offset, void* data, size_t length) override {
+        return backing.read(path, offset, data, length);
+    }
+    bool write(const char* path, uint32_t offset, const void* data, size_t length) override {
+        return !matches(Fault::Write, path) && backing.write(path, offset, data, length);
+    }
+    bool truncate(const char* path, uint32_t length) override { return backing.truncate(path, length); }
+    bool rename(const char* from, const char* to) override {
+        return !matches(Fault::Rename, from) && backing.rename(from, to);
+    }
+    const char* name() const override { return backing.name(); }
+
+private:
+    StorageBackend& backing;
+    Fault fault;
+    const char* faultPath;
+
+    bool matches(Fault kind, const char* path) const { return fault == kind && strcmp(path, faultPath) == 0; }
+};
+
+SeriesPoint point(uint16_t source, uint32_t timestamp) {
+    SeriesPoint p = {};
+    p.timestamp = timestamp;
+    p.latitudeE6 = -33440000 + source * 100;
+    p.longitudeE6 = -70650000 - source * 100;
+    p.sourceId = source;
+    p.voltageMilli = 3700;
+    p.rssiCenti = -9000;
+    p.snrCenti = 750;
+    return p;
+}
+
+// Registros pendientes en flash; false si alguno no se puede leer
+bool readPending(RecordLog& log, std::vector<StoredRecord>& out) {
+    out.clear();
+    RecordReader reader(log);
+    reader.open(log.firstSequence(), log.count());
+    StoredRecord record;
+    bool ok = true;
+    for (size_t i = 0; i < reader.size(); i++) {
+        if (reader.read(i, record)) {
+            out.push_back(record);
+        } else {
+            ok = false;
+        }
+    }
+    reader.close();
+    return ok;
+}
+
+bool sameRecords(const std::vector<StoredRecord>& a, const std::vector<StoredRecord>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].sequence != b[i].sequence || a[i].sourceId != b[i].sourceId || a[i].timestamp != b[i].timestamp) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Rondas de una lectura por fuente hasta completar el anillo
+void fillRing(RecordLog& log, uint32_t& timestamp) {
+    while (log.segmentsInUse() < log.segmentCount()) {
+        for (uint16_t s = 0; s < SOURCES; s++) {
+            log.append(point(s, timestamp));
+        }
+        timestamp += 60;
+    }
+}
+
+// Ninguna fuente desaparece aunque haya más que la tabla de cuotas
+void checkEverySourceSurvives() {
+    host::resetFileSystem();
+    FlashStorage flash;
+    RecordLog log(flash, SEGMENTS);
+    CHECK(log.begin());
+
+    // Una sola ronda de todas las fuentes entre tramos de la fuente 0: cae
+    // en uno o dos segmentos, y después las demás siguen en el log sólo por
+    // lo que conservan las compactaciones
+    uint32_t timestamp = 1700000000;
+    while (log.segmentsInUse() < log.segmentCount()) {
+        CHECK(log.append(point(0, timestamp)));
+        timestamp += 60;
+    }
+    for (uint16_t s = 0; s < SOURCES; s++) {
+        CHECK(log.append(point(s, timestamp)));
+    }
+    while (log.stats().compactions < 4 * SEGMENTS) {
+        CHECK(log.append(point(0, timestamp)));
+        timestamp += 60;
+    }
+    CHECK(log.flush());
+
+    std::vector<StoredRecord> pending;
+    CHECK(readPending(log, pending));
+    CHECK(pending.size() == log.count());
+    bool seen[SOURCES] = {};
+    for (const StoredRecord& record : pending) {
+        if (record.sourceId < SOURCES) {
+            seen[record.sourceId] = true;
+        }
+    }
+    for (uint16_t s = 0; s < SOURCES; s++) {
+        if (!seen[s]) {
+            fprintf(stderr, "fuente %u perdida al compactar\n", static_cast<unsigned>(s));
+        }
+        CHECK(seen[s]);
+    }
+    CHECK(!flash.exists("/lora_seg.new"));
+}
+
+// Falla la escritura del segmento compactado o su rename: el append se
+// rechaza y la cabeza sigue entera; al volver el medio, se compacta
+void checkFailedCompaction(FaultyStorage::Fault fault, const char* path) {
+    host::resetFileSystem();
+    FlashStorage flash;
+    FaultyStorage faulty(flash);
+    RecordLog log(faulty, SEGMENTS);
+    CHECK(log.begin());
+
+    uint32_t timestamp = 1700000000;
+    fillRing(log, timestamp);
+    CHECK(log.flush());
+    std::vector<StoredRecord> before;
+    CHECK(readPending(log, before));
+    uint32_t head = log.firstSequence();
+    uint16_t compactions = log.stats().compactions;
+
+    faulty.fail(fault, path);
+    bool failed = false;
+    for (int i = 0; i < 4000 && !failed; i++) {
+        failed = !log.append(point(static_cast<uint16_t>(i % SOURCES), timestamp + i));
+    }
+    CHECK(failed);
+    CHECK(log.stats().compactions == compactions);
+    CHECK(log.firstSequence() == head);
+    CHECK(log.segmentsInUse() == log.segmentCount());
+    CHECK(!flash.exists("/lora_seg.new"));
+
+    std::vector<StoredRecord> after;
+    CHECK(readPending(log, after));
+    after.resize(before.size() < after.size() ? before.size() : after.size());
+    CHECK(sameRecords(before, after));
+
+    faulty.fail(FaultyStorage::Fault::None, nullptr);
+    for (int i = 0; i < 4000 && log.stats().compactions == compactions; i++) {
+        CHECK(log.append(point(static_cast<uint16_t>(i % SOURCES), timestamp + 4000 + i)));
+    }
+    CHECK(log.stats().compactions > compactions);
+    CHECK(readPending(log, after));
+}
+
+// Corte tras el rename y antes del cursor: al arrancar se recupera lo mismo
+// que tenía el log en RAM
+void checkCrashBeforeCursor() {
+    host::resetFileSystem();
+    FlashStorage flash;
+    FaultyStorage faulty(flash);
+    RecordLog log(faulty, SEGMENTS);
+    CHECK(log.begin());
+
+    uint32_t timestamp = 1700000000;
+    fillRing(log, timestamp);
+    CHECK(log.flush());
+    uint16_t compactions = log.stats().compactions;
+
+    // Sin cursor desde aquí: en flash queda el de antes de compactar
+    faulty.fail(FaultyStorage::Fault::Write, "/lora_log.cur");
+    for (int i = 0; i < 4000 && log.stats().compactions == compactions; i++) {
+        log.append(point(static_cast<uint16_t>(i % SOURCES), timestamp + i));
+    }
+    CHECK(log.stats().compactions == compactions + 1);
+    CHECK(log.flush());
+    std::vector<StoredRecord> live;
+    CHECK(readPending(log, live));
+
+    FlashStorage reopened;
+    RecordLog recovered(reopened, SEGMENTS);
+    CHECK(recovered.begin());
+    CHECK(recovered.firstSequence() == log.firstSequence());
+    CHECK(recovered.nextSequence() == log.nextSequence());
+    std::vector<StoredRecord> restored;
+    CHECK(readPending(recovered, restored));
+    CHECK(sameRecords(live, restored));
+}
+
+}  // namespace
+
+int main() {
+    host::setQuiet(true);
+    checkEverySourceSurvives();
+    checkFailedCompaction(FaultyStorage::Fault::Write, "/lora_seg.new");
+    checkFailedCompaction(FaultyStorage::Fault::Rename, "/lora_seg.new");
+    checkCrashBeforeCursor();
+    return host::finish("test_retention");
+}
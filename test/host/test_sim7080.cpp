@@ -0,0 +1,264 @@
+/*
+ * TEST_SIM7080 - Sim7080Uplink contra un módem simulado
+ *
+ * FakeModem responde los comandos AT que usa el uplink, recibe el cuerpo de
+ * AT+SHBOD y sigue PWRKEY: un pulso largo lo enciende, lo apaga o lo
+ * despierta de PSM. Se prueba el arranque en frío, un módem ya encendido
+ * cuyo primer sondeo se pierde (no se pulsa PWRKEY: lo apagaría) y la
+ * entrada en PSM tanto en Ready como tras cortar la sesión HTTP.
+ */
+
+#include <new>
+#include <string>
+#include <vector>
+#include "host_env.h"
+#include "gateway/batch_json.h"
+#include "gateway/sim7080.h"
+
+namespace {
+
+constexpr int PWRKEY_PIN = 41;
+constexpr unsigned long STEP_MS = 10;
+constexpr unsigned long BOOT_MS = 3000;
+constexpr unsigned long PULSE_MIN_MS = 1000;
+
+class FakeModem {
+public:
+    enum class Power : uint8_t { Off, On, Psm };
+
+    explicit FakeModem(HardwareSerial& link) : link(link) {}
+
+    Power power = Power::Off;
+    unsigned ignoreProbes = 0;  // sondeos "AT" sin respuesta (p.ej. UART recién abierta)
+    unsigned pulses = 0;
+    unsigned shconn = 0;
+    std::vector<std::string> bodies;
+
+    void service() {
+        watchPwrkey();
+        for (uint8_t c : link.tx) {
+            if (bodyExpected > 0) {
+                body += static_cast<char>(c);
+                if (--bodyExpected == 0) {
+                    bodies.push_back(body);
+                    reply("OK");
+                }
+            } else if (c == '\r') {
+                command(pendingLine);
+                pendingLine.clear();
+            } else {
+                pendingLine += static_cast<char>(c);
+            }
+        }
+        link.tx.clear();
+        link.txBaud.clear();
+        if (!out.empty()) {
+            std::string chunk;
+            chunk.swap(out);
+            link.deliver(reinterpret_cast<const uint8_t*>(chunk.data()), chunk.size());
+        }
+    }
+
+    void enterPsm() {
+        power = Power::Psm;
+        session = false;
+        reply("+CPSMSTATUS: \"ENTER PSM\"");
+    }
+
+private:
+    HardwareSerial& link;
+    std::string pendingLine;
+    std::string body;
+    size_t bodyExpected = 0;
+    std::string out;
+    bool pressed = false;
+    unsigned long pressedAt = 0;
+    unsigned long bootedAt = 0;
+    bool session = false;
+
+    void reply(const char* text) {
+        out += "\r\n";
+        out += text;
+        out += "\r\n";
+    }
+
+    // Un pulso de al menos PULSE_MIN_MS cambia de estado al soltar
+    void watchPwrkey() {
+        bool high = digitalRead(PWRKEY_PIN) == HIGH;
+        if (high && !pressed) {
+            pressed = true;
+            pressedAt = millis();
+        } else if (!high && pressed) {
+            pressed = false;
+            if (millis() - pressedAt < PULSE_MIN_MS) {
+                return;
+            }
+            pulses++;
+            if (power == Power::On) {
+                power = Power::Off;
+                session = false;
+            } else if (power == Power::Psm) {
+                power = Power::On;
+                reply("+CPSMSTATUS: \"EXIT PSM\"");
+            } else {
+                power = Power::On;
+                bootedAt = millis() + BOOT_MS;
+            }
+        }
+    }
+
+    void command(const std::string& text) {
+        if (power != Power::On || static_cast<long>(millis() - bootedAt) < 0) {
+            return;
+        }
+        if (text == "AT" && ignoreProbes > 0) {
+            ignoreProbes--;
+            return;
+        }
+        if (text == "AT+CEREG?") {
+            reply("+CEREG: 0,1");
+        } else if (text == "AT+CNACT?") {
+            reply("+CNACT: 0,1,\"10.0.0.2\"");
+        } else if (text == "AT+SHCONN") {
+            session = true;
+            shconn++;
+        } else if (text == "AT+SHCHEAD" && !session) {
+            reply("ERROR");
+            return;
+        } else if (text == "AT+SHDISC") {
+            session = false;
+        } else if (text.compare(0, 9, "AT+SHBOD=") == 0) {
+            bodyExpected = strtoul(text.c_str() + 9, nullptr, 10);
+            body.clear();
+            out += ">";
+            return;
+        } else if (text.compare(0, 9, "AT+SHREQ=") == 0) {
+            reply("OK");
+            reply("+SHREQ: \"POST\",200,2");
+            return;
+        } else if (text == "AT+CPOWD=1") {
+            reply("OK");
+            reply("NORMAL POWER DOWN");
+            power = Power::Off;
+            session = false;
+            return;
+        }
+        reply("OK");
+    }
+};
+
+HardwareSerial modemLink(2);
+FakeModem modem(modemLink);
+const Sim7080Uplink::Config MODEM_CONFIG = {"example.org", 443, "/api/records", "iot.example", PWRKEY_PIN};
+Sim7080Uplink uplink(modemLink, MODEM_CONFIG);
+
+void step() {
+    uplink.service();
+    modem.service();
+    host::advance(STEP_MS);
+}
+
+// Corre hasta que el POST termina; el resultado o Pending si se acabó el plazo
+Sim7080Uplink::Result runPost(unsigned long limitMs) {
+    for (unsigned long waited = 0; waited < limitMs; waited += STEP_MS) {
+        step();
+        Sim7080Uplink::Result result = uplink.takeResult();
+        if (result != Sim7080Uplink::Result::Pending && result != Sim7080Uplink::Result::Idle) {
+            return result;
+        }
+    }
+    return Sim7080Uplink::Result::Pending;
+}
+
+// Un POST con un cuerpo JSON chico; true si llegó entero al módem
+bool postOnce(uint16_t sessionId) {
+    SeriesPoint points[3] = {};
+    for (uint32_t i = 0; i < 3; i++) {
+        points[i].timestamp = 1700000000 + i * 30;
+        points[i].sourceId = 4;
+        points[i].voltageMilli = 3800;
+    }
+    UploadSegment segment = {sessionId, points, 3};
+    BatchJsonStream body(&segment, 1);
+    std::string expected;
+    int c;
+    while ((c = body.read()) >= 0) {
+        expected += static_cast<char>(c);
+    }
+
+    size_t before = modem.bodies.size();
+    if (!uplink.post(body) || runPost(60000) != Sim7080Uplink::Result::Done) {
+        return false;
+    }
+    return uplink.lastStatus() == 200 && modem.bodies.size() == before + 1 && modem.bodies.back() == expected;
+}
+
+void run(unsigned long ms) {
+    for (unsigned long waited = 0; waited < ms; waited += STEP_MS) {
+        step();
+    }
+}
+
+// Módem apagado: los sondeos no responden, se pulsa PWRKEY una vez
+void checkColdStart() {
+    uplink.begin();
+    CHECK(postOnce(1));
+    CHECK(modem.pulses == 1);
+    CHECK(modem.power == FakeModem::Power::On);
+    CHECK(uplink.radioOnMs() > 0);
+}
+
+// ESP32 reiniciado con el módem encendido y el primer sondeo perdido: el
+// uplink vuelve a sondear en vez de pulsar PWRKEY (que lo apagaría)
+void checkModemAlreadyOn() {
+    new (&uplink) Sim7080Uplink(modemLink, MODEM_CONFIG);
+    uplink.begin();
+    modem.ignoreProbes = 1;
+    unsigned pulses = modem.pulses;
+    CHECK(postOnce(2));
+    CHECK(modem.pulses == pulses);
+    CHECK(modem.power == FakeModem::Power::On);
+}
+
+// El módem entra en PSM con el uplink en Ready (sin corte por inactividad
+// todavía): el próximo POST lo despierta con PWRKEY y reabre la sesión HTTP
+void checkPsmWhileReady() {
+    CHECK(postOnce(3));
+    unsigned pulses = modem.pulses;
+    unsigned sessions = modem.shconn;
+    run(1000);
+    modem.enterPsm();
+    run(1000);
+
+    unsigned long radio = uplink.radioOnMs();
+    run(5000);
+    CHECK(uplink.radioOnMs() == radio);  // dormido no cuenta
+
+    CHECK(postOnce(4));
+    CHECK(modem.pulses == pulses + 1);
+    CHECK(modem.shconn == sessions + 1);
+}
+
+// Caso habitual: tras el corte por inactividad (AT+SHDISC) el módem entra
+// en PSM por su cuenta
+void checkPsmAfterDisconnect() {
+    CHECK(postOnce(5));
+    unsigned pulses = modem.pulses;
+    run(15000);
+    modem.enterPsm();
+    run(1000);
+    CHECK(postOnce(6));
+    CHECK(modem.pulses == pulses + 1);
+    CHECK(modem.power == FakeModem::Power::On);
+}
+
+}  // namespace
+
+int main() {
+    host::setQuiet(true);
+    checkColdStart();
+    checkModemAlreadyOn();
+    checkPsmWhileReady();
+    checkPsmAfterDisconnect();
+    return host::finish("test_sim7080");
+}
@@ -0,0 +1,117 @@
+/*
+ * TEST_UPLINK_HEALTH - El disyuntor de Wi-Fi cuenta POSTs, no conexiones
+ *
+ * Con el disyuntor de Wi-Fi abierto y la espera vencida, el próximo intento
+ * es una sonda. Mientras Wi-Fi conecta no sale ningún POST: la vía sigue
+ * abierta, no en sonda. Al conectar sale la sonda chica (PROBE_RECORDS) y
+ * su éxito cierra el disyuntor. Si Wi-Fi no conecta, la sonda falló igual:
+ * cada espera dobla la anterior hasta maxOpenMs, en vez de reintentar cada
+ * openMs para siempre.
+ */
+
+#include <vector>
+#include "loopback.h"
+
+namespace {
+
+unsigned long posts = 0;
+
+int acceptUpload(const std::string&) {
+    posts++;
+    return 200;
+}
+
+void queueRecords(size_t count) {
+    std::vector<SeriesPoint> points(count);
+    for (size_t i = 0; i < count; i++) {
+        points[i] = SeriesPoint{};
+        points[i].timestamp = 1700000000 + static_cast<uint32_t>(i) * 30;
+        points[i].sourceId = 5;
+    }
+    std::lock_guard<std::mutex> lock(queueMutex);
+    CHECK(uploadQueue.push(1, 0, points.data(), points.size(), 0));
+}
+
+// Celular fuera: abierto, y cada vez que vence su espera se anota otro fallo
+void keepCellularDown() {
+    while (cellularHealth.state() != PathHealth::State::Open || cellularHealth.ready(millis())) {
+        cellularHealth.failed(millis());
+    }
+}
+
+// Wi-Fi abierto tras WIFI_HEALTH.failureThreshold fallos
+void openWiFi() {
+    for (int i = 0; i < WIFI_HEALTH.failureThreshold; i++) {
+        wifiHealth.failed(millis());
+    }
+    CHECK(wifiHealth.state() == PathHealth::State::Open);
+}
+
+// La sonda espera a que Wi-Fi conecte y recién ahí cuenta como intento
+void checkProbeWaitsForConnect() {
+    keepCellularDown();
+    openWiFi();
+    host::advance(wifiHealth.waitMs(millis()));
+    CHECK(wifiHealth.ready(millis()));
+
+    queueRecords(100);
+    host::wifiStatus = WL_DISCONNECTED;
+    for (unsigned long waited = 0; waited < WIFI_CONNECT_TIMEOUT_MS / 2; waited += 100) {
+        runUplink();
+        host::advance(100);
+    }
+    CHECK(wifiConnecting);
+    CHECK(posts == 0);
+    CHECK(wifiHealth.state() == PathHealth::State::Open);
+
+    host::wifiStatus = WL_CONNECTED;
+    runUplink();
+    CHECK(posts == 1);
+    CHECK(wifiHealth.state() == PathHealth::State::Closed);
+    CHECK(uploadQueue.pendingRecords() == 100 - PROBE_RECORDS);
+}
+
+// Wi-Fi que nunca conecta: cada sonda vence WIFI_CONNECT_TIMEOUT_MS y la
+// espera siguiente (con jitter, entre la mitad y el total) se duplica
+void checkConnectFailuresBackOff() {
+    loopback::rebootGateway();
+    queueRecords(100);
+    keepCellularDown();
+    openWiFi();
+    host::wifiStatus = WL_DISCONNECTED;
+    unsigned long postsBefore = posts;
+
+    unsigned long expected = WIFI_HEALTH.openMs;
+    for (int probe = 0; probe < 5; probe++) {
+        host::advance(wifiHealth.waitMs(millis()));
+        keepCellularDown();
+        unsigned long waited = 0;
+        do {
+            runUplink();
+            host::advance(100);
+            waited += 100;
+        } while (wifiHealth.waitMs(millis()) == 0 && waited < 2 * WIFI_CONNECT_TIMEOUT_MS);
+
+        expected = expected * 2 < WIFI_HEALTH.maxOpenMs ? expected * 2 : WIFI_HEALTH.maxOpenMs;
+        unsigned long wait = wifiHealth.waitMs(millis());
+        if (wait < expected / 2 - 100 || wait > expected) {
+            fprintf(stderr, "sonda %d: espera %lu ms, se esperaba entre %lu y %lu\n", probe, wait, expected / 2,
+                    expected);
+        }
+        CHECK(wifiHealth.state() == PathHealth::State::Open);
+        CHECK(wait >= expected / 2 - 100 && wait <= expected);
+    }
+    CHECK(posts == postsBefore);
+}
+
+}  // namespace
+
+int main() {
+    host::resetFileSystem();
+    host::setQuiet(true);
+    host::httpServer = acceptUpload;
+    setup();
+    checkProbeWaitsForConnect();
+    checkConnectFailuresBackOff();
+    return host::finish("test_uplink_health");
+}
@@ -0,0 +1,111 @@
+/*
+ * TEST_UPLINK_QUEUE_TSAN - Tarea de lotes y tarea de subida sobre la misma flash
+ *
+ * Un hilo hace de tarea de lotes (processBatch): guarda cada lote en
+ * SessionStore, lo encola bajo queueMutex y la marca subida entera. El hilo
+ * principal hace de tarea de subida (runUplink): copia tramos con peek()
+ * bajo el mutex, los "sube" sin él y los confirma con commit(). Las dos
+ * comparten flash a través de LockedStorage, como en el gateway. Corre con
+ * ThreadSanitizer; además cada registro debe subir una vez y en orden.
+ */
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "host_env.h"
+#include "gateway/locked_storage.h"
+#include "gateway/session_store.h"
+#include "gateway/upload_queue.h"
+#include "storage/flash_storage.h"
+
+namespace {
+
+constexpr uint32_t BATCHES = 200;
+constexpr uint32_t BATCH_RECORDS = 40;
+constexpr uint32_t EPOCH = 0x1234;
+constexpr size_t CHUNK_RECORDS = 256;
+constexpr size_t CHUNK_SEGMENTS = 8;
+
+}  // namespace
+
+int main() {
+    host::setQuiet(true);
+    host::resetFileSystem();
+    FlashStorage flash;
+    LockedStorage storage(flash);
+    SessionStore sessions(storage);
+    UploadQueue queue(storage);
+    std::mutex queueMutex;
+    CHECK(storage.begin() && sessions.begin() && queue.begin());
+
+    std::atomic<bool> done(false);
+    bool stored = true;
+    std::thread batches([&] {
+        std::vector<SeriesPoint> points(BATCH_RECORDS);
+        for (uint32_t batch = 0; batch < BATCHES; batch++) {
+            for (uint32_t i = 0; i < BATCH_RECORDS; i++) {
+                points[i] = SeriesPoint{};
+                points[i].timestamp = batch * BATCH_RECORDS + i;
+                points[i].sourceId = static_cast<uint16_t>(batch);
+            }
+            uint32_t first = batch * BATCH_RECORDS;
+            stored = sessions.start(static_cast<uint16_t>(batch), EPOCH, first, BATCH_RECORDS,
+                                    BATCH_RECORDS * sizeof(SeriesPoint), 0) &&
+                     sessions.append(points.data(), points.size()) && stored;
+            // Cola llena: se espera a que la subida libere lugar
+            while (true) {
+                {
+                    std::lock_guard<std::mutex> lock(queueMutex);
+                    if (queue.push(static_cast<uint16_t>(batch), first, points.data(), points.size(), 0)) {
+                        break;
+                    }
+                }
+                std::this_thread::yield();
+            }
+            stored = sessions.setUploaded(BATCH_RECORDS) && stored;
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    static SeriesPoint chunk[CHUNK_RECORDS];
+    UploadSegment segments[CHUNK_SEGMENTS];
+    uint32_t next = 0;
+    bool ordered = true;
+    uint32_t maxEntries = 0;
+    while (true) {
+        bool finished = done.load(std::memory_order_acquire);
+        size_t segmentCount = 0;
+        size_t count;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            count = queue.peek(chunk, CHUNK_RECORDS, segments, CHUNK_SEGMENTS, segmentCount);
+            maxEntries = queue.entries() > maxEntries ? queue.entries() : maxEntries;
+        }
+        if (count == 0) {
+            if (finished) {
+                break;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+
+        // La "subida" lee la copia sin sostener el lock
+        for (size_t i = 0; i < count; i++) {
+            ordered = ordered && chunk[i].timestamp == next && chunk[i].sourceId == next / BATCH_RECORDS;
+            next++;
+        }
+        std::lock_guard<std::mutex> lock(queueMutex);
+        CHECK(queue.commit(count));
+    }
+    batches.join();
+
+    CHECK(stored);
+    CHECK(ordered);
+    CHECK(next == BATCHES * BATCH_RECORDS);
+    CHECK(queue.empty());
+    CHECK(queue.pendingRecords() == 0);
+    CHECK(maxEntries >= 1 && maxEntries <= UploadQueue::MAX_ENTRIES);
+    CHECK(sessions.storedCount() == BATCH_RECORDS);
+    return host::finish("test_uplink_queue_tsan");
+}
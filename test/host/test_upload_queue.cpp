@@ -0,0 +1,135 @@
+/*
+ * TEST_UPLOAD_QUEUE - Lotes ilegibles en la cola de subida
+ *
+ * Un lote cuyo header se daña con la cola abierta se descarta al llegar al
+ * frente y deja de contar en pendingRecords(). Uno con header válido pero
+ * datos que no se pueden leer se descarta en peek() en vez de trabar la
+ * cola: los lotes de atrás se siguen subiendo.
+ */
+
+#include <string.h>
+#include <vector>
+#include "host_env.h"
+#include "gateway/upload_queue.h"
+#include "storage/flash_storage.h"
+
+namespace {
+
+// Backend cuyas lecturas de datos (después del header) fallan en una ruta
+class UnreadableStorage : public StorageBackend {
+public:
+    explicit UnreadableStorage(StorageBackend& backing) : backing(backing), badPath(nullptr) {}
+
+    void failData(const char* path) { badPath = path; }
+
+    bool begin() override { return backing.begin(); }
+    bool exists(const char* path) override { return backing.exists(path); }
+    bool remove(const char* path) override { return backing.remove(path); }
+    uint32_t size(const char* path) override { return backing.size(path); }
+    bool read(const char* path, uint32_t offset, void* data, size_t length) override {
+        return !(badPath != nullptr && offset > 0 && strcmp(path, badPath) == 0) &&
+               backing.read(path, offset, data, length);
+    }
+    bool write(const char* path, uint32_t offset, const void* data, size_t length) override {
+        return backing.write(path, offset, data, length);
+    }
+    bool truncate(const char* path, uint32_t length) override { return backing.truncate(path, length); }
+    bool rename(const char* from, const char* to) override { return backing.rename(from, to); }
+    const char* name() const override { return backing.name(); }
+
+private:
+    StorageBackend& backing;
+    const char* badPath;
+};
+
+constexpr size_t CAPACITY = 256;
+constexpr size_t MAX_SEGMENTS = 8;
+
+std::vector<SeriesPoint> points(uint16_t session, size_t count) {
+    std::vector<SeriesPoint> out(count);
+    for (size_t i = 0; i < count; i++) {
+        out[i] = SeriesPoint{};
+        out[i].timestamp = 1700000000 + session * 1000 + static_cast<uint32_t>(i);
+        out[i].sourceId = session;
+    }
+    return out;
+}
+
+// Lotes 1..3 con 10, 20 y 30 registros
+void fill(UploadQueue& queue) {
+    for (uint16_t session = 1; session <= 3; session++) {
+        std::vector<SeriesPoint> batch = points(session, session * 10);
+        CHECK(queue.push(session, 0, batch.data(), batch.size(), 0));
+    }
+    CHECK(queue.pendingRecords() == 60);
+}
+
+size_t peekAll(UploadQueue& queue, std::vector<UploadSegment>& segments) {
+    static SeriesPoint out[CAPACITY];
+    segments.assign(MAX_SEGMENTS, UploadSegment{});
+    size_t count = 0;
+    size_t total = queue.peek(out, CAPACITY, segments.data(), segments.size(), count);
+    segments.resize(count);
+    return total;
+}
+
+// Header dañado con la cola abierta: al llegar al frente se descarta y sus
+// registros dejan de contar como pendientes
+void checkCorruptHeader() {
+    host::resetFileSystem();
+    FlashStorage flash;
+    UploadQueue queue(flash);
+    CHECK(queue.begin());
+    fill(queue);
+
+    uint8_t garbage[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+    CHECK(flash.write("/gw_q1.bin", 0, garbage, sizeof(garbage)));
+    std::vector<UploadSegment> segments;
+    CHECK(peekAll(queue, segments) == 10);  // el lote 2 corta la lectura
+    CHECK(queue.commit(10));
+
+    CHECK(peekAll(queue, segments) == 30);
+    CHECK(segments.size() == 1 && segments[0].sessionId == 3);
+    CHECK(queue.entries() == 1);
+    CHECK(queue.pendingRecords() == 30);
+    CHECK(queue.commit(30));
+    CHECK(queue.empty());
+    CHECK(queue.pendingRecords() == 0);
+}
+
+// Datos ilegibles en el frente: peek() lo descarta y sigue con los demás
+void checkUnreadableFront() {
+    host::resetFileSystem();
+    FlashStorage flash;
+    UnreadableStorage storage(flash);
+    UploadQueue queue(storage);
+    CHECK(queue.begin());
+    fill(queue);
+
+    storage.failData("/gw_q0.bin");
+    std::vector<UploadSegment> segments;
+    CHECK(peekAll(queue, segments) == 50);
+    CHECK(segments.size() == 2 && segments[0].sessionId == 2 && segments[1].sessionId == 3);
+    CHECK(queue.entries() == 2);
+    CHECK(queue.pendingRecords() == 50);
+    CHECK(!flash.exists("/gw_q0.bin"));
+
+    // El descarte quedó en el índice
+    UploadQueue reopened(flash);
+    CHECK(reopened.begin());
+    CHECK(reopened.entries() == 2);
+    CHECK(reopened.pendingRecords() == 50);
+
+    CHECK(queue.commit(50));
+    CHECK(queue.empty());
+    CHECK(queue.pendingRecords() == 0);
+}
+
+}  // namespace
+
+int main() {
+    host::setQuiet(true);
+    checkCorruptHeader();
+    checkUnreadableFront();
+    return host::finish("test_upload_queue");
+}
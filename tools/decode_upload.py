@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+"""Custodia upload decoder
+
+The gateway can upload batches as CBOR instead of JSON (console command
+UPLOAD CBOR, see src/gateway/batch_cbor.h). This tool decodes a captured CBOR
+body back into the JSON the gateway would have sent, and compares the size of
+each batch in both encodings.
+
+  python tools/decode_upload.py decode body.cbor > body.json
+  python tools/decode_upload.py compare body.cbor
+"""
+from __future__ import annotations
+
+import argparse
+import json
+import sys
+from pathlib import Path
+from typing import Any, Dict, List, Tuple
+
+
+class CborReader:
+    """Subconjunto de CBOR que usa el gateway: enteros, texto, arreglos y mapas de largo definido."""
+
+    def __init__(self, data: bytes):
+        self.data = data
+        self.pos = 0
+
+    def head(self) -> Tuple[int, int]:
+        if self.pos >= len(self.data):
+            raise ValueError("CBOR truncado")
+        initial = self.data[self.pos]
+        self.pos += 1
+        major, info = initial >> 5, initial & 0x1F
+        if info < 24:
+            return major, info
+        sizes = {24: 1, 25: 2, 26: 4, 27: 8}
+        if info not in sizes:
+            raise ValueError(f"argumento CBOR no soportado ({info}) en {self.pos - 1}")
+        size = sizes[info]
+        if self.pos + size > len(self.data):
+            raise ValueError("CBOR truncado")
+        value = int.from_bytes(self.data[self.pos:self.pos + size], "big")
+        self.pos += size
+        return major, value
+
+    def item(self) -> Any:
+        major, value = self.head()
+        if major == 0:
+            return value
+        if major == 1:
+            return -1 - value
+        if major == 3:
+            raw = self.data[self.pos:self.pos + value]
+            self.pos += value
+            return raw.decode("utf-8")
+        if major == 4:
+            return [self.item() for _ in range(value)]
+        if major == 5:
+            return {self.item(): self.item() for _ in range(value)}
+        raise ValueError(f"tipo CBOR no soportado ({major})")
+
+
+def fixed_point(value: int, scale: int, decimals: int) -> str:
+    sign = "-" if value < 0 else ""
+    magnitude = abs(value)
+    return "%s%d.%0*d" % (sign, magnitude // scale, decimals, magnitude % scale)
+
+
+def record_csv(timestamp: int, fields: List[int]) -> str:
+    _, source, lat, lon, voltage, rssi, snr = fields
+    return ",".join([
+        str(timestamp), str(source), fixed_point(lat, 1000000, 6), fixed_point(lon, 1000000, 6),
+        str(voltage), fixed_point(rssi, 100, 2), fixed_point(snr, 100, 2),
+    ])
+
+
+def batch_to_json(batch: Dict[str, Any]) -> Dict[str, Any]:
+    timestamp = batch["t0"]
+    records = []
+    for fields in batch["records"]:
+        timestamp += fields[0]
+        records.append(record_csv(timestamp, fields))
+    return {"session": batch["session"], "records": records}
+
+
+def decode(data: bytes) -> List[Dict[str, Any]]:
+    reader = CborReader(data)
+    batches = reader.item()
+    if reader.pos != len(data):
+        raise ValueError(f"{len(data) - reader.pos} bytes sobrantes tras el cuerpo")
+    if not isinstance(batches, list):
+        raise ValueError("el cuerpo no es un arreglo de lotes")
+    return [batch_to_json(batch) for batch in batches]
+
+
+def to_json_text(batches: List[Dict[str, Any]]) -> str:
+    # Misma forma y separadores que BatchJsonStream
+    body = batches[0] if len(batches) == 1 else batches
+    return json.dumps(body, separators=(",", ":"))
+
+
+def cbor_head_size(value: int) -> int:
+    if value < 24:
+        return 1
+    return 1 + next(size for size, limit in ((1, 0xFF), (2, 0xFFFF), (4, 0xFFFFFFFF), (8, 1 << 64)) if value <= limit)
+
+
+def cmd_decode(args: argparse.Namespace) -> int:
+    data = sys.stdin.buffer.read() if args.input == "-" else Path(args.input).read_bytes()
+    print(to_json_text(decode(data)))
+    return 0
+
+
+def cmd_compare(args: argparse.Namespace) -> int:
+    data = sys.stdin.buffer.read() if args.input == "-" else Path(args.input).read_bytes()
+    reader = CborReader(data)
+    _, count = reader.head()
+    total_json = 0
+    print("sesión  registros  CBOR B  JSON B     %")
+    for _ in range(count):
+        start = reader.pos
+        batch = batch_to_json(reader.item())
+        # Cada lote como si se subiera solo: arreglo de un elemento en CBOR, objeto en JSON
+        cbor_bytes = reader.pos - start + cbor_head_size(1)
+        json_bytes = len(to_json_text([batch]))
+        total_json += json_bytes
+        print("%6u  %9u  %6u  %6u  %4.0f" % (batch["session"], len(batch["records"]), cbor_bytes, json_bytes,
+                                             100.0 * cbor_bytes / json_bytes))
+    json_body = len(to_json_text(decode(data)))
+    print("cuerpo: CBOR %u B / JSON %u B (%.0f%%)" % (len(data), json_body, 100.0 * len(data) / json_body))
+    return 0
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+    p_decode = sub.add_parser("decode", help="CBOR a JSON")
+    p_decode.add_argument("input", help="cuerpo CBOR ('-' para stdin)")
+    p_decode.set_defaults(func=cmd_decode)
+    p_compare = sub.add_parser("compare", help="bytes por lote en CBOR y en JSON")
+    p_compare.add_argument("input", help="cuerpo CBOR ('-' para stdin)")
+    p_compare.set_defaults(func=cmd_compare)
+    args = parser.parse_args()
+    try:
+        return args.func(args)
+    except ValueError as exc:
+        print(f"ERROR: {exc}", file=sys.stderr)
+        return 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
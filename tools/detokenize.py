@@ -0,0 +1,253 @@
+#!/usr/bin/env python3
+"""Custodia log detokenizer
+
+Firmware built with -DTOKENIZED_LOG replaces every TLOG() format string with
+its 32-bit FNV-1a hash and writes compact binary records over serial (see
+src/log/token_log.h). This tool builds the token dictionary from the sources
+and expands the records back into readable lines.
+
+  python tools/detokenize.py db -o token_db.json
+  python tools/detokenize.py monitor --port /dev/ttyACM0 --db token_db.json
+  python tools/detokenize.py decode capture.bin --db token_db.json
+"""
+from __future__ import annotations
+
+import argparse
+import json
+import re
+import struct
+import sys
+from pathlib import Path
+from typing import Dict, Iterable, List, Optional, Tuple
+
+RECORD_MARKER = 0x1E
+SOURCE_SUFFIXES = (".cpp", ".h")
+TLOG_PATTERN = re.compile(r'\bTLOG\(\s*((?:"(?:[^"\\]|\\.)*"\s*)+)')
+LITERAL_PATTERN = re.compile(r'"((?:[^"\\]|\\.)*)"')
+CONVERSION_PATTERN = re.compile(r"%([-+ #0]*)(\d+|\*)?(?:\.(\d+|\*))?(hh|h|ll|l|z|j|t|L)?([diouxXcsfFeEgGp%])")
+SIMPLE_ESCAPES = {"n": "\n", "t": "\t", "r": "\r", "\\": "\\", '"': '"', "'": "'", "0": "\0"}
+
+
+def fnv1a(data: bytes) -> int:
+    h = 2166136261
+    for b in data:
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def unescape(literal: str) -> str:
+    out = []
+    i = 0
+    while i < len(literal):
+        c = literal[i]
+        if c == "\\" and i + 1 < len(literal):
+            nxt = literal[i + 1]
+            if nxt == "x":
+                match = re.match(r"[0-9a-fA-F]+", literal[i + 2:])
+                if match:
+                    out.append(chr(int(match.group(0), 16)))
+                    i += 2 + len(match.group(0))
+                    continue
+            out.append(SIMPLE_ESCAPES.get(nxt, nxt))
+            i += 2
+            continue
+        out.append(c)
+        i += 1
+    return "".join(out)
+
+
+def build_db(source_dirs: Iterable[Path]) -> Dict[str, str]:
+    db: Dict[str, str] = {}
+    for root in source_dirs:
+        for path in sorted(root.rglob("*")):
+            if path.suffix not in SOURCE_SUFFIXES or path.name == "token_log.h":
+                continue
+            text = path.read_text(encoding="utf-8", errors="replace")
+            for match in TLOG_PATTERN.finditer(text):
+                fmt = "".join(unescape(lit) for lit in LITERAL_PATTERN.findall(match.group(1)))
+                token = "%08x" % fnv1a(fmt.encode("utf-8"))
+                previous = db.get(token)
+                if previous is not None and previous != fmt:
+                    print(f"WARN: colisión de token {token}: '{previous}' / '{fmt}'", file=sys.stderr)
+                db[token] = fmt
+    return db
+
+
+class Reader:
+    def __init__(self, data: bytes):
+        self.data = data
+        self.pos = 0
+
+    def varint(self) -> int:
+        value = 0
+        shift = 0
+        while True:
+            if self.pos >= len(self.data):
+                raise ValueError("varint truncado")
+            b = self.data[self.pos]
+            self.pos += 1
+            value |= (b & 0x7F) << shift
+            if b < 0x80:
+                return value
+            shift += 7
+
+    def signed(self) -> int:
+        raw = self.varint()
+        return (raw >> 1) ^ -(raw & 1)
+
+    def float32(self) -> float:
+        if self.pos + 4 > len(self.data):
+            raise ValueError("float truncado")
+        (value,) = struct.unpack_from("<f", self.data, self.pos)
+        self.pos += 4
+        return value
+
+    def string(self) -> str:
+        length = self.varint()
+        raw = self.data[self.pos:self.pos + length]
+        self.pos += length
+        return raw.decode("utf-8", errors="replace")
+
+
+def format_record(fmt: str, args: bytes) -> str:
+    reader = Reader(args)
+    out: List[str] = []
+    last = 0
+    for match in CONVERSION_PATTERN.finditer(fmt):
+        out.append(fmt[last:match.start()])
+        last = match.end()
+        flags, width, precision, _, conv = match.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        spec = "%" + (flags or "") + (width or "") + ("." + precision if precision else "")
+        try:
+            if conv in "fFeEgG":
+                out.append((spec + conv) % reader.float32())
+            elif conv == "s":
+                out.append((spec + "s") % reader.string())
+            elif conv == "c":
+                out.append((spec + "c") % chr(reader.signed() & 0xFF))
+            elif conv == "p":
+                out.append("0x%x" % reader.signed())
+            elif conv in "xXo":
+                value = reader.signed()
+                out.append((spec + conv) % (value & 0xFFFFFFFF if value < 0 else value))
+            else:
+                out.append((spec + "d") % reader.signed())
+        except ValueError:
+            out.append("<?>")
+    out.append(fmt[last:])
+    return "".join(out)
+
+
+class Detokenizer:
+    def __init__(self, db: Dict[str, str]):
+        self.db = db
+        self.pending = bytearray()
+
+    def feed(self, chunk: bytes) -> Tuple[str, int]:
+        """Returns expanded text and the number of binary bytes consumed."""
+        self.pending.extend(chunk)
+        out: List[str] = []
+        binary = 0
+        while self.pending:
+            marker = self.pending.find(bytes([RECORD_MARKER]))
+            if marker < 0:
+                out.append(self.pending.decode("utf-8", errors="replace"))
+                self.pending.clear()
+                break
+            if marker > 0:
+                out.append(self.pending[:marker].decode("utf-8", errors="replace"))
+                del self.pending[:marker]
+            if len(self.pending) < 2 or len(self.pending) < 2 + self.pending[1]:
+                break
+            length = self.pending[1]
+            body = bytes(self.pending[2:2 + length])
+            del self.pending[:2 + length]
+            binary += 2 + length
+            if length < 4:
+                out.append("<registro corrupto>\n")
+                continue
+            token = "%08x" % struct.unpack_from("<I", body)[0]
+            fmt = self.db.get(token)
+            if fmt is None:
+                out.append(f"<token desconocido {token}>\n")
+            else:
+                out.append(format_record(fmt, body[4:]) + "\n")
+        return "".join(out), binary
+
+
+def load_db(path: Optional[str]) -> Dict[str, str]:
+    if path:
+        return json.loads(Path(path).read_text(encoding="utf-8"))
+    return build_db([Path(__file__).resolve().parent.parent / "src"])
+
+
+def cmd_db(args: argparse.Namespace) -> int:
+    db = build_db([Path(d) for d in args.sources])
+    text = json.dumps(db, indent=1, ensure_ascii=False, sort_keys=True)
+    if args.output:
+        Path(args.output).write_text(text + "\n", encoding="utf-8")
+        print(f"{len(db)} tokens escritos en {args.output}")
+    else:
+        print(text)
+    return 0
+
+
+def cmd_decode(args: argparse.Namespace) -> int:
+    detok = Detokenizer(load_db(args.db))
+    data = sys.stdin.buffer.read() if args.input == "-" else Path(args.input).read_bytes()
+    text, _ = detok.feed(data)
+    sys.stdout.write(text)
+    return 0
+
+
+def cmd_monitor(args: argparse.Namespace) -> int:
+    import serial
+
+    detok = Detokenizer(load_db(args.db))
+    total = 0
+    binary = 0
+    with serial.Serial(args.port, args.baud, timeout=0.2) as ser:
+        try:
+            while True:
+                chunk = ser.read(ser.in_waiting or 1)
+                if not chunk:
+                    continue
+                text, used = detok.feed(chunk)
+                total += len(chunk)
+                binary += used
+                sys.stdout.write(text)
+                sys.stdout.flush()
+        except KeyboardInterrupt:
+            print(f"\n[DETOKENIZE] {total} bytes recibidos, {binary} en registros tokenizados.")
+    return 0
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Custodia log detokenizer")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    db = sub.add_parser("db", help="Generar diccionario de tokens desde el código")
+    db.add_argument("sources", nargs="*", default=[str(Path(__file__).resolve().parent.parent / "src")])
+    db.add_argument("-o", "--output")
+    db.set_defaults(func=cmd_db)
+
+    decode = sub.add_parser("decode", help="Expandir una captura binaria")
+    decode.add_argument("input", help="Archivo de captura o '-' para stdin")
+    decode.add_argument("--db")
+    decode.set_defaults(func=cmd_decode)
+
+    monitor = sub.add_parser("monitor", help="Monitor serial con expansión de tokens")
+    monitor.add_argument("--port", required=True)
+    monitor.add_argument("--baud", type=int, default=115200)
+    monitor.add_argument("--db")
+    monitor.set_defaults(func=cmd_monitor)
+
+    args = parser.parse_args()
+    return args.func(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
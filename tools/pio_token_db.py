@@ -0,0 +1,21 @@
+"""PlatformIO pre-script: genera token_db.json en el directorio de build.
+
+Se usa en los entornos compilados con -DTOKENIZED_LOG para que el diccionario
+del detokenizer siempre corresponda al firmware generado.
+"""
+import json
+import os
+import sys
+
+Import("env")  # noqa: F821  (inyectado por SCons)
+
+sys.path.insert(0, os.path.join(env.subst("$PROJECT_DIR"), "tools"))  # noqa: F821
+from detokenize import build_db  # noqa: E402
+from pathlib import Path  # noqa: E402
+
+db = build_db([Path(env.subst("$PROJECT_SRC_DIR"))])  # noqa: F821
+build_dir = Path(env.subst("$BUILD_DIR"))  # noqa: F821
+build_dir.mkdir(parents=True, exist_ok=True)
+(build_dir / "token_db.json").write_text(json.dumps(db, indent=1, ensure_ascii=False, sort_keys=True) + "\n",
+                                         encoding="utf-8")
+print(f"[TOKEN_LOG] {len(db)} tokens -> {build_dir / 'token_db.json'}")